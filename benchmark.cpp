@@ -0,0 +1,1047 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "builtin_routes.h"
+#include "cidr_parser.h"
+#include "file_operations.h"
+#include "memory_backend.h"
+#include "route_aggregate.h"
+#include "route_index.h"
+#include "route_lpm.h"
+#include "route_operations.h"
+#include "route_patch.h"
+#include "route_priority.h"
+#include "route_set_ops.h"
+#include "route_sources.h"
+#include "route_state.h"
+#include "route_stream.h"
+#include "route_sync.h"
+
+/**
+ * @brief 核心流程的基准测试程序
+ * @details 使用内存路由后端代替系统调用，可在任意平台运行：
+ *          1. generate 生成符合真实前缀长度分布的合成路由文件
+ *          2. 默认对多个规模依次测量解析、合并、聚合、CIDR转换、路由表匹配、安装准备、同步和查找
+ *          3. 每项结果输出一行JSON，便于脚本收集和比较回归
+ *
+ *          用法示例：
+ *          win-route-bench
+ *          win-route-bench --sizes 8675,1000000 --repeat 5
+ *          win-route-bench generate 1000000 synthetic.txt
+ */
+int main(int argc, char *argv[]);
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+
+  double SecondsSince(Clock::time_point start)
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  /**
+   * @brief 生成合成前缀集合
+   * @param count 前缀数量
+   * @param seed 随机种子
+   * @details 前缀长度按公网BGP表的大致分布抽样(/24约占六成)，
+   *          地址在1.0.0.0-223.255.255.255中均匀分布，较短前缀数量很少，与真实表一样存在一定重叠，结果按地址排序，与 chnroute.txt 的形态一致
+   */
+  RouteSet GenerateRoutes(size_t count, uint32_t seed)
+  {
+    // 每百万条中各长度的大致条数
+    static const uint8_t lengths[] = {8, 10, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 28, 32};
+    static const double weights[] = {16, 40, 300, 600, 1200, 2000, 13000, 8000, 13000, 25000, 45000,
+                                     50000, 120000, 100000, 570000, 500, 500};
+    std::mt19937 rng(seed);
+    std::discrete_distribution<int> pick(std::begin(weights), std::end(weights));
+    std::uniform_int_distribution<uint32_t> address(0x01000000u, 0xDFFFFFFFu);
+
+    std::vector<uint64_t> keys(count);
+    for (auto &key : keys)
+    {
+      uint8_t prefixLen = lengths[pick(rng)];
+      key = PrefixKey(address(rng) & PrefixToMask(prefixLen), prefixLen);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    RouteSet routes;
+    routes.Reserve(count);
+    for (uint64_t key : keys)
+    {
+      routes.Add((uint32_t)(key >> 8), (uint8_t)(key & 0xFF));
+    }
+    return routes;
+  }
+
+  std::string FormatRoutes(const RouteSet &routes)
+  {
+    std::string text;
+    text.reserve(routes.Size() * 16);
+    for (size_t i = 0; i < routes.Size(); i++)
+    {
+      text += FormatIpv4(routes.networks[i]);
+      text += '/';
+      text += std::to_string(routes.prefixLens[i]);
+      text += '\n';
+    }
+    return text;
+  }
+
+  /**
+   * @brief 生成 delegated 统计格式的文本
+   * @param count ipv4记录数
+   * @param seed 随机种子
+   * @param[out] rangeText 相同地址范围的"起始-结束"文本
+   * @details 与 delegated-apnic-latest 的形态一致：文件头和汇总行，按地址排序、互不重叠的ipv4记录，
+   *          地址数多为2的幂但也有768、1280这样的非对齐长度，约四分之一属于CN，并夹杂asn和ipv6记录
+   */
+  std::string GenerateDelegated(size_t count, uint32_t seed, std::string &rangeText)
+  {
+    static const uint32_t sizes[] = {256, 512, 768, 1024, 1280, 2048, 4096, 8192, 16384, 65536, 262144};
+    static const double weights[] = {30, 15, 3, 15, 2, 10, 8, 6, 5, 4, 2};
+    static const char *countries[] = {"CN", "JP", "KR", "AU", "IN", "HK", "TW", "SG"};
+    std::mt19937 rng(seed);
+    std::discrete_distribution<int> pick(std::begin(weights), std::end(weights));
+    std::uniform_int_distribution<uint32_t> gap(0, 4);
+
+    std::string text = "2|apnic|20260101|" + std::to_string(count) + "|19830613|20260101|+1000\n";
+    text += "apnic|*|ipv4|*|" + std::to_string(count) + "|summary\n";
+    rangeText.clear();
+    uint64_t address = 0x01000000u;
+    for (size_t i = 0; i < count && address < 0xE0000000u; i++)
+    {
+      uint32_t size = sizes[pick(rng)];
+      address = (address + gap(rng) * 256 + 255) & ~(uint64_t)255;
+      const char *cc = countries[rng() % 4 == 0 ? 0 : 1 + rng() % 7];
+      text += std::string("apnic|") + cc + "|ipv4|" + FormatIpv4((uint32_t)address) + "|" +
+              std::to_string(size) + "|20110414|allocated\n";
+      rangeText += FormatIpv4((uint32_t)address) + "-" + FormatIpv4((uint32_t)(address + size - 1)) + "\n";
+      if (i % 4 == 0)
+      {
+        text += std::string("apnic|") + cc + "|asn|" + std::to_string(4608 + i) + "|1|20110414|allocated\n";
+        text += std::string("apnic|") + cc + "|ipv6|2001:250::|32|20110414|allocated\n";
+      }
+      address += size;
+    }
+    return text;
+  }
+
+  bool WriteRoutes(const std::string &filename, const RouteSet &routes)
+  {
+    return WriteFileAtomically(filename, FormatRoutes(routes));
+  }
+
+  /**
+   * @brief 最初版本的路由条目，作为解析和安装准备的对比基准
+   * @details 与最初的 types.h 相同，地址和掩码以点分字符串保存
+   */
+  struct LegacyRouteEntry
+  {
+    std::string destination;
+    std::string mask;
+    std::string gateway;
+    uint32_t metric;
+    uint32_t ifIndex;
+  };
+
+  // 最初的 ParseCidr：find + substr + std::stoi，掩码转回点分字符串(原实现用 inet_ntoa)
+  bool LegacyParseCidr(const std::string &cidr, std::string &ip, std::string &mask)
+  {
+    size_t pos = cidr.find('/');
+    if (pos == std::string::npos)
+      return false;
+
+    ip = cidr.substr(0, pos);
+    int bits = std::stoi(cidr.substr(pos + 1));
+    if (bits < 0 || bits > 32)
+      return false;
+
+    mask = FormatIpv4(PrefixToMask((uint8_t)bits));
+    return true;
+  }
+
+  // 代替最初使用的 inet_addr：点分字符串转网络字节序整数
+  uint32_t LegacyIpToDword(const std::string &text)
+  {
+    uint32_t value = 0;
+    const char *cur = text.c_str();
+    for (int i = 0; i < 4; i++)
+    {
+      char *end;
+      value |= (uint32_t)strtoul(cur, &end, 10) << (i * 8);
+      cur = *end == '.' ? end + 1 : end;
+    }
+    return value;
+  }
+
+  // 安装前准备的一行转发表项，字段与 MIB_IPFORWARDROW 中用到的部分相同
+  struct ForwardRow
+  {
+    uint32_t destination;
+    uint32_t mask;
+    uint32_t nextHop;
+    uint32_t metric;
+    uint32_t ifIndex;
+  };
+
+  // 最初的 ReadRoutesFromFile：std::getline 逐行读取，每行构造一个字符串条目
+  std::vector<LegacyRouteEntry> LegacyReadRoutes(const std::string &filename)
+  {
+    std::vector<LegacyRouteEntry> routes;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line))
+    {
+      if (line.empty() || line[0] == '#')
+        continue;
+      if (line[line.length() - 1] == '\r')
+        line = line.substr(0, line.length() - 1);
+
+      LegacyRouteEntry entry;
+      if (LegacyParseCidr(line, entry.destination, entry.mask))
+      {
+        entry.gateway = "0.0.0.0";
+        entry.metric = 1;
+        routes.push_back(entry);
+      }
+    }
+    return routes;
+  }
+
+  /**
+   * @brief 输出一项测量结果
+   * @param name 测试项名称
+   * @param size 数据规模(路由条数或行数)
+   * @param items 本次处理的条目数，用于计算吞吐
+   * @param seconds 最好一次的耗时
+   * @param extra 额外的JSON字段，以逗号开头
+   */
+  void Report(const std::string &name, size_t size, size_t items, double seconds,
+              const std::string &extra = "")
+  {
+    printf("{\"case\":\"%s\",\"size\":%zu,\"items\":%zu,\"seconds\":%.6f,\"per_second\":%.0f%s}\n",
+           name.c_str(), size, items, seconds, seconds > 0 ? items / seconds : 0.0, extra.c_str());
+    fflush(stdout);
+  }
+
+  // 重复执行取最短耗时
+  template <typename Fn>
+  double Measure(int repeat, Fn fn)
+  {
+    double best = 1e30;
+    for (int i = 0; i < repeat; i++)
+    {
+      Clock::time_point start = Clock::now();
+      fn();
+      best = std::min(best, SecondsSince(start));
+    }
+    return best;
+  }
+
+  void RunSuite(size_t size, int repeat, uint32_t seed, const std::string &directory)
+  {
+    RouteSet routes = GenerateRoutes(size, seed);
+    std::string text = FormatRoutes(routes);
+    std::string file = directory + "/bench-" + std::to_string(size) + ".txt";
+    WriteRoutes(file, routes);
+    LoadOptions noCache;
+    noCache.useCache = false;
+    noCache.quiet = true;
+    LoadOptions withCache;
+    withCache.quiet = true;
+
+    // 解析：内存中的文本和完整的文件读取
+    double seconds = Measure(repeat, [&]
+                             {
+      RouteSet parsed;
+      ParseCidrBuffer(text.data(), text.size(), file, parsed); });
+    bool simd = SetSimdParsing(true);
+    Report("parse_buffer", size, size, seconds,
+           ",\"bytes\":" + std::to_string(text.size()) + ",\"simd\":" + (simd ? "true" : "false"));
+
+    // 关闭SIMD地址解析作对比
+    SetSimdParsing(false);
+    seconds = Measure(repeat, [&]
+                      {
+      RouteSet parsed;
+      ParseCidrBuffer(text.data(), text.size(), file, parsed); });
+    SetSimdParsing(simd);
+    Report("parse_buffer_scalar", size, size, seconds);
+
+    // 地址范围和 delegated 统计行：按行解析并转换为前缀
+    std::string rangeText;
+    std::string delegatedText = GenerateDelegated(size, seed, rangeText);
+    size_t records = (size_t)std::count(rangeText.begin(), rangeText.end(), '\n');
+    size_t converted = 0;
+    seconds = Measure(repeat, [&]
+                      {
+      RouteSet parsed;
+      ParseCidrBuffer(rangeText.data(), rangeText.size(), file, parsed);
+      converted = parsed.Size(); });
+    Report("parse_ranges", size, records, seconds,
+           ",\"bytes\":" + std::to_string(rangeText.size()) + ",\"output\":" + std::to_string(converted));
+
+    seconds = Measure(repeat, [&]
+                      {
+      RouteSet parsed;
+      ParseCidrBuffer(delegatedText.data(), delegatedText.size(), file, parsed);
+      converted = parsed.Size(); });
+    Report("parse_delegated", size, records, seconds,
+           ",\"bytes\":" + std::to_string(delegatedText.size()) + ",\"output\":" + std::to_string(converted));
+
+    seconds = Measure(repeat, [&]
+                      {
+      RouteSet parsed;
+      ParseCidrBuffer(delegatedText.data(), delegatedText.size(), file, parsed, 1, "CN");
+      converted = parsed.Size(); });
+    Report("parse_delegated_cn", size, records, seconds, ",\"output\":" + std::to_string(converted));
+
+    seconds = Measure(repeat, [&]
+                      {
+      RouteSet parsed;
+      ReadRoutesFromFile(file, parsed, noCache); });
+    Report("read_file", size, size, seconds);
+
+    // 改动前的逐行解析，speedup 为 read_file 相对它的倍数
+    size_t legacyCount = 0;
+    double legacySeconds = Measure(repeat, [&]
+                                   { legacyCount = LegacyReadRoutes(file).size(); });
+    char speedup[64];
+    snprintf(speedup, sizeof(speedup), ",\"speedup\":%.2f", legacySeconds / seconds);
+    Report("read_file_getline", size, legacyCount, legacySeconds, speedup);
+
+    // 安装准备：最初版本每条路由把三个字符串转换为整数，现在直接从 RouteSet 读取
+    {
+      std::vector<LegacyRouteEntry> legacy = LegacyReadRoutes(file);
+      size_t legacyBytes = legacy.capacity() * sizeof(LegacyRouteEntry);
+      for (const auto &entry : legacy)
+      {
+        for (const std::string *text : {&entry.destination, &entry.mask, &entry.gateway})
+          legacyBytes += text->capacity() > 15 ? text->capacity() + 1 : 0;
+      }
+      RouteSet parsed;
+      ReadRoutesFromFile(file, parsed, noCache);
+      size_t setBytes = parsed.networks.capacity() * sizeof(uint32_t) + parsed.prefixLens.capacity();
+
+      std::vector<ForwardRow> rows;
+      std::string gateway = "192.168.1.1";
+      double prepareSeconds = Measure(repeat, [&]
+                                      {
+        rows.clear();
+        rows.reserve(legacy.size());
+        for (const auto &entry : legacy)
+          rows.push_back({LegacyIpToDword(entry.destination), LegacyIpToDword(entry.mask),
+                          LegacyIpToDword(gateway), 25, 7}); });
+      char extra[96];
+      snprintf(extra, sizeof(extra), ",\"bytes_per_route\":%.1f", (double)legacyBytes / legacy.size());
+      Report("prepare_strings", size, rows.size(), prepareSeconds, extra);
+
+      seconds = Measure(repeat, [&]
+                        {
+        rows.clear();
+        rows.reserve(parsed.Size());
+        for (size_t i = 0; i < parsed.Size(); i++)
+          rows.push_back({parsed.networks[i], PrefixToMask(parsed.prefixLens[i]), 0xC0A80101u, 25, 7}); });
+      snprintf(extra, sizeof(extra), ",\"bytes_per_route\":%.1f,\"speedup\":%.2f", (double)setBytes / parsed.Size(),
+               prepareSeconds / seconds);
+      Report("prepare_routeset", size, rows.size(), seconds, extra);
+    }
+
+    // 缓存：首次写入后映射加载
+    std::filesystem::remove(file + ".wrc");
+    {
+      RouteSet warm;
+      ReadRoutesFromFile(file, warm, withCache);
+    }
+    size_t cached = 0;
+    seconds = Measure(repeat, [&]
+                      {
+      RouteSet parsed;
+      ReadRoutesFromFile(file, parsed, withCache);
+      cached = parsed.Size(); });
+    Report("read_cached", size, cached, seconds);
+
+    // 合并两个文件
+    seconds = Measure(repeat, [&]
+                      { MergeRoutes({file, file}, noCache); });
+    Report("merge_two_files", size, size * 2, seconds);
+
+    // 单条CIDR转换：文本 -> 整数 -> 文本
+    seconds = Measure(repeat, [&]
+                      {
+      size_t total = 0;
+      for (size_t i = 0; i < routes.Size(); i++)
+      {
+        std::string cidr = FormatIpv4(routes.networks[i]) + "/" + std::to_string(routes.prefixLens[i]);
+        CidrRecord record;
+        total += ParseCidrRecord(cidr.data(), cidr.data() + cidr.size(), record);
+      }
+      if (total != routes.Size())
+        std::cerr << "conversion mismatch\n"; });
+    Report("cidr_roundtrip", size, size, seconds);
+
+    // 聚合
+    RouteSet aggregated;
+    seconds = Measure(repeat, [&]
+                      {
+      aggregated = routes;
+      AggregateRoutes(aggregated); });
+    Report("aggregate", size, size, seconds, ",\"output\":" + std::to_string(aggregated.Size()));
+
+    // 版本差异：去掉约2%的前缀并加入少量新前缀后生成差异，再应用回去
+    {
+      RouteSet next;
+      for (size_t i = 0; i < aggregated.Size(); i++)
+      {
+        if (i % 50 != 7)
+          next.Add(aggregated.networks[i], aggregated.prefixLens[i]);
+      }
+      next.Append(GenerateRoutes(size / 100 + 1, seed + 9));
+      AggregateRoutes(next);
+      RoutePatch patch;
+      seconds = Measure(repeat, [&]
+                        { patch = DiffRouteSets(aggregated, next); });
+      Report("patch_diff", size, aggregated.Size() + next.Size(), seconds,
+             ",\"removed\":" + std::to_string(patch.removed.Size()) + ",\"added\":" + std::to_string(patch.added.Size()));
+      RouteSet applied;
+      seconds = Measure(repeat, [&]
+                        { ApplyRoutePatch(aggregated, patch, applied); });
+      Report("patch_apply", size, aggregated.Size(), seconds,
+             std::string(",\"same\":") + (applied.networks == next.networks && applied.prefixLens == next.prefixLens ? "true" : "false"));
+    }
+
+    // 近似聚合到精确聚合结果的四分之一
+    RouteSet limited;
+    BudgetResult budget;
+    seconds = Measure(repeat, [&]
+                      {
+      limited = routes;
+      budget = LimitRoutes(limited, aggregated.Size() / 4); });
+    Report("limit_routes", size, size, seconds,
+           ",\"output\":" + std::to_string(limited.Size()) + ",\"over_covered\":" + std::to_string(budget.overCovered));
+
+    // 集合运算：与十分之一规模的另一组前缀做并、交、差和补，包括区间转换和CIDR输出
+    {
+      RouteSet other = GenerateRoutes(size / 10 + 1, seed + 5);
+      std::vector<AddressRange> left, right;
+      RoutesToRanges(routes, left);
+      RoutesToRanges(other, right);
+      seconds = Measure(repeat, [&]
+                        { RoutesToRanges(routes, left); });
+      Report("set_to_ranges", size, size, seconds, ",\"ranges\":" + std::to_string(left.size()));
+      const char *names[] = {"set_union", "set_intersect", "set_subtract", "set_complement"};
+      for (int op = 0; op < 4; op++)
+      {
+        RouteSet output;
+        seconds = Measure(repeat, [&]
+                          {
+          std::vector<AddressRange> result = op == 0 ? UnionRanges(left, right)
+                                             : op == 1 ? IntersectRanges(left, right)
+                                             : op == 2 ? SubtractRanges(left, right)
+                                                       : ComplementRanges(left);
+          RangesToRoutes(result, output); });
+        Report(names[op], size, left.size() + right.size(), seconds, ",\"output\":" + std::to_string(output.Size()));
+      }
+    }
+
+    // 路由表匹配：路由表中已有全部路由，再加上同等数量的无关行
+    std::vector<RouteEntry> table;
+    table.reserve(routes.Size() * 2);
+    for (size_t i = 0; i < routes.Size(); i++)
+    {
+      table.push_back({routes.networks[i], 0xC0A80101u, 7, 25, routes.prefixLens[i], ROUTE_PROTO_NETMGMT});
+      table.push_back({routes.networks[i] | 1u, 0x0A000001u, 9, 5, 32, 2});
+    }
+    RouteTableIndex index;
+    seconds = Measure(repeat, [&]
+                      { index.Build(table); });
+    Report("index_build", table.size(), table.size(), seconds);
+    seconds = Measure(repeat, [&]
+                      {
+      size_t found = 0;
+      for (size_t i = 0; i < routes.Size(); i++)
+        found += index.Find(routes.networks[i], routes.prefixLens[i]).Size();
+      if (found < routes.Size())
+        std::cerr << "index mismatch\n"; });
+    Report("index_match", table.size(), routes.Size(), seconds);
+
+    // 安装准备和执行：内存后端无延迟，主要测量准备和调度开销
+    std::streambuf *saved = std::cout.rdbuf(nullptr);
+    seconds = Measure(repeat, [&]
+                      {
+      MemoryRouteBackend backend;
+      RouteTableSnapshot snapshot(backend);
+      AddRoutes(snapshot, aggregated, 0xC0A80101u, 7, 25, 1); });
+    std::cout.rdbuf(saved);
+    Report("add_routes", aggregated.Size(), aggregated.Size(), seconds);
+
+    // 增量同步：表中已有目标集合，列表变动约0.5%
+    {
+      MemoryRouteBackend backend;
+      backend.Seed({0, 0xC0A80101u, 7, 25, 0, ROUTE_PROTO_NETMGMT});
+      RouteTableSnapshot snapshot(backend);
+      RouteState owner;
+      owner.gateway = 0xC0A80101u;
+      owner.ifIndex = 7;
+      owner.routes = SyncRoutes(snapshot, aggregated, 0xC0A80101u, 7, 25, owner).owned;
+      SortUniqueRoutes(owner.routes);
+      RouteSet changed;
+      size_t step = std::max<size_t>(1, aggregated.Size() / 200);
+      for (size_t i = 0; i < aggregated.Size(); i++)
+      {
+        if (i % step != 0)
+          changed.Add(aggregated.networks[i], aggregated.prefixLens[i]);
+      }
+      Clock::time_point start = Clock::now();
+      SyncResult result = SyncRoutes(snapshot, changed, 0xC0A80101u, 7, 25, owner);
+      Report("sync_delta", aggregated.Size(), aggregated.Size(), SecondsSince(start),
+             ",\"added\":" + std::to_string(result.added) + ",\"removed\":" + std::to_string(result.removed));
+    }
+
+    // 状态文件读写
+    std::string stateFile = file + ".state";
+    RouteState state;
+    state.gateway = 0xC0A80101u;
+    state.ifIndex = 7;
+    state.metric = 25;
+    seconds = Measure(repeat, [&]
+                      {
+      state.routes = aggregated;
+      SaveRouteState(stateFile, state);
+      LoadRouteState(stateFile, state); });
+    Report("state_roundtrip", aggregated.Size(), aggregated.Size(), seconds);
+    std::filesystem::remove(stateFile);
+
+    // 按记录删除与扫描整个路由表删除：表中另有约10%不属于本工具的路由
+    {
+      auto seedTable = [&](MemoryRouteBackend &backend)
+      {
+        backend.Seed({0, 0xC0A80101u, 7, 25, 0, ROUTE_PROTO_NETMGMT});
+        for (size_t i = 0; i < aggregated.Size(); i++)
+          backend.Seed({aggregated.networks[i], 0xC0A80101u, 7, 25, aggregated.prefixLens[i], ROUTE_PROTO_NETMGMT});
+        for (uint32_t i = 0; i < aggregated.Size() / 10; i++)
+          backend.Seed({0xC6120000u + (i << 4), 0, 12, 256, 28, 2});
+      };
+      saved = std::cout.rdbuf(nullptr);
+      MemoryRouteBackend owned;
+      seedTable(owned);
+      RouteTableSnapshot ownedSnapshot(owned);
+      state.routes = aggregated;
+      Clock::time_point start = Clock::now();
+      DeleteOwnedRoutes(ownedSnapshot, state, nullptr, 1);
+      double ownedSeconds = SecondsSince(start);
+
+      MemoryRouteBackend full;
+      seedTable(full);
+      RouteTableSnapshot fullSnapshot(full);
+      start = Clock::now();
+      ResetRoutes(fullSnapshot, 1);
+      double fullSeconds = SecondsSince(start);
+      std::cout.rdbuf(saved);
+
+      Report("teardown_state", aggregated.Size(), owned.deleteCalls, ownedSeconds,
+             ",\"table_reads\":" + std::to_string(owned.tableCalls));
+      Report("teardown_reset_all", aggregated.Size(), full.deleteCalls, fullSeconds,
+             ",\"table_reads\":" + std::to_string(full.tableCalls));
+    }
+
+    // 最长前缀匹配
+    PrefixMatcher matcher;
+    seconds = Measure(repeat, [&]
+                      { matcher.Build(routes); });
+    Report("lpm_build", size, size, seconds, ",\"intervals\":" + std::to_string(matcher.IntervalCount()));
+    std::vector<uint32_t> queries(4000000);
+    std::mt19937 rng(seed + 1);
+    for (auto &query : queries)
+      query = rng();
+    seconds = Measure(repeat, [&]
+                      {
+      size_t hits = 0;
+      for (uint32_t query : queries)
+        hits += matcher.Lookup(query) != PrefixMatcher::NO_MATCH;
+      if (hits > queries.size())
+        std::cerr << "impossible\n"; });
+    Report("lpm_lookup", size, queries.size(), seconds);
+
+    std::filesystem::remove(file);
+    std::filesystem::remove(file + ".wrc");
+  }
+
+  // 内存后端带固定延迟时，不同线程数下的安装耗时
+  void RunInstallerScaling(int repeat, unsigned latencyUs)
+  {
+    RouteSet routes = GenerateRoutes(4000, 7);
+    AggregateRoutes(routes);
+    std::streambuf *saved = std::cout.rdbuf(nullptr);
+    for (unsigned jobs : {1u, 2u, 4u, 8u})
+    {
+      double seconds = Measure(repeat, [&]
+                               {
+        MemoryRouteBackend backend;
+        backend.callLatencyUs = latencyUs;
+        RouteTableSnapshot snapshot(backend);
+        AddRoutes(snapshot, routes, 0xC0A80101u, 7, 25, jobs); });
+      std::cout.rdbuf(saved);
+      Report("install_jobs_" + std::to_string(jobs), routes.Size(), routes.Size(), seconds,
+             ",\"latency_us\":" + std::to_string(latencyUs));
+      std::cout.rdbuf(nullptr);
+    }
+    std::cout.rdbuf(saved);
+  }
+
+  /**
+   * @brief 不同线程数下解析大文件的耗时
+   * @details 一个大文件测量分块并行，大文件加一个小文件测量多文件同时解析；
+   *          每个线程数的结果都与单线程逐字节比较
+   */
+  void RunParseScaling(size_t size, int repeat, uint32_t seed, const std::string &directory)
+  {
+    std::string file = directory + "/bench-parse-" + std::to_string(size) + ".txt";
+    std::string small = directory + "/bench-parse-small.txt";
+    WriteRoutes(file, GenerateRoutes(size, seed));
+    WriteRoutes(small, GenerateRoutes(8675, seed + 1));
+
+    size_t bytes = (size_t)(std::filesystem::file_size(file) + std::filesystem::file_size(small));
+    RouteSet expected;
+    double single = 0;
+    for (unsigned jobs : {1u, 2u, 4u, 8u})
+    {
+      LoadOptions options;
+      options.useCache = false;
+      options.quiet = true;
+      options.jobs = jobs;
+      RouteSet parsed;
+      double seconds = Measure(repeat, [&]
+                               { parsed = MergeRoutes({small, file}, options); });
+      if (jobs == 1)
+      {
+        expected = parsed;
+        single = seconds;
+      }
+      bool same = parsed.networks == expected.networks && parsed.prefixLens == expected.prefixLens;
+      char extra[128];
+      snprintf(extra, sizeof(extra), ",\"workers\":%u,\"speedup\":%.2f,\"same\":%s", ParseWorkerCount(bytes, jobs),
+               single / seconds, same ? "true" : "false");
+      Report("parse_jobs_" + std::to_string(jobs), size, parsed.Size(), seconds, extra);
+    }
+    std::filesystem::remove(file);
+    std::filesystem::remove(small);
+  }
+
+  /**
+   * @brief 只计数不保存路由的后端，记录第一条路由安装成功的时间
+   * @details 不保存路由表，测量到的内存增长只来自加载和安装流程本身
+   */
+  class FirstRouteBackend : public RouteBackend
+  {
+  public:
+    explicit FirstRouteBackend(unsigned latencyUs) : latencyUs_(latencyUs), start_(Clock::now()) {}
+
+    bool GetTable(std::vector<RouteEntry> &rows) override
+    {
+      rows.clear();
+      return true;
+    }
+    uint32_t DeleteEntry(const RouteEntry &) override { return 0; }
+    uint32_t SetEntry(const RouteEntry &) override { return 0; }
+    uint32_t CreateEntry(const RouteEntry &) override
+    {
+      if (latencyUs_ > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(latencyUs_));
+      std::call_once(first_, [&]
+                     { firstMs_ = std::chrono::duration<double, std::milli>(Clock::now() - start_).count(); });
+      created_++;
+      return 0;
+    }
+
+    double FirstRouteMs() const { return firstMs_; }
+    size_t Created() const { return created_; }
+
+  private:
+    unsigned latencyUs_;
+    Clock::time_point start_;
+    std::once_flag first_;
+    double firstMs_ = -1;
+    std::atomic<size_t> created_{0};
+  };
+
+  // 进程的峰值常驻内存(KB)，仅 Linux 可用，其他平台返回0
+  long PeakRssKb()
+  {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+      if (line.compare(0, 6, "VmHWM:") == 0)
+        return atol(line.c_str() + 6);
+    }
+    return 0;
+  }
+
+  // 把峰值常驻内存重置为当前值，使前后两项测量互不影响
+  void ResetPeakRss()
+  {
+    std::ofstream clear("/proc/self/clear_refs");
+    clear << "5";
+  }
+
+  /**
+   * @brief 按命中次数排序安装与按文件顺序安装的覆盖时间对比
+   * @details chnroute 规模的聚合集合，命中集中在随机的少数前缀上(Zipf分布)，
+   *          命中以前缀内的单个地址给出，经最长前缀匹配归属到前缀
+   */
+  void RunPriority(unsigned latencyUs, uint32_t seed)
+  {
+    RouteSet routes = GenerateRoutes(8675, seed);
+    AggregateRoutes(routes);
+
+    std::mt19937 rng(seed);
+    HitCounts hits;
+    for (int rank = 1; rank <= 2000; rank++)
+    {
+      size_t i = rng() % routes.Size();
+      uint32_t host = routes.prefixLens[i] == 32 ? 0 : rng() & ~PrefixToMask(routes.prefixLens[i]);
+      hits.prefixes.Add(routes.networks[i] | host, 32);
+      hits.counts.push_back(1000000 / rank);
+    }
+
+    for (bool weighted : {false, true})
+    {
+      RouteSet ordered = routes;
+      std::vector<uint64_t> weights = AttributeHits(ordered, hits);
+      if (weighted)
+      {
+        SortByWeight(ordered, weights);
+      }
+      std::vector<RouteEntry> rows;
+      for (size_t i = 0; i < ordered.Size(); i++)
+      {
+        rows.push_back({ordered.networks[i], 0xC0A80101u, 7, 25, ordered.prefixLens[i], ROUTE_PROTO_NETMGMT});
+      }
+
+      MemoryRouteBackend backend;
+      backend.callLatencyUs = latencyUs;
+      std::vector<double> finishedMs;
+      Clock::time_point start = Clock::now();
+      RunRouteOperations(backend, rows, RouteOperation::Create, 1, nullptr, &finishedMs);
+      double seconds = SecondsSince(start);
+      CoverageResult coverage = MeasureCoverage(weights, finishedMs);
+
+      char extra[160];
+      snprintf(extra, sizeof(extra), ",\"latency_us\":%u,\"weighted_ms\":%.1f,\"p50_ms\":%.1f,\"p90_ms\":%.1f",
+               latencyUs, coverage.weightedMs, coverage.halfMs, coverage.ninetyMs);
+      Report(weighted ? "install_weighted" : "install_file_order", routes.Size(), routes.Size(), seconds, extra);
+    }
+  }
+
+  /**
+   * @brief 路由已安装时重复执行 add 的耗时(例如每次连接VPN时运行)
+   * @details 1. reconnect_full 重新解析文件并对每条路由调用添加接口
+   *          2. reconnect_delta 重新解析文件，与记录比较后只安装缺少的路由
+   *          3. reconnect_fast 从缓存读取文件内容，聚合结果的指纹与记录一致时读取一次路由表校验，不调用添加接口
+   */
+  void RunReconnect(unsigned latencyUs, uint32_t seed, const std::string &directory)
+  {
+    std::string file = directory + "/bench-reconnect.txt";
+    WriteRoutes(file, GenerateRoutes(8675, seed));
+    std::vector<std::string> files = {file};
+    std::string statePath = directory + "/bench-reconnect.state";
+    LoadOptions noCache;
+    noCache.useCache = false;
+    SourceOptions options;
+    uint32_t gateway = 0xC0A80101u;
+
+    std::streambuf *saved = std::cout.rdbuf(nullptr);
+    MemoryRouteBackend backend;
+    backend.callLatencyUs = latencyUs;
+    backend.Seed({0, gateway, 7, 25, 0, ROUTE_PROTO_NETMGMT});
+    RouteState state;
+    state.gateway = gateway;
+    state.ifIndex = 7;
+    state.metric = 25;
+    {
+      RouteTableSnapshot snapshot(backend);
+      SetRouteSource(state, file, MergeRoutes(files, noCache));
+      ApplyTrackedRoutes(snapshot, state, statePath, options, 1);
+    }
+    size_t installed = state.routes.Size();
+    LoadOptions cached;
+    MergeRoutes(files, cached); // 生成缓存，与实际重复执行 add 时相同
+
+    auto calls = [&]
+    { return backend.tableCalls + backend.createCalls + backend.deleteCalls; };
+    std::string extra = ",\"latency_us\":" + std::to_string(latencyUs);
+    {
+      size_t before = calls();
+      Clock::time_point start = Clock::now();
+      RouteTableSnapshot snapshot(backend);
+      RouteSet routes = MergeRoutes(files, noCache);
+      AggregateRoutes(routes);
+      AddRoutes(snapshot, routes, gateway, 7, 25, 1);
+      double seconds = SecondsSince(start);
+      std::cout.rdbuf(saved);
+      Report("reconnect_full", installed, installed, seconds, extra + ",\"backend_calls\":" + std::to_string(calls() - before));
+      std::cout.rdbuf(nullptr);
+    }
+    {
+      size_t before = calls();
+      Clock::time_point start = Clock::now();
+      RouteTableSnapshot snapshot(backend);
+      RouteState copy;
+      LoadRouteState(statePath, copy);
+      SetRouteSource(copy, file, MergeRoutes(files, noCache));
+      ApplyTrackedRoutes(snapshot, copy, directory + "/bench-reconnect-delta.state", options, 1);
+      double seconds = SecondsSince(start);
+      std::cout.rdbuf(saved);
+      Report("reconnect_delta", installed, installed, seconds, extra + ",\"backend_calls\":" + std::to_string(calls() - before));
+      std::cout.rdbuf(nullptr);
+    }
+    {
+      size_t before = calls();
+      Clock::time_point start = Clock::now();
+      RouteTableSnapshot snapshot(backend);
+      RouteState copy;
+      LoadRouteState(statePath, copy);
+      SetRouteSource(copy, file, MergeRoutes(files, cached));
+      bool current = TrackedRoutesCurrent(snapshot, copy, options, gateway, 7);
+      double seconds = SecondsSince(start);
+      std::cout.rdbuf(saved);
+      Report("reconnect_fast", installed, installed, seconds,
+             extra + ",\"backend_calls\":" + std::to_string(calls() - before) + ",\"skipped\":" + (current ? "true" : "false"));
+    }
+    std::cout.rdbuf(saved);
+    std::filesystem::remove(file);
+    std::filesystem::remove(file + ".wrc");
+    std::filesystem::remove(statePath);
+    std::filesystem::remove(directory + "/bench-reconnect-delta.state");
+  }
+
+  /**
+   * @brief 内置路由集合的启动耗时：取出集合与安装
+   * @details 只在使用 -DWIN_ROUTE_BUILTIN 构建时运行；来源文件仍在时同时测量解析文本的耗时，
+   *          并校验内置数据与运行时解析的结果一致
+   */
+  void RunBuiltin(int repeat, unsigned latencyUs)
+  {
+    LoadOptions noCache;
+    noCache.useCache = false;
+    noCache.quiet = true;
+    for (const auto &name : BuiltinRouteNames())
+    {
+      std::string input = BUILTIN_ROUTE_PREFIX + name;
+      const BuiltinRouteSet *set = FindBuiltinRoutes(input);
+      if (set->count == 0)
+      {
+        continue;
+      }
+
+      RouteSet routes;
+      double loadSeconds = Measure(repeat, [&]
+                                   {
+        routes = MergeRoutes({input}, noCache);
+        AggregateRoutes(routes); });
+      std::string extra;
+      if (std::filesystem::exists(set->source))
+      {
+        RouteSet parsed;
+        double parseSeconds = Measure(repeat, [&]
+                                      {
+          parsed = MergeRoutes({set->source}, noCache);
+          AggregateRoutes(parsed); });
+        bool same = parsed.networks == routes.networks && parsed.prefixLens == routes.prefixLens;
+        extra = ",\"parse_seconds\":" + std::to_string(parseSeconds) + ",\"matches_source\":" + (same ? "true" : "false");
+      }
+      Report("builtin_load_" + name, routes.Size(), routes.Size(), loadSeconds, extra);
+
+      std::streambuf *saved = std::cout.rdbuf(nullptr);
+      MemoryRouteBackend backend;
+      backend.callLatencyUs = latencyUs;
+      RouteTableSnapshot snapshot(backend);
+      Clock::time_point start = Clock::now();
+      AddRoutes(snapshot, routes, 0xC0A80101u, 7, 25, 1);
+      double installSeconds = SecondsSince(start);
+      std::cout.rdbuf(saved);
+      Report("builtin_add_" + name, routes.Size(), routes.Size(), loadSeconds + installSeconds,
+             ",\"latency_us\":" + std::to_string(latencyUs) + ",\"install_seconds\":" + std::to_string(installSeconds));
+    }
+  }
+
+  // 流水线安装与先加载后安装的对比：一个小文件在前，一个大文件在后
+  void RunStreaming(size_t size, unsigned latencyUs, uint32_t seed, const std::string &directory)
+  {
+    std::string small = directory + "/bench-stream-custom.txt";
+    std::string large = directory + "/bench-stream-" + std::to_string(size) + ".txt";
+    WriteRoutes(small, GenerateRoutes(500, seed + 2));
+    WriteRoutes(large, GenerateRoutes(size, seed + 3));
+    std::vector<std::string> files = {small, large};
+    std::string extra = ",\"latency_us\":" + std::to_string(latencyUs);
+
+#ifdef __GLIBC__
+    // 固定 mmap 阈值，大块内存释放后立即归还系统，避免前一项释放的堆内存掩盖后一项的增长
+    mallopt(M_MMAP_THRESHOLD, 64 * 1024);
+#endif
+
+    std::streambuf *saved = std::cout.rdbuf(nullptr);
+    {
+      ResetPeakRss();
+      long before = PeakRssKb();
+      FirstRouteBackend backend(latencyUs);
+      Clock::time_point start = Clock::now();
+      StreamOptions options;
+      options.jobs = 8;
+      StreamRoutes(backend, files, 0xC0A80101u, 7, 25, options);
+      double seconds = SecondsSince(start);
+      std::cout.rdbuf(saved);
+      Report("stream_add", size, backend.Created(), seconds,
+             extra + ",\"first_route_ms\":" + std::to_string(backend.FirstRouteMs()) +
+                 ",\"peak_rss_growth_kb\":" + std::to_string(PeakRssKb() - before));
+      std::cout.rdbuf(nullptr);
+    }
+    {
+      ResetPeakRss();
+      long before = PeakRssKb();
+      FirstRouteBackend backend(latencyUs);
+      RouteTableSnapshot snapshot(backend);
+      Clock::time_point start = Clock::now();
+      LoadOptions noCache;
+      noCache.useCache = false;
+      RouteSet routes = MergeRoutes(files, noCache);
+      AddRoutes(snapshot, routes, 0xC0A80101u, 7, 25, 8);
+      double seconds = SecondsSince(start);
+      std::cout.rdbuf(saved);
+      Report("batch_add", size, backend.Created(), seconds,
+             extra + ",\"first_route_ms\":" + std::to_string(backend.FirstRouteMs()) +
+                 ",\"peak_rss_growth_kb\":" + std::to_string(PeakRssKb() - before));
+    }
+    std::cout.rdbuf(saved);
+    std::filesystem::remove(small);
+    std::filesystem::remove(large);
+  }
+
+  /**
+   * @brief 真实路由文件上改动前后的解析对比
+   * @param filename 路由文件，默认为仓库中的 ip_segment_file/chnroute.txt
+   * @details 文件不存在时跳过；两种解析得到的条数应当相同
+   */
+  void RunRealFile(const std::string &filename, int repeat)
+  {
+    if (!std::filesystem::exists(filename))
+    {
+      return;
+    }
+    LoadOptions noCache;
+    noCache.useCache = false;
+    noCache.quiet = true;
+    size_t parsedCount = 0, legacyCount = 0;
+    double seconds = Measure(repeat, [&]
+                             {
+      RouteSet parsed;
+      ReadRoutesFromFile(filename, parsed, noCache);
+      parsedCount = parsed.Size(); });
+    double legacySeconds = Measure(repeat, [&]
+                                   { legacyCount = LegacyReadRoutes(filename).size(); });
+    char extra[96];
+    snprintf(extra, sizeof(extra), ",\"getline_seconds\":%.6f,\"speedup\":%.2f,\"same_count\":%s", legacySeconds,
+             legacySeconds / seconds, parsedCount == legacyCount ? "true" : "false");
+    Report("read_real_file", parsedCount, parsedCount, seconds, extra);
+  }
+
+  std::vector<size_t> ParseSizes(const std::string &text)
+  {
+    std::vector<size_t> sizes;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+      if (!item.empty())
+        sizes.push_back((size_t)std::strtoull(item.c_str(), nullptr, 10));
+    }
+    return sizes;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<size_t> sizes = {8675, 100000, 1000000};
+  int repeat = 3;
+  uint32_t seed = 1;
+  unsigned latencyUs = 50;
+  size_t streamSize = 200000;
+  size_t parseSize = 5000000;
+  std::string realFile = "ip_segment_file/chnroute.txt";
+  std::vector<std::string> args;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--sizes" && i + 1 < argc)
+      sizes = ParseSizes(argv[++i]);
+    else if (arg == "--repeat" && i + 1 < argc)
+      repeat = std::max(1, atoi(argv[++i]));
+    else if (arg == "--seed" && i + 1 < argc)
+      seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--latency-us" && i + 1 < argc)
+      latencyUs = (unsigned)strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--stream-size" && i + 1 < argc)
+      streamSize = (size_t)std::strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--parse-size" && i + 1 < argc)
+      parseSize = (size_t)std::strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--real-file" && i + 1 < argc)
+      realFile = argv[++i];
+    else
+      args.push_back(arg);
+  }
+
+  if (!args.empty() && args[0] == "generate")
+  {
+    if (args.size() != 3)
+    {
+      std::cout << "Usage: win-route-bench generate <count> <out.txt> [--seed N]\n";
+      return 1;
+    }
+    RouteSet routes = GenerateRoutes((size_t)std::strtoull(args[1].c_str(), nullptr, 10), seed);
+    if (!WriteRoutes(args[2], routes))
+    {
+      std::cout << "Failed to write " << args[2] << "\n";
+      return 1;
+    }
+    std::cout << "Generated " << routes.Size() << " routes into " << args[2] << "\n";
+    return 0;
+  }
+
+  if (!args.empty())
+  {
+    std::cout << "Usage: win-route-bench [--sizes N,N,...] [--repeat N] [--seed N] [--latency-us N] [--stream-size N] [--parse-size N] [--real-file PATH]\n"
+              << "       win-route-bench generate <count> <out.txt> [--seed N]\n";
+    return 1;
+  }
+
+  std::string directory = std::filesystem::temp_directory_path().string();
+  for (size_t size : sizes)
+  {
+    RunSuite(size, repeat, seed, directory);
+  }
+  RunRealFile(realFile, repeat);
+  RunInstallerScaling(repeat, latencyUs);
+  RunParseScaling(parseSize, repeat, seed, directory);
+  RunStreaming(streamSize, latencyUs, seed, directory);
+  RunPriority(latencyUs, seed);
+  RunReconnect(latencyUs, seed, directory);
+  RunBuiltin(repeat, latencyUs);
+  return 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+/**
+ * @brief 有界阻塞队列
+ * @details 用于生产者和消费者线程之间传递数据：
+ *          1. 队列满时 Push 阻塞，生产者不会无限领先，内存占用有上限
+ *          2. 队列空时 Pop 阻塞，直到有数据或队列被关闭
+ *          3. Close 之后 Push 失败，Pop 取完剩余数据后返回false
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+  /**
+   * @brief 放入一项，队列满时等待
+   * @param item 要放入的数据
+   * @return bool 队列已关闭时返回false
+   */
+  bool Push(T item)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    notFull_.wait(lock, [&]
+                  { return closed_ || items_.size() < capacity_; });
+    if (closed_)
+    {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    notEmpty_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief 取出一项，队列空时等待
+   * @param[out] item 取出的数据
+   * @return bool 队列已关闭且没有剩余数据时返回false
+   */
+  bool Pop(T &item)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    notEmpty_.wait(lock, [&]
+                   { return closed_ || !items_.empty(); });
+    if (items_.empty())
+    {
+      return false;
+    }
+    item = std::move(items_.front());
+    items_.pop_front();
+    notFull_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief 不等待地取出一项
+   * @param[out] item 取出的数据
+   * @return bool 队列为空时返回false
+   */
+  bool TryPop(T &item)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (items_.empty())
+    {
+      return false;
+    }
+    item = std::move(items_.front());
+    items_.pop_front();
+    notFull_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief 关闭队列，唤醒所有等待的线程
+   */
+  void Close()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    notEmpty_.notify_all();
+    notFull_.notify_all();
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable notEmpty_;
+  std::condition_variable notFull_;
+  std::deque<T> items_;
+  size_t capacity_;
+  bool closed_ = false;
+};
@@ -0,0 +1,114 @@
+#include "builtin_routes.h"
+#include "file_operations.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+#ifdef WIN_ROUTE_BUILTIN
+#include "builtin_routes.inc"
+#else
+  constexpr BuiltinRouteSet kBuiltinRouteSets[] = {{nullptr, nullptr, nullptr, nullptr, 0}};
+#endif
+
+  // 生成的字符串字面量中转义引号和反斜杠(Windows 路径)
+  std::string Quote(const std::string &text)
+  {
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+      if (c == '"' || c == '\\')
+        quoted.push_back('\\');
+      quoted.push_back(c);
+    }
+    return quoted + "\"";
+  }
+}
+
+bool IsBuiltinRouteName(const std::string &filename)
+{
+  return filename.compare(0, sizeof(BUILTIN_ROUTE_PREFIX) - 1, BUILTIN_ROUTE_PREFIX) == 0;
+}
+
+const BuiltinRouteSet *FindBuiltinRoutes(const std::string &filename)
+{
+  if (!IsBuiltinRouteName(filename))
+  {
+    return nullptr;
+  }
+  const char *name = filename.c_str() + sizeof(BUILTIN_ROUTE_PREFIX) - 1;
+  for (const BuiltinRouteSet *set = kBuiltinRouteSets; set->name != nullptr; set++)
+  {
+    if (strcmp(set->name, name) == 0)
+    {
+      return set;
+    }
+  }
+  return nullptr;
+}
+
+bool LoadBuiltinRoutes(const std::string &filename, RouteSet &routes)
+{
+  const BuiltinRouteSet *set = FindBuiltinRoutes(filename);
+  if (set == nullptr)
+  {
+    return false;
+  }
+  routes.networks.insert(routes.networks.end(), set->networks, set->networks + set->count);
+  routes.prefixLens.insert(routes.prefixLens.end(), set->prefixLens, set->prefixLens + set->count);
+  return true;
+}
+
+std::vector<std::string> BuiltinRouteNames()
+{
+  std::vector<std::string> names;
+  for (const BuiltinRouteSet *set = kBuiltinRouteSets; set->name != nullptr; set++)
+  {
+    names.push_back(set->name);
+  }
+  return names;
+}
+
+bool WriteBuiltinRouteSource(const std::string &filename, const std::vector<std::string> &sources,
+                             const std::vector<RouteSet> &sets)
+{
+  // 读取失败的文件得到空集合，生成空的内置集合只会在运行时静默地少装路由
+  for (const RouteSet &routes : sets)
+  {
+    if (routes.Empty())
+      return false;
+  }
+
+  std::string text = "// 由 win-route compile --format cpp 生成，请勿手工修改\n";
+  std::string table = "constexpr BuiltinRouteSet kBuiltinRouteSets[] = {\n";
+  char item[32];
+  for (size_t k = 0; k < sets.size(); k++)
+  {
+    const RouteSet &routes = sets[k];
+    std::string name = std::filesystem::path(sources[k]).stem().string();
+    std::string index = std::to_string(k);
+
+    // 地址每行8项、前缀长度每行16项
+    text += "\n// " + name + ": " + std::to_string(routes.Size()) + " routes\n";
+    text += "constexpr uint32_t kBuiltinNetworks" + index + "[] = {";
+    for (size_t i = 0; i < routes.Size(); i++)
+    {
+      snprintf(item, sizeof(item), "%s0x%08Xu,", i % 8 == 0 ? "\n    " : " ", routes.networks[i]);
+      text += item;
+    }
+    text += "\n};\n";
+    text += "constexpr uint8_t kBuiltinPrefixLens" + index + "[] = {";
+    for (size_t i = 0; i < routes.Size(); i++)
+    {
+      snprintf(item, sizeof(item), "%s%u,", i % 16 == 0 ? "\n    " : " ", routes.prefixLens[i]);
+      text += item;
+    }
+    text += "\n};\n";
+
+    table += "    {" + Quote(name) + ", " + Quote(sources[k]) + ", kBuiltinNetworks" + index + ", kBuiltinPrefixLens" +
+             index + ", " + std::to_string(routes.Size()) + "},\n";
+  }
+  table += "    {nullptr, nullptr, nullptr, nullptr, 0}};\n";
+  return WriteFileAtomically(filename, text + "\n" + table);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "types.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief 编译进程序的路由集合
+ * @details 由 compile --format cpp 生成的 builtin_routes.inc 定义，数组排序聚合后以常量形式存放在只读数据段
+ */
+struct BuiltinRouteSet
+{
+  const char *name;          ///< 集合名，add builtin:<name> 使用
+  const char *source;        ///< 生成时的路由文件路径
+  const uint32_t *networks;  ///< 网络地址(主机字节序)，升序
+  const uint8_t *prefixLens; ///< 与 networks 一一对应的前缀长度
+  size_t count;              ///< 前缀数量
+};
+
+/// 内置路由集合在命令行中的前缀
+const char BUILTIN_ROUTE_PREFIX[] = "builtin:";
+
+/**
+ * @brief 判断输入是否为内置路由集合
+ * @param filename 命令行中的路由文件参数
+ * @return bool 以 builtin: 开头返回true
+ */
+bool IsBuiltinRouteName(const std::string &filename);
+
+/**
+ * @brief 查找内置路由集合
+ * @param filename builtin:<name> 形式的参数
+ * @return const BuiltinRouteSet* 找到时返回集合，不存在或未使用 WIN_ROUTE_BUILTIN 构建时返回nullptr
+ */
+const BuiltinRouteSet *FindBuiltinRoutes(const std::string &filename);
+
+/**
+ * @brief 读取内置路由集合
+ * @param filename builtin:<name> 形式的参数
+ * @param[out] routes 集合中的前缀追加到此处
+ * @return bool 集合存在返回true
+ * @details 只复制两个常量数组，不读取文件也不解析文本
+ */
+bool LoadBuiltinRoutes(const std::string &filename, RouteSet &routes);
+
+/**
+ * @brief 列出内置路由集合的名称
+ * @return std::vector<std::string> 集合名，未使用 WIN_ROUTE_BUILTIN 构建时为空
+ */
+std::vector<std::string> BuiltinRouteNames();
+
+/**
+ * @brief 生成内置路由集合的C++源文件
+ * @param filename 输出文件路径(通常为 builtin_routes.inc)
+ * @param sources 每个集合的来源文件路径
+ * @param sets 与 sources 一一对应的前缀集合，应已排序聚合
+ * @return bool 写入成功返回true；任一集合为空(文件读取失败或没有有效前缀)时返回false，不写入文件
+ * @details 1. 集合名取来源文件名去掉扩展名，例如 ip_segment_file/chnroute.txt 为 chnroute
+ *          2. 每个集合生成 constexpr 的 networks 和 prefixLens 数组，
+ *             最后生成以空项结尾的 BuiltinRouteSet 表
+ *          3. 使用 -DWIN_ROUTE_BUILTIN 编译 builtin_routes.cpp 时包含该文件
+ */
+bool WriteBuiltinRouteSource(const std::string &filename, const std::vector<std::string> &sources,
+                             const std::vector<RouteSet> &sets);
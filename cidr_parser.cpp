@@ -0,0 +1,562 @@
+#include "cidr_parser.h"
+#include "route_set_ops.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// x86 上用SSSE3解析地址，运行时检测CPU，其他平台只用标量实现
+#if !defined(WIN_ROUTE_NO_SIMD) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define CIDR_PARSER_SSSE3
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CIDR_PARSER_TARGET_SSSE3
+#else
+#include <immintrin.h>
+#define CIDR_PARSER_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+#endif
+
+namespace
+{
+  // 并行解析时每块的大致字节数，小文件只有一块，不启动线程
+  const size_t kParseChunkBytes = 256 * 1024;
+
+  // 每个解析线程至少分到的字节数，少于此时启动线程和拼接结果的开销超过并行的收益
+  const size_t kParseBytesPerWorker = 4 * 1024 * 1024;
+
+  inline bool IsDigit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  inline bool IsBlank(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+
+#ifdef CIDR_PARSER_SSSE3
+  bool HasSsse3()
+  {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+#endif
+  }
+
+  // 启动时检测一次，SetSimdParsing 可以关闭
+  bool useSsse3 = HasSsse3();
+
+  inline int CountTrailingZeros(uint32_t x)
+  {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return (int)index;
+#else
+    return __builtin_ctz(x);
+#endif
+  }
+
+  /**
+   * @brief 各段位数组合对应的 pshufb 重排表
+   * @details 四段各1-3位，共81种组合。每段重排到一个32位通道的 [0, 百位, 十位, 个位]，
+   *          缺少的位填0，之后一次乘加即可得到四段的值
+   */
+  struct ShuffleTable
+  {
+    alignas(16) uint8_t patterns[81][16];
+
+    ShuffleTable()
+    {
+      for (int index = 0; index < 81; index++)
+      {
+        int lengths[4] = {index / 27 + 1, index / 9 % 3 + 1, index / 3 % 3 + 1, index % 3 + 1};
+        int start = 0;
+        for (int octet = 0; octet < 4; octet++)
+        {
+          uint8_t *lane = patterns[index] + octet * 4;
+          for (int k = 0; k < 4; k++)
+          {
+            // 通道内第 k 字节对应该段从右数第 3-k 位
+            int fromRight = 3 - k;
+            lane[k] = fromRight < lengths[octet] ? (uint8_t)(start + lengths[octet] - 1 - fromRight) : 0x80;
+          }
+          start += lengths[octet] + 1;
+        }
+      }
+    }
+  };
+
+  const ShuffleTable shuffleTable;
+
+  /**
+   * @brief 用SSSE3解析点分十进制地址
+   * @details 调用方保证 p 起的16字节可读。一次加载16字节，用比较得到数字和点的位掩码，
+   *          由三个点的位置确定各段位数并查表重排，再用 pmaddubsw/pmaddwd 算出四段的值。
+   *          只处理地址恰好由三个点分隔、每段1-3位、后面跟非数字非点字符的常见情况，
+   *          返回false时由标量代码重新解析，因此结果与标量实现完全一致
+   */
+  CIDR_PARSER_TARGET_SSSE3 bool ParseIpv4Ssse3(const char *&p, const char *end, uint32_t &address)
+  {
+    const __m128i input = _mm_loadu_si128((const __m128i *)p);
+    const __m128i digits = _mm_sub_epi8(input, _mm_set1_epi8('0'));
+    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    const __m128i isDot = _mm_cmpeq_epi8(input, _mm_set1_epi8('.'));
+    uint32_t digitMask = (uint32_t)_mm_movemask_epi8(isDigit);
+    uint32_t dotMask = (uint32_t)_mm_movemask_epi8(isDot);
+
+    // 地址在第一个既不是数字也不是点的字符处结束，且不超过 end
+    size_t available = (size_t)(end - p);
+    uint32_t inRange = available >= 16 ? 0xFFFFu : (1u << available) - 1;
+    uint32_t stop = ~(digitMask | dotMask) & 0xFFFFu;
+    stop |= ~inRange & 0x1FFFFu;
+    int length = CountTrailingZeros(stop);
+    dotMask &= (1u << length) - 1;
+
+    // 恰好三个点，各段1-3位
+    if (dotMask == 0)
+      return false;
+    int dot1 = CountTrailingZeros(dotMask);
+    dotMask &= dotMask - 1;
+    if (dotMask == 0)
+      return false;
+    int dot2 = CountTrailingZeros(dotMask);
+    dotMask &= dotMask - 1;
+    if (dotMask == 0)
+      return false;
+    int dot3 = CountTrailingZeros(dotMask);
+    dotMask &= dotMask - 1;
+    if (dotMask != 0)
+      return false;
+    int lengths[4] = {dot1, dot2 - dot1 - 1, dot3 - dot2 - 1, length - dot3 - 1};
+    int index = 0;
+    for (int octet = 0; octet < 4; octet++)
+    {
+      if (lengths[octet] < 1 || lengths[octet] > 3)
+        return false;
+      index = index * 3 + lengths[octet] - 1;
+    }
+
+    const __m128i pattern = _mm_load_si128((const __m128i *)shuffleTable.patterns[index]);
+    const __m128i arranged = _mm_shuffle_epi8(digits, pattern);
+    const __m128i pairs = _mm_maddubs_epi16(arranged, _mm_setr_epi8(0, 100, 10, 1, 0, 100, 10, 1,
+                                                                     0, 100, 10, 1, 0, 100, 10, 1));
+    const __m128i values = _mm_madd_epi16(pairs, _mm_set1_epi16(1));
+    if (_mm_movemask_epi8(_mm_cmpgt_epi32(values, _mm_set1_epi32(255))) != 0)
+      return false;
+
+    // 取每个32位通道的最低字节，按网络字节序排列后转为主机字节序
+    const __m128i packed = _mm_shuffle_epi8(values, _mm_setr_epi8(12, 8, 4, 0, -1, -1, -1, -1,
+                                                                  -1, -1, -1, -1, -1, -1, -1, -1));
+    address = (uint32_t)_mm_cvtsi128_si32(packed);
+    p += length;
+    return true;
+  }
+#endif
+
+  bool ParseIpv4Scalar(const char *&p, const char *end, uint32_t &address)
+  {
+    const char *cur = p;
+    uint32_t result = 0;
+
+    for (int octet = 0; octet < 4; octet++)
+    {
+      if (octet > 0)
+      {
+        if (cur == end || *cur != '.')
+          return false;
+        cur++;
+      }
+
+      // 每段1-3位数字
+      if (cur == end || !IsDigit(*cur))
+        return false;
+      uint32_t value = 0;
+      int digits = 0;
+      while (cur != end && IsDigit(*cur) && digits < 3)
+      {
+        value = value * 10 + (uint32_t)(*cur - '0');
+        cur++;
+        digits++;
+      }
+      if (value > 255 || (cur != end && IsDigit(*cur)))
+        return false;
+
+      result = (result << 8) | value;
+    }
+
+    address = result;
+    p = cur;
+    return true;
+  }
+
+  /**
+   * @brief 解析点分十进制地址，limit 之前的字节都可读
+   * @details 可读字节不少于16且CPU支持时先走SIMD路径，否则或SIMD无法处理时用标量实现
+   */
+  inline bool ParseIpv4Bounded(const char *&p, const char *end, const char *limit, uint32_t &address)
+  {
+#ifdef CIDR_PARSER_SSSE3
+    if (useSsse3 && limit - p >= 16 && ParseIpv4Ssse3(p, end, address))
+      return true;
+#else
+    (void)limit;
+#endif
+    return ParseIpv4Scalar(p, end, address);
+  }
+
+  bool ParseCidrBounded(const char *begin, const char *end, const char *limit, CidrRecord &record)
+  {
+    const char *p = begin;
+    uint32_t address;
+    if (!ParseIpv4Bounded(p, end, limit, address))
+      return false;
+
+    if (p == end || *p != '/')
+      return false;
+    p++;
+
+    // 前缀长度为1-2位数字
+    if (p == end || !IsDigit(*p))
+      return false;
+    unsigned bits = (unsigned)(*p++ - '0');
+    if (p != end && IsDigit(*p))
+      bits = bits * 10 + (unsigned)(*p++ - '0');
+    if (p != end || bits > 32)
+      return false;
+
+    record.network = address & PrefixToMask(bits);
+    record.prefixLen = (uint8_t)bits;
+    return true;
+  }
+
+  /**
+   * @brief 一行的解析结果
+   */
+  enum class LineResult
+  {
+    Added,   ///< 解析出一个或多个前缀
+    Skipped, ///< 格式正确但不需要的行(文件头、汇总、非IPv4或其他国家)
+    Invalid  ///< 无法识别
+  };
+
+  bool FieldEquals(const char *begin, const char *end, const char *text)
+  {
+    size_t length = strlen(text);
+    return (size_t)(end - begin) == length && memcmp(begin, text, length) == 0;
+  }
+
+  /**
+   * @brief 解析 "a.b.c.d-e.f.g.h" 形式的地址范围，减号两侧允许空白
+   */
+  LineResult ParseRangeLine(const char *begin, const char *end, const char *limit, RouteSet &routes)
+  {
+    const char *p = begin;
+    uint32_t first, last;
+    if (!ParseIpv4Bounded(p, end, limit, first))
+      return LineResult::Invalid;
+    while (p < end && IsBlank(*p))
+      p++;
+    if (p == end || *p != '-')
+      return LineResult::Invalid;
+    p++;
+    while (p < end && IsBlank(*p))
+      p++;
+    if (!ParseIpv4Bounded(p, end, limit, last) || p != end || last < first)
+      return LineResult::Invalid;
+
+    AppendRangeCidrs(first, last, routes);
+    return LineResult::Added;
+  }
+
+  // 字段非空且全部为数字
+  bool FieldIsNumber(const char *begin, const char *end)
+  {
+    if (begin == end)
+      return false;
+    for (const char *p = begin; p < end; p++)
+    {
+      if (!IsDigit(*p))
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief 解析 APNIC 等RIR的 delegated 统计行
+   * @details 记录格式为 registry|cc|type|start|value|date|status[|...]：
+   *          1. 版本行(第一个字段为版本号)、汇总行(cc为*且第六个字段为summary)和 asn/ipv6 记录跳过
+   *          2. 其余的行必须是至少7个字段的 ipv4 记录，字段不足、类型未知、起始地址或地址数无效时为无效行
+   *          3. 指定国家时跳过其他国家的记录，扩展格式中 available/reserved 状态的记录跳过
+   *          4. value 为地址数，不要求是2的幂，按地址范围转换为最少的前缀
+   */
+  LineResult ParseDelegatedLine(const char *begin, const char *end, const char *limit, const std::string &country,
+                                RouteSet &routes)
+  {
+    const char *fields[8];
+    const char *fieldEnds[8];
+    int count = 0;
+    const char *cur = begin;
+    while (count < 8)
+    {
+      const char *bar = (const char *)memchr(cur, '|', (size_t)(end - cur));
+      fields[count] = cur;
+      fieldEnds[count] = bar ? bar : end;
+      count++;
+      if (!bar)
+        break;
+      cur = bar + 1;
+    }
+
+    if (FieldIsNumber(fields[0], fieldEnds[0]))
+      return LineResult::Skipped;
+    if (count >= 6 && FieldEquals(fields[1], fieldEnds[1], "*") && FieldEquals(fields[5], fieldEnds[5], "summary"))
+      return LineResult::Skipped;
+    if (count < 7)
+      return LineResult::Invalid;
+    if (FieldEquals(fields[2], fieldEnds[2], "asn") || FieldEquals(fields[2], fieldEnds[2], "ipv6"))
+      return LineResult::Skipped;
+    if (!FieldEquals(fields[2], fieldEnds[2], "ipv4"))
+      return LineResult::Invalid;
+
+    const char *p = fields[3];
+    uint32_t start;
+    if (!ParseIpv4Bounded(p, fieldEnds[3], limit, start) || p != fieldEnds[3])
+      return LineResult::Invalid;
+
+    uint64_t value = 0;
+    for (p = fields[4]; p < fieldEnds[4]; p++)
+    {
+      if (!IsDigit(*p) || value > 0xFFFFFFFFull)
+        return LineResult::Invalid;
+      value = value * 10 + (uint64_t)(*p - '0');
+    }
+    if (p == fields[4] || value == 0 || start + value - 1 > 0xFFFFFFFFull)
+      return LineResult::Invalid;
+
+    if (!country.empty() && !FieldEquals(fields[1], fieldEnds[1], country.c_str()))
+      return LineResult::Skipped;
+    if (FieldEquals(fields[6], fieldEnds[6], "available") || FieldEquals(fields[6], fieldEnds[6], "reserved"))
+      return LineResult::Skipped;
+
+    AppendRangeCidrs(start, (uint32_t)(start + value - 1), routes);
+    return LineResult::Added;
+  }
+
+  /**
+   * @brief 自动识别一行的格式并解析
+   * @param limit 缓冲区结束位置，行之后到 limit 的字节可以被SIMD路径读取
+   */
+  LineResult ParseRouteLine(const char *begin, const char *end, const char *limit, const std::string &country,
+                            RouteSet &routes)
+  {
+    CidrRecord record;
+    if (ParseCidrBounded(begin, end, limit, record))
+    {
+      routes.Add(record.network, record.prefixLen);
+      return LineResult::Added;
+    }
+    if (memchr(begin, '|', (size_t)(end - begin)) != nullptr)
+    {
+      return ParseDelegatedLine(begin, end, limit, country, routes);
+    }
+    return ParseRangeLine(begin, end, limit, routes);
+  }
+
+  /**
+   * @brief 逐行解析缓冲区
+   * @param onInvalid 无效行回调 onInvalid(行序号(从0开始), 起始, 结束)
+   * @return size_t 无效行数
+   */
+  template <typename OnInvalid>
+  size_t ParseLines(const char *data, size_t size, const std::string &country, RouteSet &routes,
+                    OnInvalid onInvalid)
+  {
+    size_t invalid = 0;
+    size_t line = 0;
+    const char *cur = data;
+    const char *end = data + size;
+
+    for (; cur < end; line++)
+    {
+      const char *newline = (const char *)memchr(cur, '\n', (size_t)(end - cur));
+      const char *lineEnd = newline ? newline : end;
+
+      // 去除首尾空白和回车符
+      const char *begin = cur;
+      while (begin < lineEnd && IsBlank(*begin))
+        begin++;
+      const char *last = lineEnd;
+      while (last > begin && IsBlank(last[-1]))
+        last--;
+
+      cur = newline ? newline + 1 : end;
+
+      // 跳过空行和注释行
+      if (begin == last || *begin == '#')
+        continue;
+
+      if (ParseRouteLine(begin, last, end, country, routes) == LineResult::Invalid)
+      {
+        invalid++;
+        onInvalid(line, begin, last);
+      }
+    }
+
+    return invalid;
+  }
+}
+
+bool ParseIpv4(const char *&p, const char *end, uint32_t &address)
+{
+  return ParseIpv4Bounded(p, end, end, address);
+}
+
+bool ParseCidrRecord(const char *begin, const char *end, CidrRecord &record)
+{
+  return ParseCidrBounded(begin, end, end, record);
+}
+
+bool SetSimdParsing(bool enabled)
+{
+#ifdef CIDR_PARSER_SSSE3
+  useSsse3 = enabled && HasSsse3();
+  return useSsse3;
+#else
+  (void)enabled;
+  return false;
+#endif
+}
+
+size_t ParseCidrBuffer(const char *data, size_t size, const std::string &source,
+                       RouteSet &routes, size_t firstLine, const std::string &country)
+{
+  return ParseLines(data, size, country, routes, [&](size_t line, const char *begin, const char *last)
+                    { std::cout << source << ":" << firstLine + line << ": Invalid CIDR format: "
+                                << std::string(begin, last) << "\n"; });
+}
+
+unsigned ParseWorkerCount(size_t bytes, unsigned jobs)
+{
+  unsigned hardware = std::thread::hardware_concurrency();
+  if (hardware > 0)
+  {
+    jobs = std::min(jobs, hardware);
+  }
+  return (unsigned)std::max<size_t>(1, std::min<size_t>(jobs, bytes / kParseBytesPerWorker));
+}
+
+size_t ParseCidrBuffers(const std::vector<ParseInput> &inputs, std::vector<RouteSet> &results, unsigned jobs,
+                        const std::string &country, std::vector<size_t> *invalidLines)
+{
+  // 按换行符把每个输入切成若干块，块只属于一个输入
+  struct Chunk
+  {
+    size_t input;
+    const char *data;
+    size_t size;
+    size_t lines = 0;                                   ///< 块内换行符数
+    RouteSet routes;                                    ///< 块内解析结果
+    std::vector<std::pair<size_t, std::string>> errors; ///< 块内行号(从0开始)和无效行内容
+  };
+  std::vector<Chunk> chunks;
+  size_t bytes = 0;
+  for (size_t i = 0; i < inputs.size(); i++)
+  {
+    bytes += inputs[i].size;
+    const char *cur = inputs[i].data;
+    const char *end = cur + inputs[i].size;
+    while (cur < end)
+    {
+      const char *split = cur + std::min<size_t>(kParseChunkBytes, (size_t)(end - cur));
+      const char *newline = split < end ? (const char *)memchr(split, '\n', (size_t)(end - split)) : nullptr;
+      const char *next = newline ? newline + 1 : end;
+      chunks.push_back({i, cur, (size_t)(next - cur), 0, RouteSet(), {}});
+      cur = next;
+    }
+  }
+  jobs = ParseWorkerCount(bytes, jobs);
+
+  // 各块互不依赖，并行解析；无效行先收集，避免输出交错
+  ParallelFor(chunks.size(), jobs, 1, [&](size_t begin, size_t end, unsigned)
+              {
+    for (size_t c = begin; c < end; c++)
+    {
+      Chunk &chunk = chunks[c];
+      ParseLines(chunk.data, chunk.size, country, chunk.routes, [&](size_t line, const char *first, const char *last)
+                 { chunk.errors.emplace_back(line, std::string(first, last)); });
+      chunk.lines = (size_t)std::count(chunk.data, chunk.data + chunk.size, '\n');
+    }
+  });
+
+  // 按输入和块的顺序计算行号、输出无效行，并确定每块在结果中的位置
+  results.assign(inputs.size(), RouteSet());
+  std::vector<size_t> offsets(chunks.size());
+  std::vector<size_t> totals(inputs.size(), 0);
+  std::vector<size_t> lineBase(inputs.size(), 1);
+  size_t invalid = 0;
+  if (invalidLines)
+  {
+    invalidLines->assign(inputs.size(), 0);
+  }
+  for (size_t c = 0; c < chunks.size(); c++)
+  {
+    const Chunk &chunk = chunks[c];
+    for (const auto &error : chunk.errors)
+    {
+      std::cout << inputs[chunk.input].source << ":" << lineBase[chunk.input] + error.first
+                << ": Invalid CIDR format: " << error.second << "\n";
+    }
+    invalid += chunk.errors.size();
+    if (invalidLines)
+    {
+      (*invalidLines)[chunk.input] += chunk.errors.size();
+    }
+    lineBase[chunk.input] += chunk.lines;
+    offsets[c] = totals[chunk.input];
+    totals[chunk.input] += chunk.routes.Size();
+  }
+  for (size_t i = 0; i < inputs.size(); i++)
+  {
+    results[i].networks.resize(totals[i]);
+    results[i].prefixLens.resize(totals[i]);
+  }
+
+  // 按块顺序拼接，结果与单线程逐行解析完全一致
+  ParallelFor(chunks.size(), jobs, 1, [&](size_t begin, size_t end, unsigned)
+              {
+    for (size_t c = begin; c < end; c++)
+    {
+      RouteSet &target = results[chunks[c].input];
+      const RouteSet &routes = chunks[c].routes;
+      std::copy(routes.networks.begin(), routes.networks.end(), target.networks.begin() + offsets[c]);
+      std::copy(routes.prefixLens.begin(), routes.prefixLens.end(), target.prefixLens.begin() + offsets[c]);
+    }
+  });
+
+  return invalid;
+}
+
+std::string FormatIpv4(uint32_t address)
+{
+  char buffer[16];
+  char *p = buffer;
+  for (int shift = 24; shift >= 0; shift -= 8)
+  {
+    unsigned value = (address >> shift) & 0xFF;
+    if (value >= 100)
+      *p++ = (char)('0' + value / 100);
+    if (value >= 10)
+      *p++ = (char)('0' + value / 10 % 10);
+    *p++ = (char)('0' + value % 10);
+    if (shift > 0)
+      *p++ = '.';
+  }
+  return std::string(buffer, p);
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "types.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 解析点分十进制IPv4地址
+ * @param[in,out] p 起始位置，成功后指向地址之后的第一个字符
+ * @param end 缓冲区结束位置
+ * @param[out] address 主机字节序的地址
+ * @return bool 解析成功返回true
+ * @details 1. 每段只接受1-3位十进制数字且不超过255，不抛出异常
+ *          2. [p, end) 不少于16字节且CPU支持SSSE3时用SIMD一次解析整个地址，结果与标量实现一致
+ */
+bool ParseIpv4(const char *&p, const char *end, uint32_t &address);
+
+/**
+ * @brief 解析单个CIDR(如"1.0.1.0/24")
+ * @param begin 文本起始位置
+ * @param end 文本结束位置(不包含)
+ * @param[out] record 解析结果，主机位会被清零
+ * @return bool 整段文本恰好是一个合法CIDR时返回true
+ */
+bool ParseCidrRecord(const char *begin, const char *end, CidrRecord &record);
+
+/**
+ * @brief 开启或关闭地址解析的SIMD路径
+ * @param enabled 是否使用SIMD
+ * @return bool 之后是否实际使用SIMD
+ * @details 1. x86 上默认在运行时检测到SSSE3时开启，其他平台或定义 WIN_ROUTE_NO_SIMD 时始终使用标量实现
+ *          2. 两条路径的结果完全一致，此开关只用于基准测试对比
+ */
+bool SetSimdParsing(bool enabled);
+
+/**
+ * @brief 批量解析内存中的路由文件内容
+ * @param data 文件内容
+ * @param size 内容长度
+ * @param source 来源名称，用于错误提示
+ * @param[out] routes 解析出的前缀追加到此处
+ * @param firstLine 内容中第一行的行号，分块解析时用于输出正确的行号
+ * @param country 只接受该国家代码的 delegated 记录，为空时接受全部
+ * @return size_t 无效行数
+ * @details 1. 按换行符切分，不为每行分配内存
+ *          2. 忽略空行、行首空白、行尾回车以及#开头的注释行
+ *          3. 每行自动识别格式：CIDR("1.0.1.0/24")、地址范围("1.0.1.0-1.0.3.255")
+ *             或RIR delegated 统计行("apnic|CN|ipv4|1.0.1.0|256|20110414|allocated")
+ *          4. 范围和 delegated 记录直接按整数区间转换为最少的前缀，不生成中间文本
+ *          5. 距缓冲区末尾不少于16字节的地址都可以走SIMD路径，不受行长度限制
+ *          6. 无效行以"文件:行号"的格式输出，并继续解析后续行
+ */
+size_t ParseCidrBuffer(const char *data, size_t size, const std::string &source,
+                       RouteSet &routes, size_t firstLine = 1, const std::string &country = std::string());
+
+/**
+ * @brief 待解析的一段内存中的路由文件内容
+ */
+struct ParseInput
+{
+  const char *data;   ///< 文件内容
+  size_t size;        ///< 内容长度
+  std::string source; ///< 来源名称，用于错误提示
+};
+
+/**
+ * @brief 解析指定字节数时实际使用的线程数
+ * @param bytes 所有输入的总字节数
+ * @param jobs 要求的线程数
+ * @return unsigned 不超过 jobs 和硬件线程数，且每个线程至少分到4MB，总量不足8MB时为1
+ */
+unsigned ParseWorkerCount(size_t bytes, unsigned jobs);
+
+/**
+ * @brief 多线程解析多个路由文件内容
+ * @param inputs 各文件内容
+ * @param[out] results 每个输入的解析结果，与 inputs 一一对应
+ * @param jobs 工作线程数
+ * @param country 只接受该国家代码的 delegated 记录，为空时接受全部
+ * @param[out] invalidLines 可选，每个输入的无效行数，与 inputs 一一对应
+ * @return size_t 无效行总数
+ * @details 1. 每个输入在换行符处切成约256KB的块，所有输入的块放入同一个任务列表，
+ *             大文件的多个块和多个小文件可以同时解析；线程数由 ParseWorkerCount 限制
+ *          2. 各块解析到独立的集合，无效行先按块收集，结束后按输入和块的顺序补上行号再输出
+ *          3. 最后按块顺序拼接，结果和输出与逐个文件单线程调用 ParseCidrBuffer 完全一致
+ */
+size_t ParseCidrBuffers(const std::vector<ParseInput> &inputs, std::vector<RouteSet> &results, unsigned jobs,
+                        const std::string &country = std::string(), std::vector<size_t> *invalidLines = nullptr);
+
+/**
+ * @brief 将主机字节序的IPv4地址格式化为点分十进制字符串
+ * @param address 主机字节序的地址
+ * @return std::string 如"192.168.1.0"
+ * @details 仅用于输出，解析和安装路径均不经过字符串
+ */
+std::string FormatIpv4(uint32_t address);
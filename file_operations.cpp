@@ -1,60 +1,280 @@
 #include "file_operations.h"
-#include <fstream>
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
-#include "network_utils.h"
+#include "builtin_routes.h"
+#include "cidr_parser.h"
+#include "hash_utils.h"
+#include "metrics.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "route_aggregate.h"
+#include "route_cache.h"
 
-std::vector<RouteEntry> ReadRoutesFromFile(const std::string &filename)
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
 {
-  std::vector<RouteEntry> routes;
-  std::ifstream file(filename);
-  std::string line;
+  std::string CachePathFor(const std::string &filename, const std::string &country)
+  {
+    if (country.empty())
+    {
+      return filename + ".wrc";
+    }
+    return filename + "." + country + ".wrc";
+  }
 
-  while (std::getline(file, line))
+  // 缓存与源文件一致时从缓存加载
+  bool LoadFromCache(const std::string &filename, const std::string &country, RouteSet &routes)
   {
-    // 跳过空行
-    if (line.empty() || line[0] == '#')
+    MappedFile cache;
+    if (!cache.Open(CachePathFor(filename, country)) || !IsRouteCacheImage(cache.Data(), cache.Size()))
     {
-      continue;
+      return false;
     }
 
-    // 去除行尾可能的回车符
-    if (!line.empty() && line[line.length() - 1] == '\r')
+    RouteSet cached;
+    std::vector<RouteCacheSource> sources;
+    if (!LoadRouteCacheImage(cache.Data(), cache.Size(), cached, &sources) || sources.size() != 1)
     {
-      line = line.substr(0, line.length() - 1);
+      return false;
     }
 
-    RouteEntry entry;
-    // 只解析 CIDR，网关将在后续设置
-    if (ParseCidr(line, entry.destination, entry.mask))
+    // 大小和修改时间都一致时不读取源文件
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(filename, ec);
+    if (ec || size != sources[0].size)
+    {
+      return false;
+    }
+    auto mtime = std::filesystem::last_write_time(filename, ec);
+    if (ec)
     {
-      entry.gateway = "0.0.0.0"; // 默认设置为 0.0.0.0，后续会被实际网关替换
-      entry.metric = 1;          // 默认跳数
-      routes.push_back(entry);
+      return false;
     }
-    else
+    if ((int64_t)mtime.time_since_epoch().count() != sources[0].mtime)
     {
-      std::cout << "Invalid CIDR format: " << line << "\n";
+      // 修改时间变化但内容可能未变，用内容哈希确认
+      RouteCacheSource current;
+      if (!GetRouteCacheSource(filename, current) || current.contentHash != sources[0].contentHash)
+      {
+        return false;
+      }
     }
+
+    routes.Append(cached);
+    return true;
+  }
+}
+
+namespace
+{
+  /**
+   * @brief 单个文件的加载过程
+   */
+  struct FileLoad
+  {
+    bool ok = false;    ///< 文件能够打开
+    bool parse = false; ///< 需要解析文本
+    size_t invalid = 0; ///< 文本中的无效行数
+    MappedFile file;
+    RouteSet routes;
+  };
+
+  /**
+   * @brief 加载多个文件，结果按文件分别保存
+   * @details 1. 先依次处理缓存命中、无法打开和二进制路由集合的文件
+   *          2. 其余文本文件一起交给 ParseCidrBuffers 多线程分块解析
+   *          3. 启用缓存时，各文件的解析结果并行聚合并写入缓存；
+   *             含无效行的文件不写缓存，以后每次加载都会重新解析并提示这些行
+   */
+  void LoadFiles(const std::vector<std::string> &filenames, const LoadOptions &options,
+                 std::vector<FileLoad> &loads)
+  {
+    std::vector<ParseInput> inputs;
+    std::vector<size_t> inputFiles;
+    for (size_t i = 0; i < filenames.size(); i++)
+    {
+      const std::string &filename = filenames[i];
+      FileLoad &load = loads[i];
+
+      // 编译进程序的路由集合，不读取文件
+      if (IsBuiltinRouteName(filename))
+      {
+        load.ok = LoadBuiltinRoutes(filename, load.routes);
+        if (!load.ok)
+        {
+          std::cout << "Unknown builtin route set: " << filename << "\n";
+        }
+        continue;
+      }
+
+      if (options.useCache && LoadFromCache(filename, options.country, load.routes))
+      {
+        load.ok = true;
+        continue;
+      }
+
+      if (!load.file.Open(filename))
+      {
+        std::cout << "Failed to open route file: " << filename << "\n";
+        continue;
+      }
+
+      // 直接传入的二进制路由集合
+      if (IsRouteCacheImage(load.file.Data(), load.file.Size()))
+      {
+        load.ok = LoadRouteCacheImage(load.file.Data(), load.file.Size(), load.routes);
+        if (!load.ok)
+        {
+          std::cout << "Invalid or unsupported route set file: " << filename << "\n";
+        }
+        continue;
+      }
+
+      load.ok = true;
+      load.parse = true;
+      inputs.push_back({load.file.Data(), load.file.Size(), filename});
+      inputFiles.push_back(i);
+    }
+
+    std::vector<RouteSet> parsed;
+    std::vector<size_t> invalid;
+    ParseCidrBuffers(inputs, parsed, options.jobs, options.country, &invalid);
+    for (size_t k = 0; k < inputFiles.size(); k++)
+    {
+      loads[inputFiles[k]].routes = std::move(parsed[k]);
+      loads[inputFiles[k]].invalid = invalid[k];
+    }
+    if (!options.useCache)
+    {
+      return;
+    }
+
+    // 解析后聚合并写入缓存，缓存写入失败不影响本次加载
+    ParallelFor(inputFiles.size(), options.jobs, 1, [&](size_t begin, size_t end, unsigned)
+                {
+      for (size_t k = begin; k < end; k++)
+      {
+        const std::string &filename = filenames[inputFiles[k]];
+        FileLoad &load = loads[inputFiles[k]];
+        AggregateRoutes(load.routes);
+        if (load.invalid > 0)
+        {
+          continue;
+        }
+
+        RouteCacheSource source;
+        std::error_code ec;
+        auto mtime = std::filesystem::last_write_time(filename, ec);
+        if (!ec)
+        {
+          source.size = load.file.Size();
+          source.mtime = (int64_t)mtime.time_since_epoch().count();
+          source.contentHash = HashBytes(load.file.Data(), load.file.Size());
+          WriteRouteCache(CachePathFor(filename, options.country), load.routes, {source});
+        }
+      }
+    });
   }
+}
 
-  return routes;
+bool ReadRoutesFromFile(const std::string &filename, RouteSet &routes, const LoadOptions &options)
+{
+  std::vector<FileLoad> loads(1);
+  LoadFiles({filename}, options, loads);
+  routes.Append(loads[0].routes);
+  return loads[0].ok;
 }
 
-std::vector<RouteEntry> MergeRoutes(const std::vector<std::string> &filenames)
+RouteSet MergeRoutes(const std::vector<std::string> &filenames, const LoadOptions &options,
+                     std::vector<RouteSet> *perFile)
 {
-  std::vector<RouteEntry> allRoutes;
+  ScopedTimer timer("load");
+  std::vector<FileLoad> loads(filenames.size());
+  LoadFiles(filenames, options, loads);
+
+  // 按文件顺序合并，结果与逐个文件读取一致
+  RouteSet allRoutes;
+  size_t total = 0;
+  for (const auto &load : loads)
+  {
+    total += load.routes.Size();
+  }
+  allRoutes.Reserve(total);
 
-  for (const auto &filename : filenames)
+  for (size_t i = 0; i < filenames.size(); i++)
   {
-    std::vector<RouteEntry> routes = ReadRoutesFromFile(filename);
-    if (routes.empty())
+    const std::string &filename = filenames[i];
+    size_t loaded = loads[i].routes.Size();
+    allRoutes.Append(loads[i].routes);
+    if (options.quiet)
+    {
+      continue;
+    }
+    if (loaded == 0)
     {
       std::cout << "Warning: No valid routes found in file: " << filename << "\n";
       continue;
     }
-    std::cout << "Loaded " << routes.size() << " routes from " << filename << "\n";
-    allRoutes.insert(allRoutes.end(), routes.begin(), routes.end());
+    std::cout << "Loaded " << loaded << " routes from " << filename << "\n";
   }
 
+  if (perFile)
+  {
+    perFile->clear();
+    for (auto &load : loads)
+    {
+      perFile->push_back(std::move(load.routes));
+    }
+  }
   return allRoutes;
 }
+
+bool WriteRoutesToFile(const std::string &filename, const RouteSet &routes)
+{
+  std::string text;
+  text.reserve(routes.Size() * 16);
+  for (size_t i = 0; i < routes.Size(); i++)
+  {
+    text += FormatIpv4(routes.networks[i]);
+    text += '/';
+    text += std::to_string(routes.prefixLens[i]);
+    text += '\n';
+  }
+  return WriteFileAtomically(filename, text);
+}
+
+bool WriteFileAtomically(const std::string &filename, const std::string &data)
+{
+  std::string temp = filename + ".tmp";
+  FILE *file = fopen(temp.c_str(), "wb");
+  if (file == NULL)
+  {
+    return false;
+  }
+
+  bool ok = fwrite(data.data(), 1, data.size(), file) == data.size() && fflush(file) == 0;
+#ifdef _WIN32
+  ok = ok && _commit(_fileno(file)) == 0;
+#else
+  ok = ok && fsync(fileno(file)) == 0;
+#endif
+  ok = (fclose(file) == 0) && ok;
+
+  std::error_code ec;
+  if (ok)
+  {
+    std::filesystem::rename(temp, filename, ec);
+    ok = !ec;
+  }
+  if (!ok)
+  {
+    std::filesystem::remove(temp, ec);
+  }
+  return ok;
+}
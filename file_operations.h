@@ -4,22 +4,62 @@
 #include <string>
 
 /**
- * @brief 从文件读取路由条目
- * @param filename 路由文件路径
- * @return vector<RouteEntry> 读取到的路由条目列表
- * @details 1. 逐行读取文件内容
- *          2. 跳过空行和注释行(#开头)
- *          3. 解析CIDR格式的路由
- *          4. 设置默认网关为0.0.0.0(后续会被实际网关替换)
+ * @brief 路由文件加载选项
  */
-std::vector<RouteEntry> ReadRoutesFromFile(const std::string &filename);
+struct LoadOptions
+{
+  bool useCache = true; ///< 是否读写源文件旁的二进制缓存(<文件名>.wrc)
+  bool quiet = false;   ///< 不输出每个文件的加载统计
+  std::string country;  ///< delegated 统计文件只取该国家代码的记录，为空时全部接受
+  unsigned jobs = 1;    ///< 解析文本的线程数，大文件分块、多个文件同时解析
+};
 
 /**
- * @brief 合并多个文件中的路由条目
+ * @brief 从文件读取路由前缀
+ * @param filename 路由文件路径，可以是文本文件、compile 生成的二进制路由集合或 builtin:<name> 内置集合
+ * @param[out] routes 读取到的前缀追加到此处
+ * @param options 加载选项
+ * @return bool 文件能够打开返回true，否则返回false
+ * @details 1. 启用缓存且缓存与源文件一致时，直接映射缓存文件，不再解析文本
+ *          2. 以缓存魔数开头的输入按二进制路由集合加载
+ *          3. 否则将整个文件映射到内存，在换行符处分块后按 options.jobs 多线程解析，跳过空行和注释行(#开头)
+ *          4. 直接生成(network, prefixLen)记录，不产生逐行的字符串
+ *          5. 无效行会带文件名和行号输出，但不会中断解析
+ *          6. 启用缓存时，文本解析结果聚合后写入缓存供下次使用，
+ *             指定国家时缓存为<文件名>.<国家>.wrc，与不过滤的结果分开保存
+ */
+bool ReadRoutesFromFile(const std::string &filename, RouteSet &routes,
+                        const LoadOptions &options = LoadOptions());
+
+/**
+ * @brief 合并多个文件中的路由前缀
  * @param filenames 路由文件名列表
- * @return 合并后的路由条目列表
- * @details 1. 依次读取每个文件中的路由
- *          2. 跳过无效的路由文件
- *          3. 提供每个文件的加载统计信息
+ * @param options 加载选项
+ * @param[out] perFile 可选，按 filenames 的顺序保存每个文件各自的前缀
+ * @return 合并后的路由前缀集合
+ * @details 1. 所有文本文件的块一起多线程解析，小文件不必等待大文件
+ *          2. 结果按文件顺序合并，与逐个读取的结果一致
+ *          3. 跳过无效的路由文件
+ *          4. 提供每个文件的加载统计信息
+ */
+RouteSet MergeRoutes(const std::vector<std::string> &filenames,
+                     const LoadOptions &options = LoadOptions(), std::vector<RouteSet> *perFile = nullptr);
+
+/**
+ * @brief 把前缀集合写为文本路由文件
+ * @param filename 目标文件路径
+ * @param routes 前缀集合
+ * @return bool 写入成功返回true
+ * @details 每行一个CIDR，格式与输入的路由文件相同，通过 WriteFileAtomically 写入
+ */
+bool WriteRoutesToFile(const std::string &filename, const RouteSet &routes);
+
+/**
+ * @brief 以替换方式写入文件
+ * @param filename 目标文件路径
+ * @param data 文件内容
+ * @return bool 写入成功返回true
+ * @details 先写入同目录下的临时文件并刷新到磁盘，再重命名覆盖目标文件，
+ *          写入过程中崩溃时目标文件保持旧内容或新内容之一
  */
-std::vector<RouteEntry> MergeRoutes(const std::vector<std::string> &filenames);
+bool WriteFileAtomically(const std::string &filename, const std::string &data);
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/// FNV-1a 64位初始值
+const uint64_t HASH_SEED = 0xCBF29CE484222325ull;
+
+/**
+ * @brief 计算字节序列的64位FNV-1a哈希
+ * @param data 数据起始地址
+ * @param size 数据长度
+ * @param seed 初始值，传入上一段的结果即可对多段数据连续计算
+ * @return uint64_t 哈希值
+ * @details 用于判断文件内容或路由集合是否变化，不用于安全场景
+ */
+inline uint64_t HashBytes(const void *data, size_t size, uint64_t seed = HASH_SEED)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  uint64_t hash = seed;
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= p[i];
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
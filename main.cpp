@@ -1,8 +1,29 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
 #include "types.h"
 #include "route_operations.h"
 #include "file_operations.h"
+#include "metrics.h"
 #include "network_utils.h"
+#include "cidr_parser.h"
+#include "builtin_routes.h"
+#include "route_aggregate.h"
+#include "route_sync.h"
+#include "route_cache.h"
+#include "route_lpm.h"
+#include "route_patch.h"
+#include "route_repoint.h"
+#include "route_set_ops.h"
+#include "route_state.h"
+#include "route_sources.h"
+#include "route_stream.h"
+#include "route_watch.h"
+#include "windows_backend.h"
 
 #pragma comment(lib, "iphlpapi.lib")
 #pragma comment(lib, "ws2_32.lib")
@@ -14,11 +35,29 @@
  * @return 0表示成功，1表示失败
  * @details 支持以下命令：
  *          1. add    - 添加路由(需要指定default使用默认网关)
- *          2. delete - 删除路由
- *          3. reset  - 重置路由表(保留默认路由)
+ *          2. delete - 删除路由(不带文件时删除本工具安装的全部路由)
+ *          3. reset  - 删除本工具安装的路由，--all 时删除所有非默认路由
+ *          4. sync   - 增量同步，只添加缺少的路由并删除本工具安装的多余路由
+ *          5. compile - 将路由文件编译为排序聚合后的二进制路由集合，--format cpp 时生成内置路由集合的源文件
+ *          6. lookup - 查询地址是走默认网关(命中路由文件)还是走隧道
+ *          7. watch  - 常驻运行，路由文件或默认网关变化时增量同步
+ *          8. repoint - 把旧网关上的路由逐条切换到当前默认网关
+ *          9. set    - 路由文件的并、交、差和补运算
+ *          10. diff  - 生成两个版本路由列表之间的差异文件
+ *          11. apply-patch - 按差异文件只安装和删除变化的前缀
  *
  *          用法示例：
  *          win-route add file1.txt file2.txt default
+ *          win-route sync file1.txt file2.txt default
+ *          win-route compile file1.txt file2.txt -o set.bin
+ *          win-route compile --format cpp ip_segment_file/chnroute.txt -o builtin_routes.inc
+ *          win-route add builtin:chnroute default
+ *          win-route lookup file1.txt file2.txt -- 1.0.1.1 8.8.8.8
+ *          win-route watch file1.txt file2.txt
+ *          win-route repoint 192.168.1.1 default
+ *          win-route set subtract chnroute.txt custom.txt -o out.txt
+ *          win-route diff chnroute-old.txt chnroute.txt -o chnroute.patch
+ *          win-route apply-patch chnroute.patch
  *          win-route delete file1.txt file2.txt
  *          win-route reset
  */
@@ -28,75 +67,889 @@ void PrintUsage()
 {
   std::cout << "Usage:\n"
             << "  win-route add <file1.txt> [file2.txt ...] default   - Add routes from files using default gateway\n"
-            << "  win-route delete <file1.txt> [file2.txt ...]        - Delete routes from files\n"
-            << "  win-route reset                                     - Reset routing table\n"
+            << "  win-route delete [file1.txt file2.txt ...]          - Delete installed routes (only those in the files if given)\n"
+            << "  win-route reset                                     - Delete every route win-route installed\n"
+            << "  win-route sync <file1.txt> [file2.txt ...] default  - Apply only the difference against the current table\n"
+            << "  win-route compile <file1.txt> [file2.txt ...] -o set.bin - Build a binary route set usable as add/delete input\n"
+            << "  win-route compile --format cpp <file1.txt> [...] -o builtin_routes.inc - Generate route sets to build in\n"
+            << "  win-route lookup <file1.txt> [file2.txt ...] [-- <ip> ...] - Classify addresses (from stdin if none given)\n"
+            << "  win-route watch <file1.txt> [file2.txt ...]         - Keep routes in sync with the files and the default gateway\n"
+            << "  win-route repoint <old-gateway> default             - Move routes on the old gateway to the default gateway\n"
+            << "  win-route set union|intersect|subtract|complement <file1.txt> [file2.txt ...] -o out.txt\n"
+            << "                                                      - Combine route files (subtract: first minus the rest)\n"
+            << "  win-route diff <old.txt> <new.txt> -o list.patch    - Write the prefixes added and removed between two list versions\n"
+            << "  win-route apply-patch <list.patch>                  - Update an added list by a patch, touching only changed routes\n"
+            << "\nOptions:\n"
+            << "  --no-aggregate   Install prefixes exactly as listed, without merging\n"
+            << "  --jobs N         Number of worker threads for parsing and route installation (default 1)\n"
+            << "  --no-cache       Do not read or write <file>.wrc parse caches next to the route files\n"
+            << "  --max-routes N   Merge the cheapest prefixes until at most N routes remain (covers a little extra space)\n"
+            << "  --country CC     Only take records of country CC from delegated-stats files (e.g. CN)\n"
+            << "  --priority FILE  add: install the prefixes with the most hits in FILE (\"address [count]\" lines) first\n"
+            << "  --format cpp     compile: write C++ arrays (one set per file) for a -DWIN_ROUTE_BUILTIN build\n"
+            << "  --stream         add: install routes while the files are still being read (no aggregation)\n"
+            << "  --force          add: reinstall even if the merged routes and gateway are unchanged since the last add\n"
+            << "  --metrics json[=PATH] Print phase timings and backend call histograms as JSON (to PATH if given)\n"
+            << "  --all            reset/delete/repoint: act on the whole routing table instead of installed routes\n"
+            << "  --state PATH     File recording installed routes (default: win-route.state next to the executable)\n"
+            << "  --interval MS    watch: how often files and the default gateway are checked (default 2000)\n"
+            << "  --debounce MS    watch: quiet period before changes are applied (default 500)\n"
             << "\nFile format example:\n"
             << "1.0.1.0/24\n"
             << "1.0.2.0/23\n"
             << "1.0.8.0/21\n";
 }
 
+namespace
+{
+  // 输出一个地址的查询结果：命中的前缀走默认网关(direct)，否则走隧道(tunnel)
+  void AppendLookupResult(std::string &out, const RouteSet &routes, const PrefixMatcher &matcher,
+                          uint32_t address)
+  {
+    out += FormatIpv4(address);
+    uint32_t match = matcher.Lookup(address);
+    if (match == PrefixMatcher::NO_MATCH)
+    {
+      out += "\t-\ttunnel\n";
+      return;
+    }
+    out += '\t';
+    out += FormatIpv4(routes.networks[match]);
+    out += '/';
+    out += std::to_string(routes.prefixLens[match]);
+    out += "\tdirect\n";
+  }
+
+  /**
+   * @brief 执行 lookup 命令
+   * @param routes 合并后的路由集合
+   * @param addresses 命令行给出的地址，为空时从标准输入逐行读取
+   * @return int 0表示全部地址有效
+   * @details 标准输入模式按块读取，每行取第一个字段作为地址，结果按块批量输出
+   */
+  int RunLookup(const RouteSet &routes, const std::vector<std::string> &addresses)
+  {
+    PrefixMatcher matcher;
+    matcher.Build(routes);
+
+    std::string out;
+    int status = 0;
+    auto classify = [&](const char *begin, const char *end)
+    {
+      // 跳过行首空白，取第一个字段
+      while (begin < end && (*begin == ' ' || *begin == '\t'))
+        begin++;
+      if (begin == end || *begin == '\r')
+        return;
+      const char *p = begin;
+      uint32_t address;
+      if (ParseIpv4(p, end, address) && (p == end || *p == ' ' || *p == '\t' || *p == '\r' || *p == ','))
+      {
+        AppendLookupResult(out, routes, matcher, address);
+      }
+      else
+      {
+        const char *fieldEnd = begin;
+        while (fieldEnd < end && *fieldEnd != ' ' && *fieldEnd != '\t' && *fieldEnd != '\r')
+          fieldEnd++;
+        out.append(begin, fieldEnd);
+        out += "\tinvalid\n";
+        status = 1;
+      }
+    };
+
+    if (!addresses.empty())
+    {
+      for (const auto &address : addresses)
+      {
+        classify(address.data(), address.data() + address.size());
+      }
+      fwrite(out.data(), 1, out.size(), stdout);
+      return status;
+    }
+
+    // 从标准输入按块读取，行可能跨越两个块
+    std::vector<char> buffer(1 << 16);
+    std::string pending;
+    size_t readBytes;
+    while ((readBytes = fread(buffer.data(), 1, buffer.size(), stdin)) > 0)
+    {
+      const char *cur = buffer.data();
+      const char *end = cur + readBytes;
+      while (cur < end)
+      {
+        const char *newline = (const char *)memchr(cur, '\n', (size_t)(end - cur));
+        if (newline == nullptr)
+        {
+          pending.append(cur, end);
+          break;
+        }
+        if (!pending.empty())
+        {
+          pending.append(cur, newline);
+          classify(pending.data(), pending.data() + pending.size());
+          pending.clear();
+        }
+        else
+        {
+          classify(cur, newline);
+        }
+        cur = newline + 1;
+      }
+      if (out.size() >= (1 << 16))
+      {
+        fwrite(out.data(), 1, out.size(), stdout);
+        out.clear();
+      }
+    }
+    if (!pending.empty())
+    {
+      classify(pending.data(), pending.data() + pending.size());
+    }
+    fwrite(out.data(), 1, out.size(), stdout);
+    return status;
+  }
+
+  /**
+   * @brief 执行 set 命令
+   * @param args 位置参数：set、运算名和文件列表
+   * @param outputPath 输出文件
+   * @param options 文件加载选项
+   * @return int 退出码
+   * @details 每个文件转换为有序区间后做线性归并：
+   *          1. union/intersect 依次作用于所有文件
+   *          2. subtract 从第一个文件中减去其余所有文件
+   *          3. complement 求所有文件并集的补集
+   *          结果转换为最少的CIDR写入文本文件，0.0.0.0/0 拆成两个/1，避免与默认路由冲突
+   */
+  int RunSetOperation(const std::vector<std::string> &args, const std::string &outputPath,
+                      const LoadOptions &options)
+  {
+    if (args.size() < 3)
+    {
+      PrintUsage();
+      return 1;
+    }
+    const std::string &operation = args[1];
+    if (operation != "union" && operation != "intersect" && operation != "subtract" && operation != "complement")
+    {
+      std::cout << "Unknown set operation: " << operation << "\n";
+      return 1;
+    }
+    if (outputPath.empty())
+    {
+      std::cout << "Please specify the output file with -o.\n";
+      return 1;
+    }
+
+    std::vector<AddressRange> result;
+    std::vector<AddressRange> ranges;
+    for (size_t i = 2; i < args.size(); i++)
+    {
+      RouteSet routes;
+      if (!ReadRoutesFromFile(args[i], routes, options))
+      {
+        return 1;
+      }
+      RoutesToRanges(routes, ranges);
+
+      if (i == 2)
+        result = ranges;
+      else if (operation == "intersect")
+        result = IntersectRanges(result, ranges);
+      else if (operation == "subtract")
+        result = SubtractRanges(result, ranges);
+      else
+        result = UnionRanges(result, ranges);
+    }
+    if (operation == "complement")
+    {
+      result = ComplementRanges(result);
+    }
+
+    RouteSet routes;
+    RangesToRoutes(result, routes);
+    if (routes.Size() == 1 && routes.prefixLens[0] == 0)
+    {
+      routes.Clear();
+      routes.Add(0, 1);
+      routes.Add(0x80000000u, 1);
+    }
+    if (!WriteRoutesToFile(outputPath, routes))
+    {
+      std::cout << "Failed to write route file: " << outputPath << "\n";
+      return 1;
+    }
+    std::cout << "Wrote " << routes.Size() << " routes into " << outputPath << "\n";
+    return 0;
+  }
+
+  /**
+   * @brief 执行 diff 命令
+   * @param args 位置参数：diff、旧版本文件和新版本文件
+   * @param outputPath 差异文件
+   * @param options 文件加载选项
+   * @return int 退出码
+   * @details 两个版本分别聚合后有序归并，差异和两个版本的哈希写入二进制差异文件
+   */
+  int RunDiff(const std::vector<std::string> &args, const std::string &outputPath, const LoadOptions &options)
+  {
+    if (args.size() != 3)
+    {
+      PrintUsage();
+      return 1;
+    }
+    if (outputPath.empty())
+    {
+      std::cout << "Please specify the output file with -o.\n";
+      return 1;
+    }
+
+    RouteSet versions[2];
+    for (int k = 0; k < 2; k++)
+    {
+      if (!ReadRoutesFromFile(args[1 + k], versions[k], options))
+      {
+        return 1;
+      }
+      AggregateRoutes(versions[k]);
+    }
+
+    RoutePatch patch = DiffRouteSets(versions[0], versions[1]);
+    if (!WriteRoutePatch(outputPath, patch))
+    {
+      std::cout << "Failed to write patch file: " << outputPath << "\n";
+      return 1;
+    }
+    std::cout << "Wrote patch " << outputPath << ": " << versions[0].Size() << " -> " << versions[1].Size()
+              << " routes (removed " << patch.removed.Size() << ", added " << patch.added.Size() << ")\n";
+    return 0;
+  }
+}
+
 int main(int argc, char *argv[])
 {
-  if (argc < 2)
+  // 分离选项参数和位置参数
+  std::vector<std::string> args;
+  bool aggregate = true;
+  bool useCache = true;
+  unsigned jobs = 1;
+  unsigned intervalMs = 2000;
+  unsigned debounceMs = 500;
+  bool allRoutes = false;
+  bool stream = false;
+  bool force = false;
+  size_t maxRoutes = 0;
+  std::string outputPath;
+  std::string format = "bin";
+  std::string country;
+  std::string priorityPath;
+  std::string statePath = DefaultRouteStatePath(argv[0]);
+  std::string metricsTarget;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--")
+    {
+      // 之后的参数都不再作为选项解析
+      for (; i < argc; i++)
+      {
+        args.push_back(argv[i]);
+      }
+      break;
+    }
+    else if (arg == "--no-aggregate")
+    {
+      aggregate = false;
+    }
+    else if (arg == "--no-cache")
+    {
+      useCache = false;
+    }
+    else if (arg == "-o")
+    {
+      if (i + 1 >= argc)
+      {
+        std::cout << "-o requires an output path.\n";
+        return 1;
+      }
+      outputPath = argv[++i];
+    }
+    else if (arg == "--format")
+    {
+      if (i + 1 >= argc || (std::string(argv[i + 1]) != "bin" && std::string(argv[i + 1]) != "cpp"))
+      {
+        std::cout << "--format requires bin or cpp.\n";
+        return 1;
+      }
+      format = argv[++i];
+    }
+    else if (arg == "--metrics")
+    {
+      std::string metricsFormat = i + 1 < argc ? argv[i + 1] : "";
+      if (metricsFormat != "json" && metricsFormat.compare(0, 5, "json=") != 0)
+      {
+        std::cout << "--metrics requires json or json=PATH.\n";
+        return 1;
+      }
+      i++;
+      metricsTarget = metricsFormat == "json" ? "-" : metricsFormat.substr(5);
+    }
+    else if (arg == "--max-routes")
+    {
+      if (i + 1 >= argc || atoi(argv[i + 1]) <= 0)
+      {
+        std::cout << "--max-routes requires a positive number.\n";
+        return 1;
+      }
+      maxRoutes = (size_t)atoi(argv[++i]);
+    }
+    else if (arg == "--country")
+    {
+      if (i + 1 >= argc)
+      {
+        std::cout << "--country requires a country code.\n";
+        return 1;
+      }
+      country = argv[++i];
+    }
+    else if (arg == "--priority")
+    {
+      if (i + 1 >= argc)
+      {
+        std::cout << "--priority requires a hit count file.\n";
+        return 1;
+      }
+      priorityPath = argv[++i];
+    }
+    else if (arg == "--stream")
+    {
+      stream = true;
+    }
+    else if (arg == "--force")
+    {
+      force = true;
+    }
+    else if (arg == "--all")
+    {
+      allRoutes = true;
+    }
+    else if (arg == "--state")
+    {
+      if (i + 1 >= argc)
+      {
+        std::cout << "--state requires a file path.\n";
+        return 1;
+      }
+      statePath = argv[++i];
+    }
+    else if (arg == "--interval" || arg == "--debounce")
+    {
+      if (i + 1 >= argc || !isdigit((unsigned char)argv[i + 1][0]))
+      {
+        std::cout << arg << " requires a number of milliseconds.\n";
+        return 1;
+      }
+      unsigned value = (unsigned)atoi(argv[++i]);
+      (arg == "--interval" ? intervalMs : debounceMs) = value;
+    }
+    else if (arg == "--jobs")
+    {
+      if (i + 1 >= argc || atoi(argv[i + 1]) <= 0)
+      {
+        std::cout << "--jobs requires a positive number.\n";
+        return 1;
+      }
+      jobs = (unsigned)atoi(argv[++i]);
+    }
+    else
+    {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.empty())
   {
     PrintUsage();
     return 1;
   }
 
-  std::string command = argv[1];
+  // 启用指标时包装后端记录每次调用，报告在 main 返回时输出
+  if (!metricsTarget.empty())
+  {
+    Metrics::Get().Enable();
+  }
+  MetricsReport report(metricsTarget);
+  ScopedTimer totalTimer("total");
+
+  std::string command = args[0];
+  WindowsRouteBackend windowsBackend;
+  InstrumentedBackend instrumentedBackend(windowsBackend);
+  RouteBackend &backend = Metrics::Get().Enabled() ? (RouteBackend &)instrumentedBackend : windowsBackend;
+  RouteTableSnapshot snapshot(backend);
 
-  if (command == "reset")
+  // 读取本工具安装的路由记录
+  RouteState state;
+  bool hasState = LoadRouteState(statePath, state);
+
+  if (command == "reset" && allRoutes)
   {
-    ResetRoutes();
+    ResetRoutes(snapshot, jobs);
+    if (hasState)
+    {
+      state.routes.Clear();
+      ClearRouteSources(state);
+      SaveRouteState(statePath, state);
+    }
     std::cout << "Routing table has been reset.\n";
     return 0;
   }
 
+  // reset 和不带文件的 delete 只删除记录中的路由，不读取路由表
+  if (command == "reset" || (command == "delete" && args.size() == 1 && !allRoutes))
+  {
+    if (!hasState)
+    {
+      std::cout << "No installed routes recorded in " << statePath << ".\n"
+                << "Use --all to delete every non-default route.\n";
+      return 1;
+    }
+    bool ok = DeleteOwnedRoutes(snapshot, state, nullptr, jobs);
+    ClearRouteSources(state);
+    if (!SaveRouteState(statePath, state))
+    {
+      std::cout << "Failed to write state file: " << statePath << "\n";
+      return 1;
+    }
+    return ok ? 0 : 1;
+  }
+
   // 检查是否至少有一个文件参数
-  if (argc < 3)
+  if (args.size() < 2)
   {
     PrintUsage();
     return 1;
   }
 
+  if (command == "repoint")
+  {
+    uint32_t oldGateway = 0;
+    const char *p = args[1].c_str();
+    const char *end = p + args[1].size();
+    if (args.size() != 3 || args[2] != "default" || !ParseIpv4(p, end, oldGateway) || p != end)
+    {
+      PrintUsage();
+      return 1;
+    }
+
+    DefaultGatewayInfo defaultInfo = GetDefaultGateway(snapshot);
+    if (!defaultInfo.valid)
+    {
+      std::cout << "Failed to get default gateway information.\n";
+      return 1;
+    }
+    std::cout << "Repointing routes from " << FormatIpv4(oldGateway) << " to " << FormatIpv4(defaultInfo.gateway)
+              << " (ifIndex: " << defaultInfo.ifIndex << ")" << "\n";
+
+    // 默认只切换记录在旧网关上的路由，--all 时切换旧网关上的全部静态路由
+    bool recorded = hasState && state.gateway == oldGateway;
+    RouteSet none;
+    const RouteSet *owned = allRoutes ? nullptr : recorded ? &state.routes : &none;
+    if (owned == &none)
+    {
+      std::cout << "No routes are recorded on " << FormatIpv4(oldGateway)
+                << ". Use --all to move every static route on it.\n";
+    }
+    RepointResult result = RepointRoutes(snapshot, oldGateway, 0, defaultInfo.gateway, defaultInfo.ifIndex,
+                                         defaultInfo.metric, jobs, owned);
+    // 有切换失败的路由时记录保持在旧网关上，reset 仍能找到它们，再次 repoint 时重试
+    if (recorded && result.failures.failed == 0)
+    {
+      state.gateway = defaultInfo.gateway;
+      state.ifIndex = defaultInfo.ifIndex;
+      state.metric = defaultInfo.metric;
+      SaveRouteState(statePath, state);
+    }
+    else if (recorded)
+    {
+      std::cout << "Some routes could not be moved, the state file still records them on " << FormatIpv4(oldGateway)
+                << ". Run repoint again to retry.\n";
+    }
+    if (result.failures.failed > 0)
+    {
+      std::cout << "Errors:\n";
+      for (const auto &item : result.failures.errors)
+      {
+        std::cout << "  [" << item.first << "] x" << item.second << ": " << backend.DescribeError(item.first) << "\n";
+      }
+    }
+    std::cout << "\nRoute Repoint Summary:\n"
+              << "Routes on old gateway: " << result.matched << "\n"
+              << "Moved: " << result.moved << "\n"
+              << "Metric updated: " << result.updated << "\n"
+              << "Already up to date: " << result.unchanged << "\n"
+              << "Failed: " << result.failures.failed << "\n";
+    return result.failures.failed == 0 ? 0 : 1;
+  }
+
+  if (command == "set")
+  {
+    LoadOptions setOptions;
+    setOptions.useCache = useCache;
+    setOptions.country = country;
+    setOptions.jobs = jobs;
+    return RunSetOperation(args, outputPath, setOptions);
+  }
+
+  if (command == "diff")
+  {
+    LoadOptions diffOptions;
+    diffOptions.useCache = useCache;
+    diffOptions.country = country;
+    diffOptions.jobs = jobs;
+    return RunDiff(args, outputPath, diffOptions);
+  }
+
+  // 差异的旧版本必须是已登记的某个文件(聚合后哈希相同)，该文件的登记换成新版本后只应用变化
+  if (command == "apply-patch")
+  {
+    RoutePatch patch;
+    if (args.size() != 2)
+    {
+      PrintUsage();
+      return 1;
+    }
+    if (!ReadRoutePatch(args[1], patch))
+    {
+      std::cout << "Invalid or unsupported patch file: " << args[1] << "\n";
+      return 1;
+    }
+
+    int base = -1;
+    RouteSet baseRoutes;
+    for (size_t i = 0; hasState && i < state.sources.size() && base < 0; i++)
+    {
+      baseRoutes = SourceRoutes(state, i);
+      AggregateRoutes(baseRoutes);
+      if (HashRouteSet(baseRoutes) == patch.baseHash)
+      {
+        base = (int)i;
+      }
+    }
+    if (base < 0)
+    {
+      std::cout << "The patch base does not match any route file recorded in " << statePath << ".\n"
+                << "Run 'win-route add <base list> default' first.\n";
+      return 1;
+    }
+    RouteSet target;
+    if (!ApplyRoutePatch(baseRoutes, patch, target))
+    {
+      std::cout << "Patch does not lead from its base to its target list: " << args[1] << "\n";
+      return 1;
+    }
+
+    DefaultGatewayInfo defaultInfo = GetDefaultGateway(snapshot);
+    if (!defaultInfo.valid)
+    {
+      std::cout << "Failed to get default gateway information.\n";
+      return 1;
+    }
+    if (!state.routes.Empty() && (state.gateway != defaultInfo.gateway || state.ifIndex != defaultInfo.ifIndex))
+    {
+      std::cout << "Installed routes are recorded on gateway " << FormatIpv4(state.gateway)
+                << ". Run 'win-route repoint " << FormatIpv4(state.gateway) << " default' or 'win-route reset' first.\n";
+      return 1;
+    }
+
+    SourceOptions patchOptions;
+    patchOptions.aggregate = aggregate;
+    patchOptions.maxRoutes = maxRoutes;
+    std::string source = state.sources[base];
+    std::cout << "Patching " << source << ": removed " << patch.removed.Size() << ", added " << patch.added.Size()
+              << "\n";
+    state.gateway = defaultInfo.gateway;
+    state.ifIndex = defaultInfo.ifIndex;
+    state.metric = defaultInfo.metric;
+    SetRouteSource(state, source, target);
+    return ApplyTrackedRoutes(snapshot, state, statePath, patchOptions, jobs) ? 0 : 1;
+  }
+
   // 收集所有文件名
   std::vector<std::string> filenames;
-  int lastFileIndex = argc;
+  size_t lastFileIndex = args.size();
 
-  if (command == "add")
+  if (command == "watch")
+  {
+    // watch 总是使用默认网关，末尾的 default 可省略
+    if (args.back() == "default")
+    {
+      lastFileIndex = args.size() - 1;
+    }
+  }
+  else if (command == "add" || command == "sync")
   {
-    // add 命令需要 default 参数
-    if (std::string(argv[argc - 1]) != "default")
+    // add 和 sync 命令需要 default 参数
+    if (args.back() != "default")
     {
       std::cout << "Please specify 'default' to use the system default gateway.\n";
       return 1;
     }
-    lastFileIndex = argc - 1; // 排除 default 参数
+    lastFileIndex = args.size() - 1; // 排除 default 参数
+  }
+
+  // lookup 命令中 -- 之后为要查询的地址
+  std::vector<std::string> addresses;
+  if (command == "lookup")
+  {
+    for (size_t i = 1; i < args.size(); i++)
+    {
+      if (args[i] == "--")
+      {
+        addresses.assign(args.begin() + i + 1, args.end());
+        lastFileIndex = i;
+        break;
+      }
+    }
   }
 
-  // 收集所有文件名（从 argv[2] 到 lastFileIndex-1）
-  for (int i = 2; i < lastFileIndex; i++)
+  // 收集所有文件名（从 args[1] 到 lastFileIndex-1）
+  for (size_t i = 1; i < lastFileIndex; i++)
   {
-    filenames.push_back(argv[i]);
+    filenames.push_back(args[i]);
   }
 
-  // 合并所有文件中的路由
-  std::vector<RouteEntry> routes = MergeRoutes(filenames);
+  if (command == "watch")
+  {
+    WatchOptions watchOptions;
+    watchOptions.debounceMs = debounceMs;
+    watchOptions.aggregate = aggregate;
+    watchOptions.jobs = jobs;
+    watchOptions.maxRoutes = maxRoutes;
+    watchOptions.statePath = statePath;
+    watchOptions.load.useCache = useCache && aggregate;
+    watchOptions.load.country = country;
+    watchOptions.load.jobs = jobs;
+
+    // 路由表没有变化通知时不重新读取，空闲时每次轮询只检查文件状态
+    PollingEventSource source(
+        filenames, [&]()
+        {
+          snapshot.Update();
+          return snapshot.DefaultRoute(); },
+        intervalMs);
+    RouteWatcher watcher(snapshot, filenames, watchOptions);
+    std::cout << "Watching " << filenames.size() << " files, press Ctrl+C to stop.\n";
+    return watcher.Run(source) ? 0 : 1;
+  }
 
-  if (routes.empty())
+  // 流水线安装：先取网关，再边解析边安装
+  if (command == "add" && stream)
+  {
+    if (!priorityPath.empty())
+    {
+      std::cout << "--priority is ignored with --stream, routes are installed in file order.\n";
+    }
+    DefaultGatewayInfo defaultInfo = GetDefaultGateway(snapshot);
+    if (!defaultInfo.valid)
+    {
+      std::cout << "Failed to get default gateway information.\n";
+      return 1;
+    }
+    std::cout << "Using default gateway: " << FormatIpv4(defaultInfo.gateway)
+              << " (ifIndex: " << defaultInfo.ifIndex << ")" << "\n";
+
+    bool sameGateway = !hasState || state.routes.Empty() ||
+                       (state.gateway == defaultInfo.gateway && state.ifIndex == defaultInfo.ifIndex);
+    if (!sameGateway)
+    {
+      std::cout << "Installed routes are recorded on gateway " << FormatIpv4(state.gateway)
+                << ". Run 'win-route repoint " << FormatIpv4(state.gateway) << " default' or 'win-route reset' first.\n";
+      return 1;
+    }
+
+    // 每批安装之前先写入记录，中途崩溃时 reset 仍能找到已安装的路由；完成后只保留实际创建的
+    state.gateway = defaultInfo.gateway;
+    state.ifIndex = defaultInfo.ifIndex;
+    state.metric = defaultInfo.metric;
+    RouteSet owned = state.routes;
+    StreamOptions streamOptions;
+    streamOptions.jobs = jobs;
+    streamOptions.country = country;
+    streamOptions.beforeBatch = [&](const RouteSet &batch)
+    {
+      state.routes.Append(batch);
+      if (!SaveRouteState(statePath, state))
+      {
+        std::cout << "Failed to write state file: " << statePath << ", stopping before the next batch.\n";
+        return false;
+      }
+      return true;
+    };
+    RouteSet installed;
+    StreamResult result = StreamRoutes(backend, filenames, defaultInfo.gateway, defaultInfo.ifIndex,
+                                       defaultInfo.metric, streamOptions, &installed);
+    snapshot.Invalidate();
+
+    state.routes = std::move(owned);
+    state.routes.Append(installed);
+    SaveRouteState(statePath, state);
+
+    if (result.install.failed > 0)
+    {
+      std::cout << "Some routes failed to add:\n";
+      for (const auto &item : result.install.errors)
+      {
+        std::cout << "  [" << item.first << "] x" << item.second << ": " << backend.DescribeError(item.first) << "\n";
+      }
+    }
+    std::cout << "\nRoute Addition Summary:\n"
+              << "Total routes: " << result.parsed << "\n"
+              << "Successfully added: " << result.install.succeeded << "\n"
+              << "Failed: " << result.install.failed << "\n";
+    if (result.firstRouteMs >= 0)
+    {
+      std::cout << "First route installed after " << result.firstRouteMs << " ms\n";
+    }
+    return result.install.failed == 0 && !result.stopped ? 0 : 1;
+  }
+
+  // 删除的文件都已登记时，按来源位计算变化，不需要重新解析这些文件
+  SourceOptions sourceOptions;
+  sourceOptions.aggregate = aggregate;
+  sourceOptions.maxRoutes = maxRoutes;
+
+  HitCounts hits;
+  if (!priorityPath.empty() && command == "add")
+  {
+    if (!ReadHitCounts(priorityPath, hits))
+    {
+      return 1;
+    }
+    sourceOptions.hits = &hits;
+  }
+  if (command == "delete" && hasState && !allRoutes &&
+      std::all_of(filenames.begin(), filenames.end(), [&](const std::string &filename)
+                  { return HasRouteSource(state, filename); }))
+  {
+    for (const auto &filename : filenames)
+    {
+      RemoveRouteSource(state, filename);
+    }
+    std::cout << "Removing " << filenames.size() << " recorded route files, " << state.sources.size()
+              << " remain.\n";
+    return ApplyTrackedRoutes(snapshot, state, statePath, sourceOptions, jobs) ? 0 : 1;
+  }
+
+  // 合并所有文件中的路由，缓存中保存的是聚合后的结果，不聚合时不使用缓存
+  LoadOptions loadOptions;
+  loadOptions.useCache = useCache && aggregate;
+  loadOptions.country = country;
+  loadOptions.jobs = jobs;
+  loadOptions.quiet = command == "lookup"; // lookup 的输出可能被管道处理，不输出加载统计
+  std::vector<RouteSet> perFile;
+  RouteSet routes = MergeRoutes(filenames, loadOptions, &perFile);
+
+  if (routes.Empty())
   {
     std::cout << "No valid routes found in any of the input files.\n";
     return 1;
   }
 
-  if (command == "add")
+  // 聚合重复、被覆盖和相邻的前缀；add 安装的是全部登记来源的合并结果，由 ApplyTrackedRoutes 计算并输出
+  if (aggregate && command != "add")
+  {
+    size_t before = routes.Size();
+    size_t saved = AggregateRoutes(routes);
+    if (!loadOptions.quiet)
+      std::cout << "Aggregated " << before << " routes into " << routes.Size()
+                << " (saved " << saved << ")\n";
+  }
+
+  // 路由条数上限：近似合并，多覆盖的地址数精确输出
+  if (maxRoutes > 0 && routes.Size() > maxRoutes && command != "add")
+  {
+    size_t before = routes.Size();
+    BudgetResult budget = LimitRoutes(routes, maxRoutes);
+    if (!loadOptions.quiet)
+      std::cout << "Limited " << before << " routes to " << routes.Size() << " (over-covered "
+                << budget.overCovered << " addresses)\n";
+  }
+
+  if (command == "lookup")
+  {
+    return RunLookup(routes, addresses);
+  }
+
+  if (command == "compile")
+  {
+    if (outputPath.empty())
+    {
+      std::cout << "Please specify the output file with -o.\n";
+      return 1;
+    }
+
+    // 每个文件各自聚合为一个内置集合，集合名为文件名去掉扩展名；任一文件读取失败都不生成
+    if (format == "cpp")
+    {
+      std::vector<std::string> names;
+      for (size_t i = 0; i < filenames.size(); i++)
+      {
+        if (perFile[i].Empty())
+        {
+          std::cout << "No routes loaded from " << filenames[i] << ", builtin route sets not generated.\n";
+          return 1;
+        }
+        std::string name = std::filesystem::path(filenames[i]).stem().string();
+        if (std::find(names.begin(), names.end(), name) != names.end())
+        {
+          std::cout << "Two input files would both be embedded as builtin:" << name << "\n";
+          return 1;
+        }
+        names.push_back(name);
+        AggregateRoutes(perFile[i]);
+      }
+      if (!WriteBuiltinRouteSource(outputPath, filenames, perFile))
+      {
+        std::cout << "Failed to write route set source: " << outputPath << "\n";
+        return 1;
+      }
+      std::cout << "Generated " << filenames.size() << " builtin route sets into " << outputPath << "\n";
+      return 0;
+    }
+
+    std::vector<RouteCacheSource> sources;
+    for (const auto &filename : filenames)
+    {
+      RouteCacheSource source;
+      if (GetRouteCacheSource(filename, source))
+      {
+        sources.push_back(source);
+      }
+    }
+
+    // 编译结果总是排序聚合后的集合
+    if (!aggregate)
+    {
+      AggregateRoutes(routes);
+    }
+    if (!WriteRouteCache(outputPath, routes, sources))
+    {
+      std::cout << "Failed to write route set: " << outputPath << "\n";
+      return 1;
+    }
+    std::cout << "Compiled " << routes.Size() << " routes into " << outputPath << "\n";
+    return 0;
+  }
+
+  if (command == "add" || command == "sync")
   {
-    std::string gateway;
-    DWORD ifIndex = 0;
-    DWORD metric = 1;
+    uint32_t gateway = 0;
+    uint32_t ifIndex = 0;
+    uint32_t metric = 1;
 
-    DefaultGatewayInfo defaultInfo = GetDefaultGateway();
+    DefaultGatewayInfo defaultInfo = GetDefaultGateway(snapshot);
     if (!defaultInfo.valid)
     {
       std::cout << "Failed to get default gateway information.\n";
@@ -105,16 +958,92 @@ int main(int argc, char *argv[])
     gateway = defaultInfo.gateway;
     ifIndex = defaultInfo.ifIndex;
     metric = defaultInfo.metric;
-    std::cout << "Using default gateway: " << gateway
-              << " (ifIndex: " << ifIndex << ")" << "\n"
-              << "Total routes to add: " << routes.size() << "\n";
+    std::cout << "Using default gateway: " << FormatIpv4(gateway)
+              << " (ifIndex: " << ifIndex << ")" << "\n";
 
-    return AddRoutes(routes, gateway, ifIndex, metric) ? 0 : 1;
+    // 记录只描述一个网关上的路由，网关不同时需要先切换或删除旧路由
+    bool sameGateway = !hasState || state.routes.Empty() || (state.gateway == gateway && state.ifIndex == ifIndex);
+    if (command == "add" && !sameGateway)
+    {
+      std::cout << "Installed routes are recorded on gateway " << FormatIpv4(state.gateway)
+                << ". Run 'win-route repoint " << FormatIpv4(state.gateway) << " default' or 'win-route reset' first.\n";
+      return 1;
+    }
+
+    if (command == "sync")
+    {
+      // 只删除记录中的路由；先把将要安装的路由写入记录，中途崩溃时 reset 仍能找到它们
+      RouteState owner = state;
+      if (!sameGateway)
+      {
+        state.routes.Clear();
+      }
+      state.gateway = gateway;
+      state.ifIndex = ifIndex;
+      state.metric = metric;
+      state.routes.Append(routes);
+      if (!SaveRouteState(statePath, state))
+      {
+        std::cout << "Failed to write state file: " << statePath << "\n";
+        return 1;
+      }
+
+      SyncResult result = SyncRoutes(snapshot, routes, gateway, ifIndex, metric, owner);
+
+      // 记录同步后目标网关上属于本工具的路由，来源正好是本次的文件
+      state.routes = result.owned;
+      ClearRouteSources(state);
+      for (size_t i = 0; i < filenames.size(); i++)
+      {
+        SetRouteSource(state, filenames[i], perFile[i]);
+      }
+      state.tracked = state.routes;
+      SaveRouteState(statePath, state);
+      std::cout << "\nRoute Sync Summary:\n"
+                << "Desired routes: " << routes.Size() << "\n"
+                << "Already present: " << result.unchanged << "\n"
+                << "Added: " << result.added << "\n"
+                << "Removed: " << result.removed << "\n"
+                << "Failed: " << result.failed << "\n";
+      return result.failed == 0 ? 0 : 1;
+    }
+
+    // 登记各文件的前缀，只安装和删除合并结果中变化的部分；
+    // 读取失败或为空的文件保留原有登记，不会因此删除已安装的路由
+    state.gateway = gateway;
+    state.ifIndex = ifIndex;
+    state.metric = metric;
+    for (size_t i = 0; i < filenames.size(); i++)
+    {
+      if (!perFile[i].Empty() && !SetRouteSource(state, filenames[i], perFile[i]))
+      {
+        return 1;
+      }
+    }
+
+    // 聚合后的目标集合与上次全部成功安装的内容相同、路由都还在时，只更新登记，不做路由操作
+    if (hasState && !force && TrackedRoutesCurrent(snapshot, state, sourceOptions, gateway, ifIndex))
+    {
+      std::cout << "Routes are already up to date on gateway " << FormatIpv4(gateway)
+                << ", nothing to do (use --force to reinstall).\n";
+      return SaveRouteState(statePath, state) ? 0 : 1;
+    }
+    return ApplyTrackedRoutes(snapshot, state, statePath, sourceOptions, jobs) ? 0 : 1;
   }
   else if (command == "delete")
   {
-    std::cout << "Total routes to delete: " << routes.size() << "\n";
-    return DeleteRoutes(routes) ? 0 : 1;
+    std::cout << "Total routes to delete: " << routes.Size() << "\n";
+    if (hasState && !allRoutes)
+    {
+      bool ok = DeleteOwnedRoutes(snapshot, state, &routes, jobs);
+      for (const auto &filename : filenames)
+      {
+        RemoveRouteSource(state, filename);
+      }
+      SaveRouteState(statePath, state);
+      return ok ? 0 : 1;
+    }
+    return DeleteRoutes(snapshot, routes, jobs) ? 0 : 1;
   }
   else
   {
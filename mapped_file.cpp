@@ -0,0 +1,133 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+  Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string &filename)
+{
+  Close();
+
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    return false;
+  }
+  file_ = file;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize))
+  {
+    Close();
+    return false;
+  }
+
+  // 空文件无法创建映射，直接视为成功
+  if (fileSize.QuadPart == 0)
+  {
+    return true;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL)
+  {
+    Close();
+    return false;
+  }
+  mapping_ = mapping;
+
+  data_ = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data_ == nullptr)
+  {
+    Close();
+    return false;
+  }
+  size_ = (size_t)fileSize.QuadPart;
+  return true;
+}
+
+void MappedFile::Close()
+{
+  if (data_)
+  {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_)
+  {
+    CloseHandle(mapping_);
+  }
+  if (file_)
+  {
+    CloseHandle(file_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  mapping_ = nullptr;
+  file_ = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string &filename)
+{
+  Close();
+
+  fd_ = open(filename.c_str(), O_RDONLY);
+  if (fd_ < 0)
+  {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) != 0)
+  {
+    Close();
+    return false;
+  }
+
+  // 空文件无法创建映射，直接视为成功
+  if (st.st_size == 0)
+  {
+    return true;
+  }
+
+  void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (data == MAP_FAILED)
+  {
+    Close();
+    return false;
+  }
+  data_ = (const char *)data;
+  size_ = (size_t)st.st_size;
+  return true;
+}
+
+void MappedFile::Close()
+{
+  if (data_)
+  {
+    munmap((void *)data_, size_);
+  }
+  if (fd_ >= 0)
+  {
+    close(fd_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  fd_ = -1;
+}
+
+#endif
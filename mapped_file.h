@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief 只读文件映射
+ * @details 将整个文件映射到内存中，供解析器直接按字节扫描：
+ *          1. Windows 下使用 CreateFileMapping/MapViewOfFile
+ *          2. 其他平台使用 mmap
+ *          3. 空文件不做映射，Data() 返回 nullptr 且 Size() 为 0
+ */
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /**
+   * @brief 打开并映射文件
+   * @param filename 文件路径
+   * @return true表示映射成功(包括空文件)，false表示文件无法打开或映射
+   */
+  bool Open(const std::string &filename);
+
+  /**
+   * @brief 释放映射和文件句柄
+   */
+  void Close();
+
+  const char *Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void *file_ = nullptr;
+  void *mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
@@ -0,0 +1,161 @@
+#include "memory_backend.h"
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+  void SimulateLatency(unsigned latencyUs)
+  {
+    if (latencyUs > 0)
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(latencyUs));
+    }
+  }
+}
+
+MemoryRouteBackend::Key MemoryRouteBackend::MakeKey(const RouteEntry &entry)
+{
+  Key key;
+  key.prefix = PrefixKey(entry.destination, entry.prefixLen);
+  key.nextHop = ((uint64_t)entry.gateway << 32) | entry.ifIndex;
+  return key;
+}
+
+void MemoryRouteBackend::Record(OperationType type, const RouteEntry &entry, uint32_t result)
+{
+  if (recordOperations)
+  {
+    operations.push_back({type, entry, result});
+  }
+}
+
+void MemoryRouteBackend::OnRowAdded(uint64_t prefix)
+{
+  if (prefixRows_[prefix]++ > 0)
+  {
+    return;
+  }
+  auto it = unrouted_.find(prefix);
+  if (it != unrouted_.end())
+  {
+    maxUnrouted_ = std::max(maxUnrouted_, Clock::now() - it->second);
+    unrouted_.erase(it);
+  }
+}
+
+void MemoryRouteBackend::OnRowRemoved(uint64_t prefix)
+{
+  if (--prefixRows_[prefix] == 0)
+  {
+    prefixRows_.erase(prefix);
+    unrouted_[prefix] = Clock::now();
+  }
+}
+
+bool MemoryRouteBackend::GetTable(std::vector<RouteEntry> &rows)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  tableCalls++;
+  rows.clear();
+  rows.reserve(rows_.size());
+  for (const auto &item : rows_)
+  {
+    rows.push_back(item.second);
+  }
+  return true;
+}
+
+uint32_t MemoryRouteBackend::CreateEntry(const RouteEntry &entry)
+{
+  SimulateLatency(callLatencyUs);
+  std::lock_guard<std::mutex> lock(mutex_);
+  createCalls++;
+  RouteEntry stored = entry;
+  if (stored.protocol == 0)
+  {
+    stored.protocol = ROUTE_PROTO_NETMGMT;
+  }
+  Key key = MakeKey(entry);
+  uint32_t result = 0;
+  if (rows_.emplace(key, stored).second)
+  {
+    OnRowAdded(key.prefix);
+    changes_++;
+  }
+  else
+  {
+    result = ROUTE_ERROR_ALREADY_EXISTS;
+  }
+  Record(OperationType::Create, entry, result);
+  return result;
+}
+
+uint32_t MemoryRouteBackend::DeleteEntry(const RouteEntry &entry)
+{
+  SimulateLatency(callLatencyUs);
+  std::lock_guard<std::mutex> lock(mutex_);
+  deleteCalls++;
+  Key key = MakeKey(entry);
+  uint32_t result = 0;
+  if (rows_.erase(key) != 0)
+  {
+    OnRowRemoved(key.prefix);
+    changes_++;
+  }
+  else
+  {
+    result = ROUTE_ERROR_NOT_FOUND;
+  }
+  Record(OperationType::Delete, entry, result);
+  return result;
+}
+
+uint32_t MemoryRouteBackend::SetEntry(const RouteEntry &entry)
+{
+  SimulateLatency(callLatencyUs);
+  std::lock_guard<std::mutex> lock(mutex_);
+  setCalls++;
+  uint32_t result = 0;
+  auto it = rows_.find(MakeKey(entry));
+  if (it != rows_.end())
+  {
+    it->second.metric = entry.metric;
+    changes_++;
+  }
+  else
+  {
+    result = ROUTE_ERROR_NOT_FOUND;
+  }
+  Record(OperationType::Set, entry, result);
+  return result;
+}
+
+void MemoryRouteBackend::Seed(const RouteEntry &entry)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  Key key = MakeKey(entry);
+  if (rows_.find(key) == rows_.end())
+  {
+    OnRowAdded(key.prefix);
+  }
+  rows_[key] = entry;
+  changes_++;
+}
+
+uint64_t MemoryRouteBackend::ChangeCount()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return changes_;
+}
+
+size_t MemoryRouteBackend::Size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return rows_.size();
+}
+
+double MemoryRouteBackend::MaxUnroutedUs() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::chrono::duration<double, std::micro>(maxUnrouted_).count();
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "route_backend.h"
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * @brief 内存中的路由后端
+ * @details 用哈希表模拟系统路由表，可在非 Windows 平台上运行：
+ *          1. 路由按(目标网络, 前缀长度, 网关, 接口)唯一标识，与系统行为一致
+ *          2. 重复添加返回 ROUTE_ERROR_ALREADY_EXISTS，删除不存在的路由返回 ROUTE_ERROR_NOT_FOUND
+ *          3. 统计各类调用次数，便于验证同步逻辑只发出必要的操作
+ *          4. 所有操作加锁，可被多个线程同时调用
+ *          5. 可为添加和删除设置固定的调用延迟，延迟期间不持有锁，用于模拟系统调用耗时
+ *          6. 可按顺序记录每次操作，并统计任一前缀失去所有路由的最长时间
+ *          7. 每次成功的修改(包括 Seed)使 ChangeCount 加一，与系统的路由变化通知对应
+ */
+class MemoryRouteBackend : public RouteBackend
+{
+public:
+  bool GetTable(std::vector<RouteEntry> &rows) override;
+  uint32_t CreateEntry(const RouteEntry &entry) override;
+  uint32_t DeleteEntry(const RouteEntry &entry) override;
+  uint32_t SetEntry(const RouteEntry &entry) override;
+  uint64_t ChangeCount() override;
+
+  /**
+   * @brief 直接写入一条路由，不计入调用统计
+   * @param entry 要写入的路由
+   */
+  void Seed(const RouteEntry &entry);
+
+  size_t Size() const;
+
+  /**
+   * @brief 任一前缀从最后一条路由被删除到重新有路由之间的最长间隔(微秒)
+   * @details 被删除后一直没有重新添加的前缀不计入，它们是有意移除的
+   */
+  double MaxUnroutedUs() const;
+
+  /**
+   * @brief 操作类型
+   */
+  enum class OperationType
+  {
+    Create,
+    Delete,
+    Set
+  };
+
+  /**
+   * @brief 一次操作的记录
+   */
+  struct OperationRecord
+  {
+    OperationType type;
+    RouteEntry entry;
+    uint32_t result; ///< 返回的错误码
+  };
+
+  unsigned callLatencyUs = 0; ///< 每次添加、删除或修改的模拟延迟(微秒)
+  bool recordOperations = false; ///< 是否记录操作顺序到 operations
+
+  size_t tableCalls = 0;  ///< GetTable 调用次数
+  size_t createCalls = 0; ///< CreateEntry 调用次数
+  size_t deleteCalls = 0; ///< DeleteEntry 调用次数
+  size_t setCalls = 0;    ///< SetEntry 调用次数
+  std::vector<OperationRecord> operations; ///< 按执行顺序记录的操作
+
+private:
+  struct Key
+  {
+    uint64_t prefix;  ///< 目标网络和前缀长度
+    uint64_t nextHop; ///< 网关和接口索引
+
+    bool operator==(const Key &other) const
+    {
+      return prefix == other.prefix && nextHop == other.nextHop;
+    }
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const Key &key) const
+    {
+      uint64_t h = key.prefix * 0x9E3779B97F4A7C15ull ^ key.nextHop * 0xC2B2AE3D27D4EB4Full;
+      return (size_t)(h ^ (h >> 29));
+    }
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  static Key MakeKey(const RouteEntry &entry);
+  void Record(OperationType type, const RouteEntry &entry, uint32_t result);
+  void OnRowAdded(uint64_t prefix);
+  void OnRowRemoved(uint64_t prefix);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<Key, RouteEntry, KeyHash> rows_;
+  std::unordered_map<uint64_t, size_t> prefixRows_;            ///< 每个前缀当前的路由行数
+  std::unordered_map<uint64_t, Clock::time_point> unrouted_;   ///< 失去所有路由的前缀及其时间
+  Clock::duration maxUnrouted_ = Clock::duration::zero();
+  uint64_t changes_ = 0; ///< 成功修改路由表的次数
+};
@@ -0,0 +1,169 @@
+#include "metrics.h"
+#include "file_operations.h"
+#include <cstdio>
+#include <iostream>
+
+namespace
+{
+  const char *const kCallNames[] = {"get_table", "create", "delete", "set"};
+
+  // 耗时所在的直方图桶：第 i 个桶为小于 2^i 微秒
+  int BucketOf(uint64_t ns)
+  {
+    uint64_t us = ns / 1000;
+    int bucket = 0;
+    while (bucket < Metrics::kBuckets - 1 && (1ull << bucket) <= us)
+    {
+      bucket++;
+    }
+    return bucket;
+  }
+
+  std::string FormatDouble(double value)
+  {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return buffer;
+  }
+
+  template <typename Fn>
+  uint32_t Timed(MetricCall call, Fn fn)
+  {
+    auto start = std::chrono::steady_clock::now();
+    uint32_t code = fn();
+    uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    Metrics::Get().RecordCall(call, ns, code);
+    return code;
+  }
+}
+
+Metrics &Metrics::Get()
+{
+  static Metrics metrics;
+  return metrics;
+}
+
+void Metrics::AddPhase(const char *phase, double ms)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  Phase &item = phases_[phase];
+  item.count++;
+  item.ms += ms;
+}
+
+void Metrics::RecordCall(MetricCall call, uint64_t ns, uint32_t code)
+{
+  CallStats &stats = calls_[(int)call];
+  stats.count.fetch_add(1, std::memory_order_relaxed);
+  stats.totalNs.fetch_add(ns, std::memory_order_relaxed);
+  stats.buckets[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+  uint64_t max = stats.maxNs.load(std::memory_order_relaxed);
+  while (ns > max && !stats.maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+  {
+  }
+
+  // 错误只在失败时出现，加锁计数即可
+  if (code != 0)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    errors_[(int)call][code]++;
+  }
+}
+
+std::string Metrics::ToJson() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string json = "{\"phases\":{";
+  bool first = true;
+  for (const auto &item : phases_)
+  {
+    json += first ? "" : ",";
+    json += "\"" + item.first + "\":{\"count\":" + std::to_string(item.second.count) +
+            ",\"ms\":" + FormatDouble(item.second.ms) + "}";
+    first = false;
+  }
+
+  json += "},\"calls\":{";
+  first = true;
+  for (int call = 0; call < (int)MetricCall::Count; call++)
+  {
+    const CallStats &stats = calls_[call];
+    uint64_t count = stats.count.load();
+    if (count == 0)
+    {
+      continue;
+    }
+    json += first ? "" : ",";
+    first = false;
+    json += "\"" + std::string(kCallNames[call]) + "\":{\"count\":" + std::to_string(count) +
+            ",\"total_ms\":" + FormatDouble(stats.totalNs.load() / 1e6) +
+            ",\"max_us\":" + FormatDouble(stats.maxNs.load() / 1e3) + ",\"histogram_us\":[";
+    bool firstBucket = true;
+    for (int bucket = 0; bucket < kBuckets; bucket++)
+    {
+      uint64_t n = stats.buckets[bucket].load();
+      if (n == 0)
+      {
+        continue;
+      }
+      json += firstBucket ? "" : ",";
+      firstBucket = false;
+      json += "{\"lt\":" + std::to_string(1ull << bucket) + ",\"count\":" + std::to_string(n) + "}";
+    }
+    json += "],\"errors\":{";
+    bool firstError = true;
+    for (const auto &error : errors_[call])
+    {
+      json += firstError ? "" : ",";
+      firstError = false;
+      json += "\"" + std::to_string(error.first) + "\":" + std::to_string(error.second);
+    }
+    json += "}}";
+  }
+  json += "}}";
+  return json;
+}
+
+bool InstrumentedBackend::GetTable(std::vector<RouteEntry> &rows)
+{
+  return Timed(MetricCall::GetTable, [&]
+               { return inner_.GetTable(rows) ? 0u : 1u; }) == 0;
+}
+
+uint32_t InstrumentedBackend::CreateEntry(const RouteEntry &entry)
+{
+  return Timed(MetricCall::Create, [&]
+               { return inner_.CreateEntry(entry); });
+}
+
+uint32_t InstrumentedBackend::DeleteEntry(const RouteEntry &entry)
+{
+  return Timed(MetricCall::Delete, [&]
+               { return inner_.DeleteEntry(entry); });
+}
+
+uint32_t InstrumentedBackend::SetEntry(const RouteEntry &entry)
+{
+  return Timed(MetricCall::Set, [&]
+               { return inner_.SetEntry(entry); });
+}
+
+MetricsReport::~MetricsReport()
+{
+  if (target_.empty() || !Metrics::Get().Enabled())
+  {
+    return;
+  }
+  std::string json = Metrics::Get().ToJson() + "\n";
+  if (target_ == "-")
+  {
+    std::cout << json;
+    std::cout.flush();
+  }
+  else if (!WriteFileAtomically(target_, json))
+  {
+    std::cout << "Failed to write metrics: " << target_ << "\n";
+  }
+}
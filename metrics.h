@@ -0,0 +1,157 @@
+#pragma once
+#include "route_backend.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief 被统计的后端调用类型
+ */
+enum class MetricCall
+{
+  GetTable,
+  Create,
+  Delete,
+  Set,
+  Count ///< 类型数量
+};
+
+/**
+ * @brief 进程内的运行指标
+ * @details 1. 各阶段的次数和累计耗时(ScopedTimer 记录)
+ *          2. 每类后端调用的次数、耗时直方图和各错误码次数(InstrumentedBackend 记录)
+ *          3. 默认关闭，关闭时 ScopedTimer 只有一次分支判断，也不包装后端
+ *          直方图按2的幂划分：第 i 个桶统计耗时小于 2^i 微秒的调用，可被多个线程无锁更新
+ */
+class Metrics
+{
+public:
+  static const int kBuckets = 32;
+
+  /**
+   * @brief 获取全局实例
+   */
+  static Metrics &Get();
+
+  void Enable() { enabled_ = true; }
+  bool Enabled() const { return enabled_; }
+
+  /**
+   * @brief 累加一个阶段的耗时
+   * @param phase 阶段名称
+   * @param ms 耗时(毫秒)
+   */
+  void AddPhase(const char *phase, double ms);
+
+  /**
+   * @brief 记录一次后端调用
+   * @param call 调用类型
+   * @param ns 耗时(纳秒)
+   * @param code 返回的错误码，0表示成功
+   */
+  void RecordCall(MetricCall call, uint64_t ns, uint32_t code);
+
+  /**
+   * @brief 以JSON输出全部指标
+   * @return std::string 单行JSON
+   */
+  std::string ToJson() const;
+
+private:
+  struct Phase
+  {
+    size_t count = 0;
+    double ms = 0;
+  };
+
+  struct CallStats
+  {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> maxNs{0};
+    std::atomic<uint64_t> buckets[kBuckets] = {};
+  };
+
+  bool enabled_ = false;
+  CallStats calls_[(int)MetricCall::Count];
+  mutable std::mutex mutex_;
+  std::map<std::string, Phase> phases_;
+  std::map<uint32_t, size_t> errors_[(int)MetricCall::Count];
+};
+
+/**
+ * @brief 作用域计时器，析构或 Stop 时把耗时记入指定阶段
+ * @details 指标关闭时不读取时钟
+ */
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(const char *phase) : phase_(phase), active_(Metrics::Get().Enabled())
+  {
+    if (active_)
+    {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~ScopedTimer() { Stop(); }
+
+  /**
+   * @brief 提前结束计时，之后析构不再记录
+   */
+  void Stop()
+  {
+    if (active_)
+    {
+      active_ = false;
+      Metrics::Get().AddPhase(phase_, std::chrono::duration<double, std::milli>(
+                                          std::chrono::steady_clock::now() - start_)
+                                          .count());
+    }
+  }
+
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+  const char *phase_;
+  bool active_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @brief 记录每次调用耗时和错误码的后端包装
+ * @details 只在启用指标时使用，其余情况直接使用被包装的后端
+ */
+class InstrumentedBackend : public RouteBackend
+{
+public:
+  explicit InstrumentedBackend(RouteBackend &inner) : inner_(inner) {}
+
+  bool GetTable(std::vector<RouteEntry> &rows) override;
+  uint32_t CreateEntry(const RouteEntry &entry) override;
+  uint32_t DeleteEntry(const RouteEntry &entry) override;
+  uint32_t SetEntry(const RouteEntry &entry) override;
+  std::string DescribeError(uint32_t code) override { return inner_.DescribeError(code); }
+  uint64_t ChangeCount() override { return inner_.ChangeCount(); }
+
+private:
+  RouteBackend &inner_;
+};
+
+/**
+ * @brief 在析构时输出指标
+ * @details 放在 main 的开头，无论从哪个分支返回都会输出：
+ *          target 为空时不输出，为"-"时写到标准输出，否则写入该文件
+ */
+class MetricsReport
+{
+public:
+  explicit MetricsReport(const std::string &target) : target_(target) {}
+  ~MetricsReport();
+
+private:
+  std::string target_;
+};
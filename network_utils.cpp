@@ -4,48 +4,18 @@
 #include <ws2tcpip.h>
 #include "network_utils.h"
 
-DefaultGatewayInfo GetDefaultGateway()
+DefaultGatewayInfo GetDefaultGateway(RouteTableSnapshot &snapshot)
 {
-  DefaultGatewayInfo info = {0, "", 0, false};
-  PMIB_IPFORWARDTABLE pIpForwardTable = NULL;
-  DWORD dwSize = 0;
-  DWORD dwRetVal = 0;
-
-  if (GetIpForwardTable(NULL, &dwSize, TRUE) == ERROR_INSUFFICIENT_BUFFER)
-  {
-    pIpForwardTable = (PMIB_IPFORWARDTABLE)malloc(dwSize);
-    if (pIpForwardTable == NULL)
-    {
-      return info;
-    }
-  }
-
-  if ((dwRetVal = GetIpForwardTable(pIpForwardTable, &dwSize, TRUE)) == NO_ERROR)
-  {
-    for (DWORD i = 0; i < pIpForwardTable->dwNumEntries; i++)
-    {
-      if (pIpForwardTable->table[i].dwForwardDest == 0)
-      {
-        info.ifIndex = pIpForwardTable->table[i].dwForwardIfIndex;
-        info.metric = pIpForwardTable->table[i].dwForwardMetric1;
-        struct in_addr addr;
-        addr.s_addr = pIpForwardTable->table[i].dwForwardNextHop;
-        info.gateway = inet_ntoa(addr);
-        info.valid = true;
-        break;
-      }
-    }
-  }
-
-  if (pIpForwardTable)
+  if (!snapshot.Ensure())
   {
-    free(pIpForwardTable);
+    DefaultGatewayInfo info = {0, 0, 0, false};
+    return info;
   }
 
-  return info;
+  return snapshot.DefaultRoute();
 }
 
-std::string GetInterfaceIpAddress(DWORD ifIndex)
+std::string GetInterfaceIpAddress(uint32_t ifIndex)
 {
   PIP_ADAPTER_ADDRESSES pAddresses = NULL;
   ULONG outBufLen = 0;
@@ -100,29 +70,3 @@ std::string GetInterfaceIpAddress(DWORD ifIndex)
 
   return "";
 }
-
-DWORD IpStringToDword(const std::string &ipAddress)
-{
-  return inet_addr(ipAddress.c_str());
-}
-
-// 解析CIDR格式的IP地址
-bool ParseCidr(const std::string &cidr, std::string &ip, std::string &mask)
-{
-  size_t pos = cidr.find('/');
-  if (pos == std::string::npos)
-    return false;
-
-  ip = cidr.substr(0, pos);
-  int bits = std::stoi(cidr.substr(pos + 1));
-
-  if (bits < 0 || bits > 32)
-    return false;
-
-  DWORD maskValue = (bits == 0) ? 0 : (0xFFFFFFFF << (32 - bits));
-  struct in_addr addr;
-  addr.s_addr = htonl(maskValue);
-  mask = inet_ntoa(addr);
-
-  return true;
-}
@@ -0,0 +1,59 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 分块并行执行
+ * @param count 任务总数
+ * @param jobs 工作线程数，0或1时在当前线程顺序执行
+ * @param chunk 每次领取的任务数
+ * @param fn 回调 fn(begin, end, worker)，处理下标区间 [begin, end)
+ * @details 1. 各线程通过原子计数器无锁地领取下一块任务，处理快的线程自然多领
+ *          2. 线程数不会超过任务块数
+ *          3. 单线程时按下标顺序处理，多线程时块之间的完成顺序不确定
+ */
+template <typename Fn>
+void ParallelFor(size_t count, unsigned jobs, size_t chunk, Fn fn)
+{
+  if (chunk == 0)
+  {
+    chunk = 1;
+  }
+  size_t chunks = (count + chunk - 1) / chunk;
+  if (jobs <= 1 || chunks <= 1)
+  {
+    if (count > 0)
+    {
+      fn((size_t)0, count, 0u);
+    }
+    return;
+  }
+
+  unsigned workers = (unsigned)std::min<size_t>(jobs, chunks);
+  std::atomic<size_t> next(0);
+  auto worker = [&](unsigned id)
+  {
+    for (;;)
+    {
+      size_t begin = next.fetch_add(chunk, std::memory_order_relaxed);
+      if (begin >= count)
+        break;
+      fn(begin, std::min(begin + chunk, count), id);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(workers - 1);
+  for (unsigned id = 1; id < workers; id++)
+  {
+    threads.emplace_back(worker, id);
+  }
+  worker(0);
+  for (auto &thread : threads)
+  {
+    thread.join();
+  }
+}
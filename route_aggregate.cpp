@@ -0,0 +1,340 @@
+#include "route_aggregate.h"
+#include "metrics.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+  // 前缀覆盖的最后一个地址
+  inline uint32_t PrefixLast(uint32_t network, uint8_t prefixLen)
+  {
+    return network | ~PrefixToMask(prefixLen);
+  }
+
+  // 两个地址从最高位开始相同的位数
+  inline uint8_t CommonPrefixLength(uint32_t a, uint32_t b)
+  {
+    uint32_t diff = a ^ b;
+    uint8_t length = 0;
+    while (length < 32 && (diff & (0x80000000u >> length)) == 0)
+    {
+      length++;
+    }
+    return length;
+  }
+
+  // 压缩二叉字典树的节点，0..count-1 为原前缀，其后为分支节点
+  struct TrieNode
+  {
+    uint32_t network;
+    uint8_t prefixLen;
+    bool whole;     ///< 当前是否为结果中的一条完整前缀
+    int32_t left;
+    int32_t right;
+    int32_t parent;
+  };
+
+  // 精确求解的计算量(前缀数 x 条数上限)和选择表大小的上限，超过时使用贪心合并
+  const uint64_t kExactWorkLimit = 1ull << 26;
+  const size_t kExactCellLimit = (size_t)1 << 24;
+  const uint64_t kInfiniteCost = UINT64_MAX;
+
+  // 从根向下收集完整前缀，先左后右即为升序
+  void CollectWhole(const std::vector<TrieNode> &nodes, int32_t root, RouteSet &routes)
+  {
+    routes.Clear();
+    std::vector<int32_t> stack(1, root);
+    while (!stack.empty())
+    {
+      int32_t id = stack.back();
+      stack.pop_back();
+      if (nodes[id].whole)
+      {
+        routes.Add(nodes[id].network, nodes[id].prefixLen);
+        continue;
+      }
+      stack.push_back(nodes[id].right);
+      stack.push_back(nodes[id].left);
+    }
+  }
+
+  /**
+   * @brief 求多覆盖地址数最少的合并方案，标记被合并为一条前缀的分支节点
+   * @param[in,out] nodes 字典树节点，原前缀的 whole 为true，分支节点为false
+   * @param root 根节点
+   * @param maxRoutes 最多保留的路由条数，根为 0.0.0.0/0 时至少为2
+   * @param[out] overCovered 结果比原集合多覆盖的地址数
+   * @return bool 选择表超过 kExactCellLimit 时返回false，不修改节点
+   * @details 最优结果中的每条前缀都可以缩小为所覆盖原前缀的公共祖先，即字典树的一个节点，
+   *          因此只需在字典树上选出覆盖全部叶子且互不嵌套的节点。
+   *          设 f(v, k) 为子树 v 用不超过 k 条前缀时最少多覆盖的地址数：
+   *          1. 原前缀 f(v, 1) = 0；分支节点合并为一条的代价为其地址数减去子树中原前缀的地址数，
+   *             0.0.0.0/0 不可合并
+   *          2. f(v, k) 取合并为一条与 min(f(left, k1) + f(right, k - k1)) 中的较小值
+   *          3. k 不超过子树中原前缀的个数和 maxRoutes，总计算量为 O(n * maxRoutes)
+   *          记录每个 (v, k) 的选择，最后从根向下还原方案
+   */
+  bool ExactCut(std::vector<TrieNode> &nodes, int32_t root, size_t maxRoutes, uint64_t &overCovered)
+  {
+    // 先序遍历，逆序处理时子节点总在父节点之前
+    std::vector<int32_t> order;
+    order.reserve(nodes.size());
+    std::vector<int32_t> stack(1, root);
+    while (!stack.empty())
+    {
+      int32_t id = stack.back();
+      stack.pop_back();
+      order.push_back(id);
+      if (nodes[id].left >= 0)
+      {
+        stack.push_back(nodes[id].left);
+        stack.push_back(nodes[id].right);
+      }
+    }
+
+    // width 为 f(v, ·) 的长度，offset 为分支节点在选择表中的位置
+    std::vector<size_t> width(nodes.size(), 1);
+    std::vector<size_t> offset(nodes.size(), 0);
+    std::vector<uint64_t> covered(nodes.size(), 0);
+    size_t cells = 0;
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+      const TrieNode &node = nodes[*it];
+      if (node.left < 0)
+      {
+        covered[*it] = 1ull << (32 - node.prefixLen);
+        continue;
+      }
+      width[*it] = std::min(width[node.left] + width[node.right], maxRoutes);
+      covered[*it] = covered[node.left] + covered[node.right];
+      offset[*it] = cells;
+      cells += width[*it];
+    }
+    if (cells > kExactCellLimit)
+    {
+      return false;
+    }
+
+    // choice 为0表示合并为一条，否则为分给左子树的条数
+    std::vector<uint32_t> choice(cells, 0);
+    std::vector<std::vector<uint64_t>> cost(nodes.size());
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+      int32_t id = *it;
+      const TrieNode &node = nodes[id];
+      std::vector<uint64_t> &f = cost[id];
+      if (node.left < 0)
+      {
+        f.assign(2, 0);
+        continue;
+      }
+
+      uint64_t whole = node.prefixLen == 0 ? kInfiniteCost : (1ull << (32 - node.prefixLen)) - covered[id];
+      f.assign(width[id] + 1, whole);
+      const std::vector<uint64_t> &left = cost[node.left];
+      const std::vector<uint64_t> &right = cost[node.right];
+      for (size_t k1 = 1; k1 < left.size() && k1 < width[id]; k1++)
+      {
+        if (left[k1] == kInfiniteCost)
+          continue;
+        for (size_t k2 = 1; k2 < right.size() && k1 + k2 <= width[id]; k2++)
+        {
+          // 代价相同时保留先找到的方案：优先合并为一条，其次左子树条数少
+          if (right[k2] != kInfiniteCost && left[k1] + right[k2] < f[k1 + k2])
+          {
+            f[k1 + k2] = left[k1] + right[k2];
+            choice[offset[id] + k1 + k2 - 1] = (uint32_t)k1;
+          }
+        }
+      }
+      std::vector<uint64_t>().swap(cost[node.left]);
+      std::vector<uint64_t>().swap(cost[node.right]);
+    }
+    overCovered = cost[root][width[root]];
+
+    std::vector<std::pair<int32_t, size_t>> pending(1, {root, width[root]});
+    while (!pending.empty())
+    {
+      int32_t id = pending.back().first;
+      size_t k = pending.back().second;
+      pending.pop_back();
+      if (nodes[id].left < 0)
+      {
+        continue;
+      }
+      uint32_t k1 = choice[offset[id] + k - 1];
+      if (k1 == 0)
+      {
+        nodes[id].whole = true;
+        continue;
+      }
+      pending.push_back({nodes[id].left, k1});
+      pending.push_back({nodes[id].right, k - k1});
+    }
+    return true;
+  }
+}
+
+size_t AggregateRoutes(RouteSet &routes)
+{
+  ScopedTimer timer("aggregate");
+  size_t count = routes.Size();
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  // 打包为64位键排序：高32位为网络地址，低8位为前缀长度
+  std::vector<uint64_t> keys(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    uint32_t network = routes.networks[i] & PrefixToMask(routes.prefixLens[i]);
+    keys[i] = PrefixKey(network, routes.prefixLens[i]);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // 复用原有数组作为结果栈
+  routes.Clear();
+  std::vector<uint32_t> &networks = routes.networks;
+  std::vector<uint8_t> &prefixLens = routes.prefixLens;
+
+  for (uint64_t key : keys)
+  {
+    uint32_t network = (uint32_t)(key >> 8);
+    uint8_t prefixLen = (uint8_t)(key & 0xFF);
+
+    // 已被栈顶前缀覆盖(包括完全重复)则丢弃
+    if (!networks.empty() &&
+        network <= PrefixLast(networks.back(), prefixLens.back()))
+    {
+      continue;
+    }
+
+    networks.push_back(network);
+    prefixLens.push_back(prefixLen);
+
+    // 栈顶两个前缀互为兄弟时合并为父前缀
+    while (networks.size() >= 2)
+    {
+      size_t top = networks.size() - 1;
+      uint8_t len = prefixLens[top];
+      if (len == 0 || prefixLens[top - 1] != len)
+        break;
+
+      uint32_t sibling = networks[top] ^ (1u << (32 - len));
+      if (sibling != networks[top - 1] || (networks[top - 1] & (1u << (32 - len))) != 0)
+        break;
+
+      networks.pop_back();
+      prefixLens.pop_back();
+      prefixLens.back() = (uint8_t)(len - 1);
+    }
+  }
+
+  return count - routes.Size();
+}
+
+BudgetResult LimitRoutes(RouteSet &routes, size_t maxRoutes)
+{
+  BudgetResult result;
+  AggregateRoutes(routes);
+  size_t count = routes.Size();
+  if (count <= maxRoutes || count < 2)
+  {
+    return result;
+  }
+
+  ScopedTimer timer("limit_routes");
+
+  std::vector<TrieNode> nodes;
+  nodes.reserve(count * 2 - 1);
+  for (size_t i = 0; i < count; i++)
+  {
+    nodes.push_back({routes.networks[i], routes.prefixLens[i], true, -1, -1, -1});
+  }
+
+  // 相邻前缀的公共祖先深度越小越靠近根，按笛卡尔树方式建树
+  std::vector<int32_t> stack;
+  int32_t pending = 0;
+  for (size_t i = 1; i < count; i++)
+  {
+    uint8_t depth = CommonPrefixLength(routes.networks[i - 1], routes.networks[i]);
+    depth = std::min(depth, std::min(routes.prefixLens[i - 1], routes.prefixLens[i]));
+
+    while (!stack.empty() && nodes[stack.back()].prefixLen >= depth)
+    {
+      nodes[stack.back()].right = pending;
+      nodes[pending].parent = stack.back();
+      pending = stack.back();
+      stack.pop_back();
+    }
+    int32_t id = (int32_t)nodes.size();
+    nodes.push_back({routes.networks[i] & PrefixToMask(depth), depth, false, pending, -1, -1});
+    nodes[pending].parent = id;
+    stack.push_back(id);
+    pending = (int32_t)i;
+  }
+  while (!stack.empty())
+  {
+    nodes[stack.back()].right = pending;
+    nodes[pending].parent = stack.back();
+    pending = stack.back();
+    stack.pop_back();
+  }
+  int32_t root = pending;
+
+  // 根为 0.0.0.0/0 时至少保留两条
+  size_t target = std::max(maxRoutes, (size_t)(nodes[root].prefixLen == 0 ? 2 : 1));
+  if ((uint64_t)count * target <= kExactWorkLimit && ExactCut(nodes, root, target, result.overCovered))
+  {
+    CollectWhole(nodes, root, routes);
+    AggregateRoutes(routes);
+    result.merged = count - routes.Size();
+    return result;
+  }
+
+  auto size = [&](int32_t id)
+  {
+    return 1ull << (32 - nodes[id].prefixLen);
+  };
+
+  // 按(代价, 网络地址)取最小，相同代价时结果稳定
+  using Candidate = std::tuple<uint64_t, uint32_t, int32_t>;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+  auto offer = [&](int32_t id)
+  {
+    const TrieNode &node = nodes[id];
+    if (node.prefixLen > 0 && nodes[node.left].whole && nodes[node.right].whole)
+    {
+      queue.emplace(size(id) - size(node.left) - size(node.right), node.network, id);
+    }
+  };
+  for (size_t id = count; id < nodes.size(); id++)
+  {
+    offer((int32_t)id);
+  }
+
+  size_t current = count;
+  while (current > maxRoutes && !queue.empty())
+  {
+    int32_t id = std::get<2>(queue.top());
+    result.overCovered += std::get<0>(queue.top());
+    queue.pop();
+    nodes[id].whole = true;
+    current--;
+    if (nodes[id].parent >= 0)
+    {
+      offer(nodes[id].parent);
+    }
+  }
+
+  CollectWhole(nodes, root, routes);
+
+  // 合并结果与相邻前缀可能恰好构成兄弟，再做一次精确聚合
+  AggregateRoutes(routes);
+  result.merged = count - routes.Size();
+  return result;
+}
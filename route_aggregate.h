@@ -0,0 +1,38 @@
+#pragma once
+#include "types.h"
+
+/**
+ * @brief 将路由前缀集合聚合为等价的最小前缀集合
+ * @param[in,out] routes 要聚合的前缀集合，结果按网络地址升序排列
+ * @return size_t 聚合节省的路由条数
+ * @details 复杂度为 O(n log n)：
+ *          1. 按(网络地址, 前缀长度)排序，被覆盖的前缀总是排在覆盖它的前缀之后
+ *          2. 顺序扫描，丢弃重复和被已有前缀覆盖的前缀
+ *          3. 用栈合并相邻的兄弟前缀(如两个/24合并为/23)，合并结果继续向上合并
+ *          聚合前后覆盖的地址空间完全相同
+ */
+size_t AggregateRoutes(RouteSet &routes);
+
+/**
+ * @brief 近似聚合的结果
+ */
+struct BudgetResult
+{
+  size_t merged = 0;       ///< 近似合并减少的路由条数(不含精确聚合)
+  uint64_t overCovered = 0; ///< 结果比原集合多覆盖的地址数
+};
+
+/**
+ * @brief 把前缀集合近似聚合到不超过指定条数
+ * @param[in,out] routes 前缀集合，结果按网络地址升序排列，覆盖原集合的全部地址
+ * @param maxRoutes 最多保留的路由条数
+ * @return BudgetResult 合并条数和多覆盖的地址数
+ * @details 1. 先做精确聚合，得到有序且互不重叠的前缀
+ *          2. 相邻前缀的公共祖先就是压缩二叉字典树的分支节点，用栈按深度建树
+ *          3. 前缀数乘以 maxRoutes 不超过 2^26 时，在字典树上动态规划，
+ *             多覆盖的地址数为所有不超过 maxRoutes 条的结果中最少的，复杂度为 O(n * maxRoutes)
+ *          4. 规模更大时贪心合并，复杂度为 O(n log n)：两个子节点都已是完整前缀的分支节点可以合并，
+ *             代价为合并后多覆盖的地址数，用优先队列每次合并代价最小的节点，直到条数达标
+ *          不会合并出 0.0.0.0/0，条数无法再减少时提前停止
+ */
+BudgetResult LimitRoutes(RouteSet &routes, size_t maxRoutes);
@@ -0,0 +1,76 @@
+#pragma once
+#include "types.h"
+#include <string>
+#include <vector>
+
+/// 路由已存在，与 ERROR_OBJECT_ALREADY_EXISTS 相同
+const uint32_t ROUTE_ERROR_ALREADY_EXISTS = 5010;
+/// 路由不存在，与 ERROR_NOT_FOUND 相同
+const uint32_t ROUTE_ERROR_NOT_FOUND = 1168;
+
+/// 后端无法得知路由表是否变化
+const uint64_t ROUTE_CHANGES_UNKNOWN = UINT64_MAX;
+
+/**
+ * @brief 路由后端接口
+ * @details 抽象系统路由表的读取、添加和删除操作：
+ *          1. Windows 下由 IP Helper API 实现(WindowsRouteBackend)
+ *          2. 内存实现(MemoryRouteBackend)用于在其他平台上验证和测量同步逻辑
+ *          返回值沿用 Windows 错误码，0表示成功
+ *          实现必须允许多个线程同时调用 CreateEntry/DeleteEntry/SetEntry
+ */
+class RouteBackend
+{
+public:
+  virtual ~RouteBackend() = default;
+
+  /**
+   * @brief 获取当前路由表快照
+   * @param[out] rows 路由表中的所有IPv4路由
+   * @return bool 获取成功返回true
+   */
+  virtual bool GetTable(std::vector<RouteEntry> &rows) = 0;
+
+  /**
+   * @brief 添加一条路由
+   * @param entry 要添加的路由
+   * @return uint32_t 错误码，0表示成功
+   */
+  virtual uint32_t CreateEntry(const RouteEntry &entry) = 0;
+
+  /**
+   * @brief 删除一条路由
+   * @param entry 要删除的路由，按目标网络、前缀长度、网关和接口匹配
+   * @return uint32_t 错误码，0表示成功
+   */
+  virtual uint32_t DeleteEntry(const RouteEntry &entry) = 0;
+
+  /**
+   * @brief 修改一条已有路由的跃点数
+   * @param entry 要修改的路由，按目标网络、前缀长度、网关和接口匹配，只更新跃点数
+   * @return uint32_t 错误码，0表示成功
+   * @details 网关和接口属于路由的标识，无法原地修改，需要添加新路由后删除旧路由
+   */
+  virtual uint32_t SetEntry(const RouteEntry &entry) = 0;
+
+  /**
+   * @brief 获取错误码的可读描述
+   * @param code 错误码
+   * @return std::string 错误描述
+   */
+  virtual std::string DescribeError(uint32_t code)
+  {
+    return "error " + std::to_string(code);
+  }
+
+  /**
+   * @brief 路由表变化计数
+   * @return uint64_t 路由表每变化一次加一，计数不变说明路由表没有变化；
+   *         不支持变化通知的后端返回 ROUTE_CHANGES_UNKNOWN
+   * @details 可被任意线程调用，用于长期运行时跳过没有必要的路由表读取
+   */
+  virtual uint64_t ChangeCount()
+  {
+    return ROUTE_CHANGES_UNKNOWN;
+  }
+};
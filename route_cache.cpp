@@ -0,0 +1,117 @@
+#include "route_cache.h"
+#include "file_operations.h"
+#include "hash_utils.h"
+#include "mapped_file.h"
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+  const char kCacheMagic[4] = {'W', 'R', 'S', 'C'};
+  const uint32_t kCacheVersion = 1;
+
+  struct CacheHeader
+  {
+    char magic[4];
+    uint32_t version;
+    uint32_t sourceCount;
+    uint32_t reserved;
+    uint64_t routeCount;
+    uint64_t setHash;
+  };
+  static_assert(sizeof(CacheHeader) == 32, "cache header layout");
+  static_assert(sizeof(RouteCacheSource) == 24, "cache source layout");
+}
+
+bool GetRouteCacheSource(const std::string &filename, RouteCacheSource &source)
+{
+  std::error_code ec;
+  auto mtime = std::filesystem::last_write_time(filename, ec);
+  if (ec)
+  {
+    return false;
+  }
+
+  MappedFile file;
+  if (!file.Open(filename))
+  {
+    return false;
+  }
+
+  source.size = file.Size();
+  source.mtime = (int64_t)mtime.time_since_epoch().count();
+  source.contentHash = HashBytes(file.Data(), file.Size());
+  return true;
+}
+
+bool IsRouteCacheImage(const char *data, size_t size)
+{
+  return size >= sizeof(CacheHeader) && memcmp(data, kCacheMagic, sizeof(kCacheMagic)) == 0;
+}
+
+bool LoadRouteCacheImage(const char *data, size_t size, RouteSet &routes,
+                         std::vector<RouteCacheSource> *sources)
+{
+  if (!IsRouteCacheImage(data, size))
+  {
+    return false;
+  }
+
+  CacheHeader header;
+  memcpy(&header, data, sizeof(header));
+  if (header.version != kCacheVersion)
+  {
+    return false;
+  }
+
+  // 校验各段长度与文件大小一致
+  uint64_t sourceBytes = (uint64_t)header.sourceCount * sizeof(RouteCacheSource);
+  uint64_t expected = sizeof(CacheHeader) + sourceBytes + header.routeCount * 5;
+  if (expected != size)
+  {
+    return false;
+  }
+
+  const char *cursor = data + sizeof(CacheHeader);
+  if (sources)
+  {
+    sources->resize(header.sourceCount);
+    memcpy(sources->data(), cursor, (size_t)sourceBytes);
+  }
+  cursor += sourceBytes;
+
+  // 文件头和来源段都是8字节的整数倍，networks 数组天然4字节对齐
+  size_t count = (size_t)header.routeCount;
+  const uint32_t *networks = (const uint32_t *)cursor;
+  const uint8_t *prefixLens = (const uint8_t *)(cursor + count * 4);
+  routes.networks.insert(routes.networks.end(), networks, networks + count);
+  routes.prefixLens.insert(routes.prefixLens.end(), prefixLens, prefixLens + count);
+  return true;
+}
+
+bool WriteRouteCache(const std::string &filename, const RouteSet &routes,
+                     const std::vector<RouteCacheSource> &sources)
+{
+  CacheHeader header;
+  memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+  header.version = kCacheVersion;
+  header.sourceCount = (uint32_t)sources.size();
+  header.reserved = 0;
+  header.routeCount = routes.Size();
+  header.setHash = HashRouteSet(routes);
+
+  std::string image;
+  image.reserve(sizeof(header) + sources.size() * sizeof(RouteCacheSource) + routes.Size() * 5);
+  image.append((const char *)&header, sizeof(header));
+  image.append((const char *)sources.data(), sources.size() * sizeof(RouteCacheSource));
+  image.append((const char *)routes.networks.data(), routes.Size() * 4);
+  image.append((const char *)routes.prefixLens.data(), routes.Size());
+
+  return WriteFileAtomically(filename, image);
+}
+
+uint64_t HashRouteSet(const RouteSet &routes)
+{
+  uint64_t hash = HashBytes(routes.networks.data(), routes.Size() * 4);
+  return HashBytes(routes.prefixLens.data(), routes.Size(), hash);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "types.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief 路由集合缓存文件中记录的来源文件信息
+ */
+struct RouteCacheSource
+{
+  uint64_t size;        ///< 文件大小(字节)
+  int64_t mtime;        ///< 最后修改时间(文件系统时钟的计数)
+  uint64_t contentHash; ///< 文件内容的哈希
+};
+
+/**
+ * @brief 读取来源文件的大小、修改时间和内容哈希
+ * @param filename 文件路径
+ * @param[out] source 文件信息
+ * @return bool 文件存在且可读返回true
+ */
+bool GetRouteCacheSource(const std::string &filename, RouteCacheSource &source);
+
+/**
+ * @brief 判断内存中的数据是否为路由集合缓存
+ * @param data 数据起始地址
+ * @param size 数据长度
+ * @return bool 以缓存文件的魔数开头返回true
+ */
+bool IsRouteCacheImage(const char *data, size_t size);
+
+/**
+ * @brief 从映射到内存的缓存文件中读取路由集合
+ * @param data 缓存文件内容
+ * @param size 内容长度
+ * @param[out] routes 读取到的前缀追加到此处
+ * @param[out] sources 可选，输出缓存中记录的来源文件信息
+ * @return bool 格式和版本校验通过返回true
+ * @details 只校验文件头、版本和各段长度，随后把两个连续数组整体复制到 routes
+ */
+bool LoadRouteCacheImage(const char *data, size_t size, RouteSet &routes,
+                         std::vector<RouteCacheSource> *sources = nullptr);
+
+/**
+ * @brief 写入路由集合缓存文件
+ * @param filename 缓存文件路径
+ * @param routes 路由集合，应已排序聚合
+ * @param sources 来源文件信息
+ * @return bool 写入成功返回true
+ * @details 文件格式(小端序)：
+ *          1. 32字节文件头：魔数"WRSC"、版本、来源数、路由数、路由集合哈希
+ *          2. 每个来源24字节：大小、修改时间、内容哈希
+ *          3. networks 数组(每条4字节)，随后是 prefixLens 数组(每条1字节)
+ *          先写入临时文件再替换，写入过程中崩溃不会留下损坏的缓存
+ */
+bool WriteRouteCache(const std::string &filename, const RouteSet &routes,
+                     const std::vector<RouteCacheSource> &sources);
+
+/**
+ * @brief 计算路由集合的哈希
+ * @param routes 路由集合
+ * @return uint64_t 哈希值，集合内容和顺序相同则哈希相同
+ */
+uint64_t HashRouteSet(const RouteSet &routes);
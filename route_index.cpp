@@ -0,0 +1,31 @@
+#include "route_index.h"
+#include <algorithm>
+
+void RouteTableIndex::Build(const std::vector<RouteEntry> &rows)
+{
+  // 先在一个数组里排序(键, 行号)，再拆成两个数组
+  std::vector<std::pair<uint64_t, uint32_t>> &pairs = scratch_;
+  pairs.resize(rows.size());
+  for (size_t i = 0; i < rows.size(); i++)
+  {
+    pairs[i].first = PrefixKey(rows[i].destination, rows[i].prefixLen);
+    pairs[i].second = (uint32_t)i;
+  }
+  std::sort(pairs.begin(), pairs.end());
+
+  keys_.resize(pairs.size());
+  rows_.resize(pairs.size());
+  for (size_t i = 0; i < pairs.size(); i++)
+  {
+    keys_[i] = pairs[i].first;
+    rows_[i] = pairs[i].second;
+  }
+}
+
+RouteTableIndex::Range RouteTableIndex::Find(uint32_t destination, uint8_t prefixLen) const
+{
+  uint64_t key = PrefixKey(destination, prefixLen);
+  auto range = std::equal_range(keys_.begin(), keys_.end(), key);
+  const uint32_t *base = rows_.data();
+  return Range{base + (range.first - keys_.begin()), base + (range.second - keys_.begin())};
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "types.h"
+#include <vector>
+
+/**
+ * @brief 路由表前缀索引
+ * @details 对路由表快照按(目标网络, 前缀长度)建立一次排序索引，之后每次查找为 O(log n)：
+ *          1. 键为打包后的64位整数，和行号分开存放，查找时只访问键数组
+ *          2. 同一前缀在不同接口或网关上的多行会全部返回
+ *          3. 索引只保存行号，路由行本身仍由调用方持有
+ */
+class RouteTableIndex
+{
+public:
+  /**
+   * @brief 行号区间，[begin, end) 为匹配行在原表中的下标
+   */
+  struct Range
+  {
+    const uint32_t *begin;
+    const uint32_t *end;
+
+    bool Empty() const { return begin == end; }
+    size_t Size() const { return (size_t)(end - begin); }
+  };
+
+  /**
+   * @brief 为路由表建立索引
+   * @param rows 路由表快照
+   */
+  void Build(const std::vector<RouteEntry> &rows);
+
+  /**
+   * @brief 查找指定前缀的所有行
+   * @param destination 目标网络(主机字节序)
+   * @param prefixLen 前缀长度
+   * @return Range 匹配行的下标区间，未找到时为空
+   */
+  Range Find(uint32_t destination, uint8_t prefixLen) const;
+
+  bool Contains(uint32_t destination, uint8_t prefixLen) const
+  {
+    return !Find(destination, prefixLen).Empty();
+  }
+
+  size_t Size() const { return keys_.size(); }
+
+private:
+  std::vector<uint64_t> keys_; ///< 排序后的前缀键
+  std::vector<uint32_t> rows_; ///< 与键一一对应的行号
+  std::vector<std::pair<uint64_t, uint32_t>> scratch_; ///< 排序用的临时数组，重建时复用
+};
@@ -0,0 +1,73 @@
+#include "route_installer.h"
+#include "parallel.h"
+#include <chrono>
+
+namespace
+{
+  // 每次领取的路由数，兼顾负载均衡和原子操作开销
+  const size_t kChunkSize = 64;
+}
+
+void InstallResult::Merge(const InstallResult &other)
+{
+  succeeded += other.succeeded;
+  failed += other.failed;
+  for (const auto &item : other.errors)
+  {
+    errors[item.first] += item.second;
+  }
+}
+
+InstallResult RunRouteOperations(RouteBackend &backend, const std::vector<RouteEntry> &rows,
+                                 RouteOperation operation, unsigned jobs,
+                                 std::vector<uint32_t> *codes, std::vector<double> *finishedMs)
+{
+  auto start = std::chrono::steady_clock::now();
+  if (jobs == 0)
+  {
+    jobs = 1;
+  }
+  std::vector<InstallResult> partial(jobs);
+  if (codes)
+  {
+    codes->assign(rows.size(), 0);
+  }
+  if (finishedMs)
+  {
+    finishedMs->assign(rows.size(), 0);
+  }
+
+  ParallelFor(rows.size(), jobs, kChunkSize, [&](size_t begin, size_t end, unsigned worker)
+              {
+    InstallResult &local = partial[worker];
+    for (size_t i = begin; i < end; i++)
+    {
+      uint32_t result = operation == RouteOperation::Create ? backend.CreateEntry(rows[i])
+                                                            : backend.DeleteEntry(rows[i]);
+      if (codes)
+      {
+        (*codes)[i] = result;
+      }
+      if (finishedMs)
+      {
+        (*finishedMs)[i] =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      }
+      if (result == 0)
+      {
+        local.succeeded++;
+      }
+      else
+      {
+        local.failed++;
+        local.errors[result]++;
+      }
+    } });
+
+  InstallResult total;
+  for (const auto &local : partial)
+  {
+    total.Merge(local);
+  }
+  return total;
+}
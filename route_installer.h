@@ -0,0 +1,42 @@
+#pragma once
+#include "route_backend.h"
+#include <map>
+
+/**
+ * @brief 路由操作类型
+ */
+enum class RouteOperation
+{
+  Create, ///< 添加路由
+  Delete  ///< 删除路由
+};
+
+/**
+ * @brief 批量操作结果
+ * @details 按错误码分别计数，而不是只保留最后一个错误
+ */
+struct InstallResult
+{
+  size_t succeeded = 0;               ///< 成功的操作数
+  size_t failed = 0;                  ///< 失败的操作数
+  std::map<uint32_t, size_t> errors;  ///< 错误码 -> 出现次数
+
+  void Merge(const InstallResult &other);
+};
+
+/**
+ * @brief 用有限数量的工作线程批量执行路由操作
+ * @param backend 路由后端，必须支持多线程并发调用
+ * @param rows 要操作的路由
+ * @param operation 添加或删除
+ * @param jobs 工作线程数，1表示在当前线程按顺序执行
+ * @param[out] codes 可选，输出每一行的错误码(与 rows 一一对应，0表示成功)
+ * @param[out] finishedMs 可选，输出每一行完成时距开始的毫秒数，用于计算覆盖时间
+ * @return InstallResult 成功数、失败数和各错误码的次数
+ * @details 1. 路由被切成固定大小的块，各线程通过原子计数器领取
+ *          2. 每个线程单独统计，结束后合并，执行过程中没有锁竞争
+ *          3. 单线程时严格按输入顺序执行；多线程时只保证每块内部有序
+ */
+InstallResult RunRouteOperations(RouteBackend &backend, const std::vector<RouteEntry> &rows,
+                                 RouteOperation operation, unsigned jobs,
+                                 std::vector<uint32_t> *codes = nullptr, std::vector<double> *finishedMs = nullptr);
@@ -0,0 +1,97 @@
+#include "route_lpm.h"
+#include <algorithm>
+
+void PrefixMatcher::Emit(uint32_t start, uint32_t value)
+{
+  // 与前一个区间的匹配结果相同时合并
+  if (!values_.empty() && values_.back() == value)
+  {
+    return;
+  }
+  // 同一起点被更长的前缀覆盖时，替换前一个区间的值
+  if (!starts_.empty() && starts_.back() == start)
+  {
+    values_.back() = value;
+    if (values_.size() >= 2 && values_[values_.size() - 2] == value)
+    {
+      starts_.pop_back();
+      values_.pop_back();
+    }
+    return;
+  }
+  starts_.push_back(start);
+  values_.push_back(value);
+}
+
+void PrefixMatcher::Build(const RouteSet &routes)
+{
+  starts_.clear();
+  values_.clear();
+
+  // 按(起始地址, 前缀长度)排序，外层前缀排在其包含的前缀之前
+  std::vector<uint32_t> order(routes.Size());
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    order[i] = (uint32_t)i;
+  }
+  auto startOf = [&](uint32_t i)
+  {
+    return routes.networks[i] & PrefixToMask(routes.prefixLens[i]);
+  };
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+            {
+    uint32_t sa = startOf(a), sb = startOf(b);
+    if (sa != sb)
+      return sa < sb;
+    if (routes.prefixLens[a] != routes.prefixLens[b])
+      return routes.prefixLens[a] < routes.prefixLens[b];
+    return a < b; });
+
+  // 用栈保存当前地址所在的嵌套前缀，栈顶为最长匹配
+  struct Open
+  {
+    uint64_t end; ///< 最后一个地址 + 1
+    uint32_t value;
+  };
+  std::vector<Open> stack;
+  uint64_t cursor = 0;
+  Emit(0, NO_MATCH);
+
+  auto closeUntil = [&](uint64_t limit)
+  {
+    while (!stack.empty() && stack.back().end <= limit)
+    {
+      cursor = stack.back().end;
+      stack.pop_back();
+      if (cursor <= 0xFFFFFFFFull)
+      {
+        Emit((uint32_t)cursor, stack.empty() ? NO_MATCH : stack.back().value);
+      }
+    }
+  };
+
+  for (uint32_t index : order)
+  {
+    uint32_t start = startOf(index);
+    uint64_t end = (uint64_t)start + (1ull << (32 - routes.prefixLens[index]));
+
+    closeUntil(start);
+    stack.push_back({end, index});
+    Emit(start, index);
+  }
+  closeUntil(1ull << 32);
+
+  // 一级表：每个64K地址块的起点所在的区间
+  buckets_.assign(65537, 0);
+  size_t interval = 0;
+  for (uint32_t block = 0; block < 65536; block++)
+  {
+    uint32_t blockStart = block << 16;
+    while (interval + 1 < starts_.size() && starts_[interval + 1] <= blockStart)
+    {
+      interval++;
+    }
+    buckets_[block] = (uint32_t)interval;
+  }
+  buckets_[65536] = (uint32_t)(starts_.size() - 1);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "types.h"
+#include <vector>
+
+/**
+ * @brief 最长前缀匹配查找表
+ * @details 可嵌入其他程序使用的IPv4最长前缀匹配引擎：
+ *          1. Build 把任意(可重叠的)前缀集合展开为互不重叠的地址区间，每个区间记录最长匹配前缀的下标
+ *          2. 另建一张按地址高16位索引的一级表(256KB)，Lookup 先查一级表，再在桶内做二分查找
+ *          3. 构建复杂度 O(n log n)，查找不分配内存、不加锁，可被多个线程同时调用
+ */
+class PrefixMatcher
+{
+public:
+  /// 没有任何前缀匹配
+  static const uint32_t NO_MATCH = 0xFFFFFFFFu;
+
+  /**
+   * @brief 构建查找表
+   * @param routes 前缀集合，可以未排序、可以重叠
+   */
+  void Build(const RouteSet &routes);
+
+  /**
+   * @brief 查找最长匹配前缀
+   * @param address 主机字节序的IPv4地址
+   * @return uint32_t 匹配前缀在 Build 时传入集合中的下标，没有匹配或尚未 Build 时返回 NO_MATCH
+   */
+  uint32_t Lookup(uint32_t address) const
+  {
+    if (buckets_.empty())
+    {
+      return NO_MATCH;
+    }
+    uint32_t bucket = address >> 16;
+    uint32_t lo = buckets_[bucket];
+    uint32_t hi = buckets_[bucket + 1];
+
+    // 在 [lo, hi] 中找最后一个起始地址不大于 address 的区间
+    while (lo < hi)
+    {
+      uint32_t mid = lo + (hi - lo + 1) / 2;
+      if (starts_[mid] <= address)
+        lo = mid;
+      else
+        hi = mid - 1;
+    }
+    return values_[lo];
+  }
+
+  /**
+   * @brief 展开后的区间数
+   */
+  size_t IntervalCount() const { return starts_.size(); }
+
+private:
+  void Emit(uint32_t start, uint32_t value);
+
+  std::vector<uint32_t> starts_;  ///< 各区间起始地址，starts_[0] 为0
+  std::vector<uint32_t> values_;  ///< 各区间的最长匹配前缀下标
+  std::vector<uint32_t> buckets_; ///< 高16位为 i 的地址块起点所在的区间下标，共65537项
+};
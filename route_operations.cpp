@@ -1,392 +1,329 @@
-#include <winsock2.h>
-#include <windows.h>
-#include <iphlpapi.h>
+#include <algorithm>
 #include <iostream>
-#include "network_utils.h"
 #include "route_operations.h"
+#include "metrics.h"
+#include "route_installer.h"
+#include "route_priority.h"
 
-bool AddRoute(const RouteEntry &entry)
+namespace
 {
-  MIB_IPFORWARDROW row = {0};
-  row.dwForwardDest = IpStringToDword(entry.destination);
-  row.dwForwardMask = IpStringToDword(entry.mask);
-  row.dwForwardNextHop = IpStringToDword(entry.gateway);
-  row.dwForwardMetric1 = entry.metric;
-  row.dwForwardIfIndex = entry.ifIndex; // 使用指定的接口索引
-  row.dwForwardType = MIB_IPROUTE_TYPE_INDIRECT;
-  row.dwForwardProto = MIB_IPPROTO_NETMGMT;
-  row.dwForwardAge = 0;
-
-  DWORD result = CreateIpForwardEntry(&row);
-  if (result != NO_ERROR)
+  // 输出每个错误码的次数和描述
+  void PrintErrors(RouteBackend &backend, const InstallResult &result)
+  {
+    for (const auto &item : result.errors)
+    {
+      std::cout << "  [" << item.first << "] x" << item.second << ": "
+                << backend.DescribeError(item.first) << "\n";
+    }
+  }
+}
+
+bool AddRoute(RouteTableSnapshot &snapshot, const RouteEntry &entry)
+{
+  RouteBackend &backend = snapshot.Backend();
+  uint32_t result = backend.CreateEntry(entry);
+  snapshot.Invalidate();
+  if (result != 0)
   {
     // 添加错误信息输出
-    LPVOID lpMsgBuf;
-    FormatMessage(
-        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-        NULL,
-        result,
-        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-        (LPTSTR)&lpMsgBuf,
-        0,
-        NULL);
-    std::cout << "Error: " << (char *)lpMsgBuf << std::endl;
-    LocalFree(lpMsgBuf);
+    std::cout << "Error: " << backend.DescribeError(result) << std::endl;
   }
-  return (result == NO_ERROR);
+  return (result == 0);
 }
 
-bool BatchAddRoutes(const std::vector<RouteEntry> &routes, const std::string &gateway, DWORD ifIndex, DWORD metric)
+bool BatchAddRoutes(RouteTableSnapshot &snapshot, const RouteSet &routes, uint32_t gateway, uint32_t ifIndex,
+                    uint32_t metric, unsigned jobs, RouteSet *installed, const std::vector<uint64_t> *weights)
 {
-  std::vector<MIB_IPFORWARDROW> rows;
-  rows.reserve(routes.size()); // 预分配内存
+  ScopedTimer prepareTimer("add_routes.prepare");
+  std::vector<RouteEntry> rows;
+  rows.reserve(routes.Size()); // 预分配内存
 
   // 首先准备所有路由条目
-  for (const auto &route : routes)
+  for (size_t i = 0; i < routes.Size(); i++)
   {
-    MIB_IPFORWARDROW row = {0};
-    row.dwForwardDest = IpStringToDword(route.destination);
-    row.dwForwardMask = IpStringToDword(route.mask);
-    row.dwForwardNextHop = IpStringToDword(gateway);
-    row.dwForwardMetric1 = metric;
-    row.dwForwardIfIndex = ifIndex;
-    row.dwForwardType = MIB_IPROUTE_TYPE_INDIRECT;
-    row.dwForwardProto = MIB_IPPROTO_NETMGMT;
-    row.dwForwardAge = 0;
-    rows.push_back(row);
+    rows.push_back({routes.networks[i], gateway, ifIndex, metric, routes.prefixLens[i], ROUTE_PROTO_NETMGMT});
   }
 
-  // 批量添加路由
-  int succeeded = 0;
-  int failed = 0;
-  DWORD lastError = NO_ERROR;
-  LPVOID errorMsg = nullptr;
+  prepareTimer.Stop();
 
-  for (const auto &row : rows)
+  // 批量添加路由
+  ScopedTimer installTimer("add_routes.install");
+  RouteBackend &backend = snapshot.Backend();
+  std::vector<uint32_t> codes;
+  std::vector<double> finishedMs;
+  InstallResult result = RunRouteOperations(backend, rows, RouteOperation::Create, jobs,
+                                            installed || weights ? &codes : nullptr, weights ? &finishedMs : nullptr);
+  snapshot.Invalidate();
+  installTimer.Stop();
+
+  // 记录实际创建的路由
+  if (installed)
   {
-    MIB_IPFORWARDROW mutableRow = row;
-    DWORD result = CreateIpForwardEntry(&mutableRow);
-    if (result == NO_ERROR)
+    for (size_t i = 0; i < rows.size(); i++)
     {
-      succeeded++;
-    }
-    else
-    {
-      failed++;
-      lastError = result; // 只保存最后一个错误
+      if (codes[i] == 0)
+      {
+        installed->Add(rows[i].destination, rows[i].prefixLen);
+      }
     }
   }
 
-  // 只在发生错误时获取一次错误信息
-  if (failed > 0)
+  // 按错误码汇总失败原因
+  if (result.failed > 0)
   {
-    FormatMessage(
-        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-        NULL,
-        lastError,
-        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-        (LPTSTR)&errorMsg,
-        0,
-        NULL);
-    std::cout << "Some routes failed to add. Last error: " << (char *)errorMsg << std::endl;
-    LocalFree(errorMsg);
+    std::cout << "Some routes failed to add:\n";
+    PrintErrors(backend, result);
   }
 
   std::cout << "\nRoute Addition Summary:\n"
-            << "Total routes: " << routes.size() << "\n"
-            << "Successfully added: " << succeeded << "\n"
-            << "Failed: " << failed << "\n";
+            << "Total routes: " << routes.Size() << "\n"
+            << "Successfully added: " << result.succeeded << "\n"
+            << "Failed: " << result.failed << "\n";
+
+  // 有命中权重时输出流量被覆盖的速度
+  if (weights)
+  {
+    CoverageResult coverage = MeasureCoverage(*weights, finishedMs, &codes);
+    std::cout << "Hits covered: " << coverage.coveredWeight << " of " << coverage.totalWeight << "\n"
+              << "Weighted time to coverage: " << coverage.weightedMs << " ms (50% after " << coverage.halfMs
+              << " ms, 90% after " << coverage.ninetyMs << " ms)\n";
+  }
 
-  return failed == 0;
+  return result.failed == 0;
 }
 
-bool AddRoutes(const std::vector<RouteEntry> &routes, const std::string &gateway, DWORD ifIndex, DWORD metric)
+bool AddRoutes(RouteTableSnapshot &snapshot, const RouteSet &routes, uint32_t gateway, uint32_t ifIndex,
+               uint32_t metric, unsigned jobs, RouteSet *installed, const std::vector<uint64_t> *weights)
 {
-  return BatchAddRoutes(routes, gateway, ifIndex, metric);
+  return BatchAddRoutes(snapshot, routes, gateway, ifIndex, metric, jobs, installed, weights);
 }
 
-bool DeleteRoute(const RouteEntry &entry)
+bool DeleteRoute(RouteTableSnapshot &snapshot, const RouteEntry &entry)
 {
+  RouteBackend &backend = snapshot.Backend();
   // 首先获取现有路由的信息
-  PMIB_IPFORWARDTABLE pIpForwardTable = NULL;
-  DWORD dwSize = 0;
-  MIB_IPFORWARDROW row = {0};
-  bool found = false;
-
-  // 获取路由表大小
-  if (GetIpForwardTable(NULL, &dwSize, TRUE) == ERROR_INSUFFICIENT_BUFFER)
+  if (!snapshot.Ensure())
   {
-    pIpForwardTable = (PMIB_IPFORWARDTABLE)malloc(dwSize);
-    if (pIpForwardTable == NULL)
-    {
-      return false;
-    }
+    return false;
   }
 
-  // 获取路由表
-  if (GetIpForwardTable(pIpForwardTable, &dwSize, TRUE) == NO_ERROR)
+  // 查找匹配的路由，删除前复制出来，避免快照刷新后失效
+  RouteTableIndex::Range matches = snapshot.Index().Find(entry.destination, entry.prefixLen);
+  std::vector<RouteEntry> rows;
+  for (const uint32_t *row = matches.begin; row != matches.end; row++)
   {
-    DWORD destIp = IpStringToDword(entry.destination);
-    DWORD maskIp = IpStringToDword(entry.mask);
-
-    // 查找匹配的路由
-    for (DWORD i = 0; i < pIpForwardTable->dwNumEntries; i++)
-    {
-      if (pIpForwardTable->table[i].dwForwardDest == destIp &&
-          pIpForwardTable->table[i].dwForwardMask == maskIp)
-      {
-        row = pIpForwardTable->table[i];
-        found = true;
-        break;
-      }
-    }
+    rows.push_back(snapshot.Rows()[*row]);
   }
-
-  if (pIpForwardTable)
+  if (rows.empty())
   {
-    free(pIpForwardTable);
+    return false;
   }
 
-  // 若找到匹配的路由，则删除
-  if (found)
+  // 同一前缀可能存在于多个接口上，全部删除
+  bool deleted = true;
+  for (const auto &row : rows)
   {
-    DWORD result = DeleteIpForwardEntry(&row);
-    if (result != NO_ERROR)
+    uint32_t result = backend.DeleteEntry(row);
+    if (result != 0)
     {
-      LPVOID lpMsgBuf;
-      FormatMessage(
-          FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-          NULL,
-          result,
-          MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-          (LPTSTR)&lpMsgBuf,
-          0,
-          NULL);
-      std::cout << "Error: " << (char *)lpMsgBuf;
-      LocalFree(lpMsgBuf);
-      return false;
+      std::cout << "Error: " << backend.DescribeError(result) << "\n";
+      deleted = false;
     }
-    return true;
   }
+  snapshot.Invalidate();
 
-  return false;
+  return deleted;
 }
 
-bool RouteExists(const RouteEntry &entry)
+bool RouteExists(RouteTableSnapshot &snapshot, const RouteEntry &entry)
 {
-  PMIB_IPFORWARDTABLE pIpForwardTable = NULL;
-  DWORD dwSize = 0;
-  bool exists = false;
-
-  if (GetIpForwardTable(NULL, &dwSize, TRUE) == ERROR_INSUFFICIENT_BUFFER)
+  if (!snapshot.Ensure())
   {
-    pIpForwardTable = (PMIB_IPFORWARDTABLE)malloc(dwSize);
-    if (pIpForwardTable == NULL)
-    {
-      return false;
-    }
+    return false;
   }
 
-  if (GetIpForwardTable(pIpForwardTable, &dwSize, TRUE) == NO_ERROR)
+  return snapshot.Index().Contains(entry.destination, entry.prefixLen);
+}
+
+bool GetExistingRouteInfo(RouteTableSnapshot &snapshot, uint32_t destination, uint8_t prefixLen,
+                          RouteEntry &entry)
+{
+  if (!snapshot.Ensure())
   {
-    DWORD destIp = IpStringToDword(entry.destination);
-    DWORD maskIp = IpStringToDword(entry.mask);
+    return false;
+  }
 
-    for (DWORD i = 0; i < pIpForwardTable->dwNumEntries; i++)
-    {
-      if (pIpForwardTable->table[i].dwForwardDest == destIp &&
-          pIpForwardTable->table[i].dwForwardMask == maskIp)
-      {
-        exists = true;
-        break;
-      }
-    }
+  // 同一前缀有多行时取跃点数最小的一行，即系统实际使用的路由
+  const std::vector<RouteEntry> &table = snapshot.Rows();
+  RouteTableIndex::Range matches = snapshot.Index().Find(destination, prefixLen);
+  if (matches.Empty())
+  {
+    return false;
   }
 
-  if (pIpForwardTable)
+  const RouteEntry *best = &table[*matches.begin];
+  for (const uint32_t *row = matches.begin + 1; row != matches.end; row++)
   {
-    free(pIpForwardTable);
+    if (table[*row].metric < best->metric)
+    {
+      best = &table[*row];
+    }
   }
 
-  return exists;
+  entry = *best;
+  return true;
 }
 
-bool GetExistingRouteInfo(const std::string &destination, const std::string &mask, RouteEntry &entry)
+bool DeleteRoutes(RouteTableSnapshot &snapshot, const RouteSet &routes, unsigned jobs)
 {
-  PMIB_IPFORWARDTABLE pIpForwardTable = NULL;
-  DWORD dwSize = 0;
-  bool found = false;
+  // 首先确保路由表快照可用，快照中已建立索引
+  ScopedTimer matchTimer("delete_routes.match");
+  int notFound = 0;
+  std::vector<RouteEntry> rowsToDelete;
+  rowsToDelete.reserve(routes.Size()); // 预分配内存
 
-  if (GetIpForwardTable(NULL, &dwSize, TRUE) == ERROR_INSUFFICIENT_BUFFER)
+  if (!snapshot.Ensure())
   {
-    pIpForwardTable = (PMIB_IPFORWARDTABLE)malloc(dwSize);
-    if (pIpForwardTable == NULL)
-    {
-      return false;
-    }
+    return false;
   }
 
-  if (GetIpForwardTable(pIpForwardTable, &dwSize, TRUE) == NO_ERROR)
-  {
-    DWORD destIp = IpStringToDword(destination);
-    DWORD maskIp = IpStringToDword(mask);
+  const std::vector<RouteEntry> &table = snapshot.Rows();
+  const RouteTableIndex &index = snapshot.Index();
 
-    for (DWORD i = 0; i < pIpForwardTable->dwNumEntries; i++)
+  // 遍历要删除的路由，在索引中查找所有匹配行
+  for (size_t r = 0; r < routes.Size(); r++)
+  {
+    RouteTableIndex::Range matches = index.Find(routes.networks[r], routes.prefixLens[r]);
+    if (matches.Empty())
     {
-      if (pIpForwardTable->table[i].dwForwardDest == destIp &&
-          pIpForwardTable->table[i].dwForwardMask == maskIp)
-      {
-        entry.ifIndex = pIpForwardTable->table[i].dwForwardIfIndex;
-        struct in_addr addr;
-        addr.s_addr = pIpForwardTable->table[i].dwForwardNextHop;
-        entry.gateway = inet_ntoa(addr);
-        found = true;
-        break;
-      }
+      notFound++;
+      continue;
+    }
+    for (const uint32_t *row = matches.begin; row != matches.end; row++)
+    {
+      rowsToDelete.push_back(table[*row]);
     }
   }
 
-  if (pIpForwardTable)
+  matchTimer.Stop();
+
+  // 批量删除找到的路由
+  ScopedTimer deleteTimer("delete_routes.delete");
+  RouteBackend &backend = snapshot.Backend();
+  InstallResult result = RunRouteOperations(backend, rowsToDelete, RouteOperation::Delete, jobs);
+  snapshot.Invalidate();
+  deleteTimer.Stop();
+
+  // 按错误码汇总失败原因
+  if (result.failed > 0)
   {
-    free(pIpForwardTable);
+    std::cout << "Some routes failed to delete:\n";
+    PrintErrors(backend, result);
   }
 
-  return found;
+  std::cout << "\nRoute Deletion Summary:\n"
+            << "Total routes: " << routes.Size() << "\n"
+            << "Found and deleted: " << result.succeeded << "\n"
+            << "Not found: " << notFound << "\n"
+            << "Failed: " << result.failed << "\n";
+
+  return result.succeeded > 0; // 如果至少删除了一个路由就返回成功
 }
 
-bool DeleteRoutes(const std::vector<RouteEntry> &routes)
+bool DeleteOwnedRoutes(RouteTableSnapshot &snapshot, RouteState &state, const RouteSet *routes, unsigned jobs)
 {
-  // 首先获取一次路由表
-  PMIB_IPFORWARDTABLE pIpForwardTable = NULL;
-  DWORD dwSize = 0;
-  DWORD lastError = NO_ERROR;
-  int deleted = 0, notFound = 0;
-  std::vector<MIB_IPFORWARDROW> rowsToDelete;
-  rowsToDelete.reserve(routes.size()); // 预分配内存
-
-  // 获取路由表大小
-  if (GetIpForwardTable(NULL, &dwSize, TRUE) == ERROR_INSUFFICIENT_BUFFER)
-  {
-    pIpForwardTable = (PMIB_IPFORWARDTABLE)malloc(dwSize);
-    if (pIpForwardTable == NULL)
-    {
-      return false;
-    }
-  }
+  ScopedTimer timer("delete_owned");
+  SortUniqueRoutes(state.routes);
 
-  // 获取路由表
-  if (GetIpForwardTable(pIpForwardTable, &dwSize, TRUE) == NO_ERROR)
+  // 筛选出要删除的记录
+  RouteSet selected = state.routes;
+  RouteSet kept;
+  if (routes)
   {
-    // 遍历要删除的路由
-    for (const auto &route : routes)
-    {
-      DWORD destIp = IpStringToDword(route.destination);
-      DWORD maskIp = IpStringToDword(route.mask);
-
-      // 在路由表中查找匹配项
-      for (DWORD i = 0; i < pIpForwardTable->dwNumEntries; i++)
-      {
-        if (pIpForwardTable->table[i].dwForwardDest == destIp &&
-            pIpForwardTable->table[i].dwForwardMask == maskIp)
-        {
-          rowsToDelete.push_back(pIpForwardTable->table[i]);
-          break;
-        }
-      }
-    }
+    RouteSet wanted = *routes;
+    SortUniqueRoutes(wanted);
+    selected = FilterRoutes(state.routes, wanted, true);
+    kept = FilterRoutes(state.routes, wanted, false);
   }
 
-  if (pIpForwardTable)
+  std::vector<RouteEntry> rowsToDelete;
+  rowsToDelete.reserve(selected.Size());
+  for (size_t i = 0; i < selected.Size(); i++)
   {
-    free(pIpForwardTable);
+    rowsToDelete.push_back({selected.networks[i], state.gateway, state.ifIndex, state.metric,
+                            selected.prefixLens[i], ROUTE_PROTO_NETMGMT});
   }
 
-  // 批量删除找到的路由
-  LPVOID errorMsg = nullptr;
-  for (const auto &row : rowsToDelete)
+  RouteBackend &backend = snapshot.Backend();
+  std::vector<uint32_t> codes;
+  InstallResult result = RunRouteOperations(backend, rowsToDelete, RouteOperation::Delete, jobs, &codes);
+  snapshot.Invalidate();
+
+  // 删除失败的路由保留在记录中
+  size_t alreadyGone = 0;
+  for (size_t i = 0; i < rowsToDelete.size(); i++)
   {
-    MIB_IPFORWARDROW mutableRow = row;
-    DWORD result = DeleteIpForwardEntry(&mutableRow);
-    if (result == NO_ERROR)
+    if (codes[i] == ROUTE_ERROR_NOT_FOUND)
     {
-      deleted++;
+      alreadyGone++;
+      result.failed--;
+      result.errors.erase(ROUTE_ERROR_NOT_FOUND);
     }
-    else
+    else if (codes[i] != 0)
     {
-      notFound++;
-      lastError = result; // 只留最后一个错误
+      kept.Add(rowsToDelete[i].destination, rowsToDelete[i].prefixLen);
     }
   }
+  SortUniqueRoutes(kept);
+  state.routes = std::move(kept);
+
+  // 已删除的前缀同时从 tracked 中移除
+  state.tracked = FilterRoutes(state.tracked, state.routes, true);
 
-  // 只在发生错误时获取一次错误信息
-  if (notFound > 0)
+  if (result.failed > 0)
   {
-    FormatMessage(
-        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-        NULL,
-        lastError,
-        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-        (LPTSTR)&errorMsg,
-        0,
-        NULL);
-    std::cout << "Some routes failed to delete. Last error: " << (char *)errorMsg << std::endl;
-    LocalFree(errorMsg);
+    std::cout << "Some routes failed to delete:\n";
+    PrintErrors(backend, result);
   }
 
   std::cout << "\nRoute Deletion Summary:\n"
-            << "Total routes: " << routes.size() << "\n"
-            << "Found and deleted: " << deleted << "\n"
-            << "Not found or failed: " << notFound << "\n";
+            << "Owned routes matched: " << rowsToDelete.size() << "\n"
+            << "Deleted: " << result.succeeded << "\n"
+            << "Already gone: " << alreadyGone << "\n"
+            << "Failed: " << result.failed << "\n";
 
-  return deleted > 0; // 如果至少删除了一个路由就返回成功
+  return result.failed == 0;
 }
 
-void ResetRoutes()
+void ResetRoutes(RouteTableSnapshot &snapshot, unsigned jobs)
 {
   // 首先获取所有路由
-  PMIB_IPFORWARDTABLE pIpForwardTable = NULL;
-  DWORD dwSize = 0;
-  std::vector<MIB_IPFORWARDROW> rowsToDelete;
+  ScopedTimer scanTimer("reset.scan");
+  std::vector<RouteEntry> rowsToDelete;
 
-  // 获取路由表大小
-  if (GetIpForwardTable(NULL, &dwSize, TRUE) == ERROR_INSUFFICIENT_BUFFER)
+  if (!snapshot.Ensure())
   {
-    pIpForwardTable = (PMIB_IPFORWARDTABLE)malloc(dwSize);
-    if (pIpForwardTable == NULL)
-    {
-      std::cout << "Failed to allocate memory for routing table.\n";
-      return;
-    }
+    std::cout << "Failed to read routing table.\n";
+    return;
   }
 
-  // 获取路由表并找出要删除的路由
-  if (GetIpForwardTable(pIpForwardTable, &dwSize, TRUE) == NO_ERROR)
+  // 找出要删除的路由
+  for (const auto &row : snapshot.Rows())
   {
-    for (DWORD i = 0; i < pIpForwardTable->dwNumEntries; i++)
+    // 跳过默认路由（目标地址为0.0.0.0的路由）
+    if (row.destination != 0)
     {
-      // 跳过默认路由（目标地址为0.0.0.0的路由）
-      if (pIpForwardTable->table[i].dwForwardDest != 0)
-      {
-        rowsToDelete.push_back(pIpForwardTable->table[i]);
-      }
+      rowsToDelete.push_back(row);
     }
   }
 
-  // 批量删除路由
-  int totalDeleted = 0;
-  for (const auto &row : rowsToDelete)
-  {
-    MIB_IPFORWARDROW mutableRow = row;
-    if (DeleteIpForwardEntry(&mutableRow) == NO_ERROR)
-    {
-      totalDeleted++;
-    }
-  }
+  scanTimer.Stop();
 
-  if (pIpForwardTable)
-  {
-    free(pIpForwardTable);
-  }
+  // 批量删除路由
+  ScopedTimer deleteTimer("reset.delete");
+  InstallResult result = RunRouteOperations(snapshot.Backend(), rowsToDelete, RouteOperation::Delete, jobs);
+  snapshot.Invalidate();
+  deleteTimer.Stop();
 
-  std::cout << "Reset completed. Deleted " << totalDeleted << " routes.\n";
+  std::cout << "Reset completed. Deleted " << result.succeeded << " routes.\n";
 }
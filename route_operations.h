@@ -1,67 +1,105 @@
 #pragma once
 #include "types.h"
+#include "route_snapshot.h"
+#include "route_state.h"
 #include <vector>
 
 /**
  * @brief 添加单个路由条目
+ * @param snapshot 路由表快照，提供路由后端；修改路由表后会被标记为失效
  * @param entry 要添加的路由条目
  * @return true表示添加成功，false表示添加失败
  * @details 使用 CreateIpForwardEntry API 添加路由
  *          设置路由参数包括：目标网络、掩码、网关、接口索引、度量值等
  *          失败时会输出详细的错误信息
  */
-bool AddRoute(const RouteEntry &entry);
+bool AddRoute(RouteTableSnapshot &snapshot, const RouteEntry &entry);
 
 /**
  * @brief 批量添加路由的包装函数
- * @param routes 要添加的路由条目列表
- * @param gateway 网关地址
+ * @param snapshot 路由表快照，提供路由后端；修改路由表后会被标记为失效
+ * @param routes 要添加的路由前缀集合
+ * @param gateway 网关地址(主机字节序)
  * @param ifIndex 网络接口索引
  * @param metric 跃点数
+ * @param jobs 并发执行的工作线程数
+ * @param[out] installed 可选，追加本次实际创建成功的前缀(已存在的不计入)
+ * @param weights 可选，与 routes 一一对应的命中次数，给出时输出加权的覆盖时间
  * @return true表示全部添加成功，false表示存在添加失败的路由
+ * @details 按 routes 的顺序安装，需要热门前缀先生效时由调用方先用 SortByWeight 排序
  */
-bool AddRoutes(const std::vector<RouteEntry> &routes, const std::string &gateway,
-               DWORD ifIndex, DWORD metric);
+bool AddRoutes(RouteTableSnapshot &snapshot, const RouteSet &routes, uint32_t gateway, uint32_t ifIndex,
+               uint32_t metric, unsigned jobs, RouteSet *installed = nullptr,
+               const std::vector<uint64_t> *weights = nullptr);
 
 /**
  * @brief 删除单个路由条目
+ * @param snapshot 路由表快照，提供路由后端；修改路由表后会被标记为失效
  * @param entry 要删除的路由条目
  * @return true表示删除成功，false表示删除失败或路由不存在
- * @details 先在路由表中查找匹配的路由条目
- *          如果找到则使用 DeleteIpForwardEntry API 删除
+ * @details 先在路由表快照中查找匹配的路由条目
+ *          如果找到则使用 DeleteIpForwardEntry API 删除，同一前缀在多个接口上时全部删除
  *          失败时会输出详细的错误信息
  */
-bool DeleteRoute(const RouteEntry &entry);
+bool DeleteRoute(RouteTableSnapshot &snapshot, const RouteEntry &entry);
 
 /**
  * @brief 检查路由是否存在
+ * @param snapshot 路由表快照，提供路由后端；修改路由表后会被标记为失效
  * @param entry 要检查的路由条目
  * @return true表示路由存在，false表示不存在
- * @details 通过查询系统路由表检查指定的路由是否存在
+ * @details 通过查询路由表快照检查指定的路由是否存在，快照有效时不重新读取
  *          只匹配目标网络和掩码，不考虑网关和接口
  */
-bool RouteExists(const RouteEntry &entry);
+bool RouteExists(RouteTableSnapshot &snapshot, const RouteEntry &entry);
 
 /**
  * @brief 获取现有路由的详细信息
- * @param destination 目标网络地址
- * @param mask 网络掩码
+ * @param snapshot 路由表快照，提供路由后端；修改路由表后会被标记为失效
+ * @param destination 目标网络地址(主机字节序)
+ * @param prefixLen 前缀长度
  * @param[out] entry 用于存储找到的路由信息
  * @return true表示找到路由，false表示未找到
- * @details 在系统路由表中查找指定的路由
- *          如果找到则填充完整的路由信息，包括接口索引和网关地址
+ * @details 在路由表快照中查找指定的路由
+ *          如果找到则填充完整的路由信息，包括接口索引、网关地址和跃点数
+ *          同一前缀有多行时返回跃点数最小的一行
  */
-bool GetExistingRouteInfo(const std::string &destination, const std::string &mask,
+bool GetExistingRouteInfo(RouteTableSnapshot &snapshot, uint32_t destination, uint8_t prefixLen,
                           RouteEntry &entry);
 
-bool DeleteRoutes(const std::vector<RouteEntry> &routes);
+/**
+ * @brief 批量删除路由
+ * @param snapshot 路由表快照，提供路由后端；修改路由表后会被标记为失效
+ * @param routes 要删除的路由前缀集合
+ * @param jobs 并发执行的工作线程数
+ * @return true表示至少删除了一条路由
+ * @details 使用快照中按(目标网络, 前缀长度)建立的排序索引，
+ *          每个前缀的查找为 O(log n)，同一前缀在多个接口上的行全部删除
+ */
+bool DeleteRoutes(RouteTableSnapshot &snapshot, const RouteSet &routes, unsigned jobs);
+
+/**
+ * @brief 删除状态文件中记录的、由本工具安装的路由
+ * @param snapshot 路由表快照，提供路由后端；修改路由表后会被标记为失效
+ * @param[in,out] state 已安装路由的记录，删除成功(或已不存在)的前缀会从 routes 和 tracked 中移除
+ * @param routes 可选，只删除与其中前缀完全相同的记录；为空指针时删除全部记录
+ * @param jobs 并发执行的工作线程数
+ * @return true表示没有删除失败的路由
+ * @details 直接按记录的网关、接口和跃点数构造路由行删除，不读取路由表：
+ *          1. 记录是有序的，按前缀集合筛选时对每个前缀二分查找
+ *          2. 已经不存在的路由视为删除成功，从记录中移除
+ *          3. 删除失败的路由保留在记录中，下次可以重试
+ */
+bool DeleteOwnedRoutes(RouteTableSnapshot &snapshot, RouteState &state, const RouteSet *routes, unsigned jobs);
 
 /**
  * @brief 重置路由表
+ * @param snapshot 路由表快照，提供路由后端；修改路由表后会被标记为失效
+ * @param jobs 并发执行的工作线程数
  * @details 删除所有非默认路由：
  *          1. 保留目标地址为0.0.0.0的默认路由
  *          2. 删除其他所有路由
  *          3. 采用批量删除提高性能
  *          4. 提供删除统计信息
  */
-void ResetRoutes();
+void ResetRoutes(RouteTableSnapshot &snapshot, unsigned jobs);
@@ -0,0 +1,208 @@
+#include "route_patch.h"
+#include "file_operations.h"
+#include "hash_utils.h"
+#include "mapped_file.h"
+#include "route_cache.h"
+#include <cstring>
+
+namespace
+{
+  const char kPatchMagic[4] = {'W', 'R', 'P', 'T'};
+  const uint32_t kPatchVersion = 1;
+
+  struct PatchHeader
+  {
+    char magic[4];
+    uint32_t version;
+    uint64_t baseHash;
+    uint64_t targetHash;
+    uint32_t removedCount;
+    uint32_t addedCount;
+    uint64_t checksum;
+  };
+  static_assert(sizeof(PatchHeader) == 40, "patch header layout");
+
+  uint64_t Checksum(PatchHeader header, const char *body, size_t size)
+  {
+    header.checksum = 0;
+    return HashBytes(body, size, HashBytes(&header, sizeof(header)));
+  }
+
+  void EncodeRoutes(const RouteSet &routes, std::string &out)
+  {
+    uint32_t previous = 0;
+    for (size_t i = 0; i < routes.Size(); i++)
+    {
+      uint32_t delta = routes.networks[i] - previous;
+      previous = routes.networks[i];
+      while (delta >= 0x80)
+      {
+        out.push_back((char)(delta | 0x80));
+        delta >>= 7;
+      }
+      out.push_back((char)delta);
+      out.push_back((char)routes.prefixLens[i]);
+    }
+  }
+
+  /**
+   * @brief 解码一个前缀列表
+   * @details 变长整数超过5字节、地址溢出、前缀长度大于32、主机位不为0或顺序不递增时失败
+   */
+  bool DecodeRoutes(const char *&cur, const char *end, size_t count, RouteSet &routes)
+  {
+    routes.Clear();
+    routes.Reserve(count);
+    uint64_t network = 0;
+    uint64_t lastKey = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+      uint64_t delta = 0;
+      for (int shift = 0;; shift += 7)
+      {
+        if (cur == end || shift > 28)
+          return false;
+        uint8_t byte = (uint8_t)*cur++;
+        delta |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+          break;
+      }
+      if (cur == end)
+        return false;
+      uint8_t prefixLen = (uint8_t)*cur++;
+      network += delta;
+      if (network > UINT32_MAX || prefixLen > 32 || ((uint32_t)network & ~PrefixToMask(prefixLen)) != 0)
+        return false;
+
+      uint64_t key = PrefixKey((uint32_t)network, prefixLen);
+      if (i > 0 && key <= lastKey)
+        return false;
+      lastKey = key;
+      routes.Add((uint32_t)network, prefixLen);
+    }
+    return true;
+  }
+}
+
+RoutePatch DiffRouteSets(const RouteSet &base, const RouteSet &target)
+{
+  RoutePatch patch;
+  patch.baseHash = HashRouteSet(base);
+  patch.targetHash = HashRouteSet(target);
+
+  size_t i = 0, j = 0;
+  while (i < base.Size() || j < target.Size())
+  {
+    uint64_t left = i < base.Size() ? KeyAt(base, i) : UINT64_MAX;
+    uint64_t right = j < target.Size() ? KeyAt(target, j) : UINT64_MAX;
+    if (left == right)
+    {
+      i++;
+      j++;
+    }
+    else if (left < right)
+    {
+      patch.removed.Add(base.networks[i], base.prefixLens[i]);
+      i++;
+    }
+    else
+    {
+      patch.added.Add(target.networks[j], target.prefixLens[j]);
+      j++;
+    }
+  }
+  return patch;
+}
+
+bool ApplyRoutePatch(const RouteSet &base, const RoutePatch &patch, RouteSet &target)
+{
+  if (HashRouteSet(base) != patch.baseHash)
+  {
+    return false;
+  }
+
+  // base 去掉 removed 的同时并入 added，三个有序序列一次归并
+  RouteSet result;
+  result.Reserve(base.Size() + patch.added.Size());
+  size_t i = 0, r = 0, a = 0;
+  while (i < base.Size() || a < patch.added.Size())
+  {
+    uint64_t left = i < base.Size() ? KeyAt(base, i) : UINT64_MAX;
+    uint64_t right = a < patch.added.Size() ? KeyAt(patch.added, a) : UINT64_MAX;
+    if (left == right)
+    {
+      return false; // 要添加的前缀已经存在
+    }
+    if (right < left)
+    {
+      result.Add(patch.added.networks[a], patch.added.prefixLens[a]);
+      a++;
+      continue;
+    }
+    if (r < patch.removed.Size() && KeyAt(patch.removed, r) < left)
+    {
+      return false; // 要删除的前缀不存在
+    }
+    if (r < patch.removed.Size() && KeyAt(patch.removed, r) == left)
+    {
+      r++;
+    }
+    else
+    {
+      result.Add(base.networks[i], base.prefixLens[i]);
+    }
+    i++;
+  }
+  if (r != patch.removed.Size() || HashRouteSet(result) != patch.targetHash)
+  {
+    return false;
+  }
+  target = std::move(result);
+  return true;
+}
+
+bool WriteRoutePatch(const std::string &filename, const RoutePatch &patch)
+{
+  PatchHeader header;
+  memcpy(header.magic, kPatchMagic, sizeof(kPatchMagic));
+  header.version = kPatchVersion;
+  header.baseHash = patch.baseHash;
+  header.targetHash = patch.targetHash;
+  header.removedCount = (uint32_t)patch.removed.Size();
+  header.addedCount = (uint32_t)patch.added.Size();
+  header.checksum = 0;
+
+  std::string body;
+  body.reserve((patch.removed.Size() + patch.added.Size()) * 4);
+  EncodeRoutes(patch.removed, body);
+  EncodeRoutes(patch.added, body);
+  header.checksum = Checksum(header, body.data(), body.size());
+
+  std::string image((const char *)&header, sizeof(header));
+  image.append(body);
+  return WriteFileAtomically(filename, image);
+}
+
+bool ReadRoutePatch(const std::string &filename, RoutePatch &patch)
+{
+  MappedFile file;
+  if (!file.Open(filename) || file.Size() < sizeof(PatchHeader))
+  {
+    return false;
+  }
+
+  PatchHeader header;
+  memcpy(&header, file.Data(), sizeof(header));
+  const char *cur = file.Data() + sizeof(header);
+  const char *end = file.Data() + file.Size();
+  if (memcmp(header.magic, kPatchMagic, sizeof(kPatchMagic)) != 0 || header.version != kPatchVersion ||
+      header.checksum != Checksum(header, cur, (size_t)(end - cur)))
+  {
+    return false;
+  }
+
+  patch.baseHash = header.baseHash;
+  patch.targetHash = header.targetHash;
+  return DecodeRoutes(cur, end, header.removedCount, patch.removed) &&
+         DecodeRoutes(cur, end, header.addedCount, patch.added) && cur == end;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "types.h"
+#include <string>
+
+/**
+ * @brief 两个版本的路由列表之间的差异
+ * @details 两个版本都是排序聚合后的集合，哈希由 HashRouteSet 计算
+ */
+struct RoutePatch
+{
+  uint64_t baseHash = 0;   ///< 旧版本集合的哈希
+  uint64_t targetHash = 0; ///< 新版本集合的哈希
+  RouteSet removed;        ///< 旧版本有、新版本没有的前缀，按(network, prefixLen)升序
+  RouteSet added;          ///< 新版本有、旧版本没有的前缀，按(network, prefixLen)升序
+};
+
+/**
+ * @brief 计算两个版本之间的差异
+ * @param base 旧版本，按(network, prefixLen)升序且不重复
+ * @param target 新版本，按(network, prefixLen)升序且不重复
+ * @return RoutePatch 差异和两个版本的哈希
+ * @details 一次有序归并，复杂度与两个集合的规模之和成线性
+ */
+RoutePatch DiffRouteSets(const RouteSet &base, const RouteSet &target);
+
+/**
+ * @brief 把差异应用到旧版本上
+ * @param base 旧版本，按(network, prefixLen)升序且不重复
+ * @param patch 差异
+ * @param[out] target 得到的新版本
+ * @return bool 成功返回true
+ * @details 1. base 的哈希与 patch.baseHash 不同时失败，不修改 target
+ *          2. 要删除的前缀必须存在，要添加的前缀必须不存在
+ *          3. 一次有序归并得到结果，结果的哈希必须等于 patch.targetHash
+ */
+bool ApplyRoutePatch(const RouteSet &base, const RoutePatch &patch, RouteSet &target);
+
+/**
+ * @brief 写入差异文件
+ * @param filename 差异文件路径
+ * @param patch 差异
+ * @return bool 写入成功返回true
+ * @details 文件格式(小端序)：
+ *          1. 40字节文件头：魔数"WRPT"、版本、旧版本哈希、新版本哈希、删除数、添加数、校验和
+ *          2. 删除的前缀，随后是添加的前缀；每条为与上一条网络地址之差(LEB128变长整数)加1字节前缀长度，
+ *             有序列表中相邻地址的差通常只需1到3字节
+ *          校验和覆盖整个文件(计算时校验和字段为0)，通过 WriteFileAtomically 写入
+ */
+bool WriteRoutePatch(const std::string &filename, const RoutePatch &patch);
+
+/**
+ * @brief 读取差异文件
+ * @param filename 差异文件路径
+ * @param[out] patch 读取到的差异
+ * @return bool 文件头、版本、校验和与各条前缀都有效返回true
+ */
+bool ReadRoutePatch(const std::string &filename, RoutePatch &patch);
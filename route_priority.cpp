@@ -0,0 +1,177 @@
+#include "route_priority.h"
+#include "cidr_parser.h"
+#include "mapped_file.h"
+#include "route_lpm.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+  inline bool IsSeparator(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r' || c == ',';
+  }
+
+  /**
+   * @brief 解析一行"地址或CIDR [次数]"
+   */
+  bool ParseHitLine(const char *begin, const char *end, uint32_t &network, uint8_t &prefixLen, uint64_t &count)
+  {
+    const char *fieldEnd = begin;
+    while (fieldEnd < end && !IsSeparator(*fieldEnd))
+      fieldEnd++;
+
+    CidrRecord record;
+    const char *p = begin;
+    if (ParseCidrRecord(begin, fieldEnd, record))
+    {
+      network = record.network;
+      prefixLen = record.prefixLen;
+    }
+    else if (ParseIpv4(p, fieldEnd, network) && p == fieldEnd)
+    {
+      prefixLen = 32;
+    }
+    else
+    {
+      return false;
+    }
+
+    p = fieldEnd;
+    while (p < end && IsSeparator(*p))
+      p++;
+    if (p == end)
+    {
+      count = 1;
+      return true;
+    }
+    count = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+      count = count * 10 + (uint64_t)(*p - '0');
+    }
+    while (p < end && IsSeparator(*p))
+      p++;
+    return p == end;
+  }
+}
+
+bool ReadHitCounts(const std::string &filename, HitCounts &hits)
+{
+  MappedFile file;
+  if (!file.Open(filename))
+  {
+    std::cout << "Failed to open hit count file: " << filename << "\n";
+    return false;
+  }
+
+  const char *cur = file.Data();
+  const char *end = cur + file.Size();
+  size_t lineNumber = 0;
+  while (cur < end)
+  {
+    const char *newline = (const char *)memchr(cur, '\n', (size_t)(end - cur));
+    const char *lineEnd = newline ? newline : end;
+    const char *begin = cur;
+    cur = newline ? newline + 1 : end;
+    lineNumber++;
+
+    while (begin < lineEnd && IsSeparator(*begin))
+      begin++;
+    if (begin == lineEnd || *begin == '#')
+      continue;
+
+    uint32_t network;
+    uint8_t prefixLen;
+    uint64_t count;
+    if (!ParseHitLine(begin, lineEnd, network, prefixLen, count))
+    {
+      std::cout << filename << ":" << lineNumber << ": Invalid hit count line: " << std::string(begin, lineEnd)
+                << "\n";
+      continue;
+    }
+    hits.prefixes.Add(network, prefixLen);
+    hits.counts.push_back(count);
+  }
+  return true;
+}
+
+std::vector<uint64_t> AttributeHits(const RouteSet &routes, const HitCounts &hits)
+{
+  std::vector<uint64_t> weights(routes.Size(), 0);
+  PrefixMatcher matcher;
+  matcher.Build(routes);
+  for (size_t i = 0; i < hits.prefixes.Size(); i++)
+  {
+    uint32_t match = matcher.Lookup(hits.prefixes.networks[i]);
+    if (match != PrefixMatcher::NO_MATCH)
+    {
+      weights[match] += hits.counts[i];
+    }
+  }
+  return weights;
+}
+
+void SortByWeight(RouteSet &routes, std::vector<uint64_t> &weights)
+{
+  std::vector<uint32_t> order(routes.Size());
+  std::iota(order.begin(), order.end(), 0u);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                   { return weights[a] > weights[b]; });
+
+  RouteSet sorted;
+  std::vector<uint64_t> sortedWeights;
+  sorted.Reserve(order.size());
+  sortedWeights.reserve(order.size());
+  for (uint32_t i : order)
+  {
+    sorted.Add(routes.networks[i], routes.prefixLens[i]);
+    sortedWeights.push_back(weights[i]);
+  }
+  routes = std::move(sorted);
+  weights = std::move(sortedWeights);
+}
+
+CoverageResult MeasureCoverage(const std::vector<uint64_t> &weights, const std::vector<double> &finishedMs,
+                               const std::vector<uint32_t> *codes)
+{
+  CoverageResult result;
+  std::vector<std::pair<double, uint64_t>> covered;
+  double weightedSum = 0;
+  for (size_t i = 0; i < weights.size(); i++)
+  {
+    result.totalWeight += weights[i];
+    if (weights[i] == 0 || (codes && (*codes)[i] != 0))
+      continue;
+    result.coveredWeight += weights[i];
+    weightedSum += finishedMs[i] * (double)weights[i];
+    covered.emplace_back(finishedMs[i], weights[i]);
+  }
+  if (result.coveredWeight == 0)
+  {
+    return result;
+  }
+  result.weightedMs = weightedSum / (double)result.coveredWeight;
+
+  // 多线程时完成时间不一定按下标递增，按时间排序后累计
+  std::sort(covered.begin(), covered.end());
+  uint64_t sum = 0;
+  bool half = false;
+  for (const auto &item : covered)
+  {
+    sum += item.second;
+    if (!half && sum * 2 >= result.totalWeight)
+    {
+      result.halfMs = item.first;
+      half = true;
+    }
+    if (sum * 10 >= result.totalWeight * 9)
+    {
+      result.ninetyMs = item.first;
+      break;
+    }
+  }
+  return result;
+}
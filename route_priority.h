@@ -0,0 +1,64 @@
+#pragma once
+#include "types.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief 按地址或前缀统计的命中次数
+ */
+struct HitCounts
+{
+  RouteSet prefixes;           ///< 命中的地址(/32)或前缀
+  std::vector<uint64_t> counts; ///< 与 prefixes 一一对应的命中次数
+};
+
+/**
+ * @brief 安装过程中流量被覆盖的时间
+ */
+struct CoverageResult
+{
+  uint64_t totalWeight = 0;   ///< 要安装的路由上的总命中次数
+  uint64_t coveredWeight = 0; ///< 安装成功的路由上的命中次数
+  double weightedMs = 0;      ///< 按命中次数加权的平均安装完成时间(毫秒)
+  double halfMs = 0;          ///< 一半命中次数被覆盖的时间
+  double ninetyMs = 0;        ///< 90%命中次数被覆盖的时间
+};
+
+/**
+ * @brief 读取命中次数文件
+ * @param filename 文件路径
+ * @param[out] hits 读取到的命中次数
+ * @return bool 文件能够打开返回true
+ * @details 1. 每行为"地址 [次数]"或"CIDR [次数]"，次数可用空白或逗号分隔，省略时为1
+ *          2. 同一地址可以出现多次，次数累加，适合直接使用代理日志导出的结果
+ *          3. 忽略空行和#开头的注释行，无效行带行号输出后跳过
+ */
+bool ReadHitCounts(const std::string &filename, HitCounts &hits);
+
+/**
+ * @brief 把命中次数归属到要安装的前缀
+ * @param routes 要安装的前缀集合
+ * @param hits 命中次数
+ * @return std::vector<uint64_t> 与 routes 一一对应的权重
+ * @details 对每个命中的地址(前缀取其网络地址)做最长前缀匹配，次数累加到匹配的前缀上，
+ *          不在任何前缀内的命中不计入
+ */
+std::vector<uint64_t> AttributeHits(const RouteSet &routes, const HitCounts &hits);
+
+/**
+ * @brief 按权重从高到低重排前缀
+ * @param[in,out] routes 前缀集合
+ * @param[in,out] weights 与 routes 一一对应的权重，随之重排
+ * @details 稳定排序，权重相同(包括都没有命中)的前缀保持原有顺序
+ */
+void SortByWeight(RouteSet &routes, std::vector<uint64_t> &weights);
+
+/**
+ * @brief 计算加权的覆盖时间
+ * @param weights 每条路由的权重
+ * @param finishedMs 每条路由完成的时间，来自 RunRouteOperations
+ * @param codes 可选，每条路由的错误码，失败的路由不计入已覆盖
+ * @return CoverageResult 加权平均时间和50%、90%命中被覆盖的时间
+ */
+CoverageResult MeasureCoverage(const std::vector<uint64_t> &weights, const std::vector<double> &finishedMs,
+                               const std::vector<uint32_t> *codes = nullptr);
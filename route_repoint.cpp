@@ -0,0 +1,107 @@
+#include "route_repoint.h"
+#include "metrics.h"
+#include "parallel.h"
+#include "route_state.h"
+
+namespace
+{
+  // 每次领取的路由数
+  const size_t kChunkSize = 64;
+
+  void Fail(InstallResult &result, uint32_t code)
+  {
+    result.failed++;
+    result.errors[code]++;
+  }
+}
+
+RepointResult RepointRoutes(RouteTableSnapshot &snapshot, uint32_t oldGateway, uint32_t oldIfIndex,
+                            uint32_t gateway, uint32_t ifIndex, uint32_t metric, unsigned jobs,
+                            const RouteSet *owned)
+{
+  ScopedTimer timer("repoint");
+  RepointResult total;
+  if (!snapshot.Ensure())
+  {
+    return total;
+  }
+
+  // 收集旧网关上属于本工具管理范围的路由，有记录时只取记录中的前缀
+  std::vector<RouteEntry> rows;
+  for (const auto &row : snapshot.Rows())
+  {
+    if (!IsStaticRoute(row) || row.prefixLen == 0 || row.gateway != oldGateway ||
+        (oldIfIndex != 0 && row.ifIndex != oldIfIndex) ||
+        (owned != nullptr && !ContainsRoute(*owned, row.destination, row.prefixLen)))
+    {
+      continue;
+    }
+    rows.push_back(row);
+  }
+  total.matched = rows.size();
+
+  if (jobs == 0)
+  {
+    jobs = 1;
+  }
+  std::vector<RepointResult> partial(jobs);
+  RouteBackend &backend = snapshot.Backend();
+
+  ParallelFor(rows.size(), jobs, kChunkSize, [&](size_t begin, size_t end, unsigned worker)
+              {
+    RepointResult &local = partial[worker];
+    for (size_t i = begin; i < end; i++)
+    {
+      const RouteEntry &old = rows[i];
+      RouteEntry entry = old;
+      entry.gateway = gateway;
+      entry.ifIndex = ifIndex;
+      entry.metric = metric;
+      entry.protocol = ROUTE_PROTO_NETMGMT;
+
+      // 网关和接口不变，只需要修改跃点数
+      if (old.gateway == gateway && old.ifIndex == ifIndex)
+      {
+        if (old.metric == metric)
+        {
+          local.unchanged++;
+          continue;
+        }
+        uint32_t result = backend.SetEntry(entry);
+        if (result == 0)
+        {
+          local.updated++;
+        }
+        else
+        {
+          Fail(local.failures, result);
+        }
+        continue;
+      }
+
+      // 先添加再删除，新路由没有装上时不动旧路由
+      uint32_t result = backend.CreateEntry(entry);
+      if (result != 0 && result != ROUTE_ERROR_ALREADY_EXISTS)
+      {
+        Fail(local.failures, result);
+        continue;
+      }
+      result = backend.DeleteEntry(old);
+      if (result != 0 && result != ROUTE_ERROR_NOT_FOUND)
+      {
+        Fail(local.failures, result);
+        continue;
+      }
+      local.moved++;
+    } });
+  snapshot.Invalidate();
+
+  for (const auto &local : partial)
+  {
+    total.moved += local.moved;
+    total.updated += local.updated;
+    total.unchanged += local.unchanged;
+    total.failures.Merge(local.failures);
+  }
+  return total;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "route_installer.h"
+#include "route_snapshot.h"
+
+/**
+ * @brief 网关切换结果
+ */
+struct RepointResult
+{
+  size_t matched = 0;   ///< 旧网关上需要处理的路由数
+  size_t moved = 0;     ///< 成功切换到新网关的路由数
+  size_t updated = 0;   ///< 网关不变、只修改了跃点数的路由数
+  size_t unchanged = 0; ///< 已经符合要求的路由数
+  InstallResult failures; ///< 失败的操作及错误码
+};
+
+/**
+ * @brief 把旧网关上的静态路由切换到新网关
+ * @param snapshot 路由表快照，切换后被标记为失效
+ * @param oldGateway 旧网关(主机字节序)
+ * @param oldIfIndex 旧接口索引，0表示不限接口
+ * @param gateway 新网关(主机字节序)
+ * @param ifIndex 新接口索引
+ * @param metric 新跃点数
+ * @param jobs 并发执行的工作线程数
+ * @param owned 只切换这些前缀(状态文件中的记录，按(network, prefixLen)升序)，为nullptr时切换旧网关上的全部静态路由
+ * @return RepointResult 切换统计
+ * @details 只读取一次路由表，对旧网关上的每条选中的静态路由(NETMGMT，跳过默认路由)：
+ *          1. 网关和接口不变时，只有跃点数不同才用 SetEntry 原地修改
+ *          2. 否则先添加新路由再删除旧路由，两步紧挨着执行，前缀不会出现无路由的间隙
+ *          3. 新路由添加失败时保留旧路由；新路由已存在时只删除旧路由
+ *          每条路由的两步操作在同一个线程内完成，不同路由之间可以并发
+ */
+RepointResult RepointRoutes(RouteTableSnapshot &snapshot, uint32_t oldGateway, uint32_t oldIfIndex,
+                            uint32_t gateway, uint32_t ifIndex, uint32_t metric, unsigned jobs,
+                            const RouteSet *owned);
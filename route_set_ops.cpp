@@ -0,0 +1,160 @@
+#include "route_set_ops.h"
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+  // x 不为0
+  inline int CountTrailingZeros(uint32_t x)
+  {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return (int)index;
+#else
+    return __builtin_ctz(x);
+#endif
+  }
+
+  // x 不为0，返回最高置位的位置
+  inline int FloorLog2(uint64_t x)
+  {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(x);
+#endif
+  }
+
+  // 追加区间，与上一个区间重叠或相邻时合并
+  void Push(std::vector<AddressRange> &ranges, uint32_t first, uint32_t last)
+  {
+    if (!ranges.empty() && (ranges.back().last == 0xFFFFFFFFu || first <= ranges.back().last + 1))
+    {
+      ranges.back().last = std::max(ranges.back().last, last);
+      return;
+    }
+    ranges.push_back({first, last});
+  }
+}
+
+void RoutesToRanges(const RouteSet &routes, std::vector<AddressRange> &ranges)
+{
+  std::vector<AddressRange> sorted(routes.Size());
+  for (size_t i = 0; i < routes.Size(); i++)
+  {
+    uint32_t mask = PrefixToMask(routes.prefixLens[i]);
+    uint32_t network = routes.networks[i] & mask;
+    sorted[i] = {network, network | ~mask};
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const AddressRange &a, const AddressRange &b)
+            { return a.first < b.first; });
+
+  ranges.clear();
+  for (const auto &range : sorted)
+  {
+    Push(ranges, range.first, range.last);
+  }
+}
+
+void AppendRangeCidrs(uint32_t first, uint32_t last, RouteSet &routes)
+{
+  uint64_t cur = first;
+  uint64_t end = (uint64_t)last + 1;
+  while (cur < end)
+  {
+    // 块大小取当前地址的最低置位(对齐上限)和剩余长度的最高置位(长度上限)中较小者
+    int alignBits = cur == 0 ? 32 : CountTrailingZeros((uint32_t)cur);
+    int lengthBits = FloorLog2(end - cur);
+    int hostBits = alignBits < lengthBits ? alignBits : lengthBits;
+    routes.Add((uint32_t)cur, (uint8_t)(32 - hostBits));
+    cur += 1ull << hostBits;
+  }
+}
+
+void RangesToRoutes(const std::vector<AddressRange> &ranges, RouteSet &routes)
+{
+  routes.Clear();
+  for (const auto &range : ranges)
+  {
+    AppendRangeCidrs(range.first, range.last, routes);
+  }
+}
+
+std::vector<AddressRange> UnionRanges(const std::vector<AddressRange> &a, const std::vector<AddressRange> &b)
+{
+  std::vector<AddressRange> result;
+  result.reserve(a.size() + b.size());
+  size_t i = 0, j = 0;
+  while (i < a.size() || j < b.size())
+  {
+    const AddressRange &next = (j >= b.size() || (i < a.size() && a[i].first < b[j].first)) ? a[i++] : b[j++];
+    Push(result, next.first, next.last);
+  }
+  return result;
+}
+
+std::vector<AddressRange> IntersectRanges(const std::vector<AddressRange> &a, const std::vector<AddressRange> &b)
+{
+  std::vector<AddressRange> result;
+  size_t i = 0, j = 0;
+  while (i < a.size() && j < b.size())
+  {
+    uint32_t first = std::max(a[i].first, b[j].first);
+    uint32_t last = std::min(a[i].last, b[j].last);
+    if (first <= last)
+    {
+      result.push_back({first, last});
+    }
+    // 先结束的区间不会再与后面的区间相交
+    if (a[i].last < b[j].last)
+      i++;
+    else
+      j++;
+  }
+  return result;
+}
+
+std::vector<AddressRange> SubtractRanges(const std::vector<AddressRange> &a, const std::vector<AddressRange> &b)
+{
+  std::vector<AddressRange> result;
+  size_t j = 0;
+  for (const auto &range : a)
+  {
+    uint64_t cur = range.first;
+    // 跳过完全在当前区间之前的减数区间
+    while (j < b.size() && b[j].last < cur)
+    {
+      j++;
+    }
+    size_t k = j;
+    while (k < b.size() && b[k].first <= range.last)
+    {
+      if (b[k].first > cur)
+      {
+        result.push_back({(uint32_t)cur, b[k].first - 1});
+      }
+      cur = (uint64_t)b[k].last + 1;
+      if (b[k].last >= range.last)
+      {
+        break;
+      }
+      k++;
+    }
+    if (cur <= range.last)
+    {
+      result.push_back({(uint32_t)cur, range.last});
+    }
+    j = k;
+  }
+  return result;
+}
+
+std::vector<AddressRange> ComplementRanges(const std::vector<AddressRange> &a)
+{
+  return SubtractRanges({{0, 0xFFFFFFFFu}}, a);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "types.h"
+#include <vector>
+
+/**
+ * @brief 闭区间表示的地址范围
+ */
+struct AddressRange
+{
+  uint32_t first; ///< 第一个地址(主机字节序)
+  uint32_t last;  ///< 最后一个地址(主机字节序，包含)
+};
+
+/**
+ * @brief 把前缀集合转换为有序、不重叠且不相邻的地址区间
+ * @param routes 前缀集合，可以无序、重复或互相覆盖
+ * @param[out] ranges 输出区间
+ * @details 排序后一次扫描合并重叠和相邻的区间，复杂度 O(n log n)
+ */
+void RoutesToRanges(const RouteSet &routes, std::vector<AddressRange> &ranges);
+
+/**
+ * @brief 把一个地址区间拆分为最少的CIDR前缀
+ * @param first 第一个地址
+ * @param last 最后一个地址(包含)
+ * @param[out] routes 前缀按地址升序追加到此处
+ * @details 每次取从当前地址开始、对齐且不超出区间的最大块，一个区间最多产生62个前缀；
+ *          块大小由当前地址的最低置位和剩余长度的最高置位直接得出，不逐位尝试
+ */
+void AppendRangeCidrs(uint32_t first, uint32_t last, RouteSet &routes);
+
+/**
+ * @brief 把有序区间转换为最少的CIDR前缀
+ * @param ranges 有序、不重叠且不相邻的区间
+ * @param[out] routes 输出前缀，按地址升序
+ */
+void RangesToRoutes(const std::vector<AddressRange> &ranges, RouteSet &routes);
+
+/**
+ * @brief 区间集合的并、交、差和补
+ * @details 输入输出均为有序、不重叠且不相邻的区间，归并一次完成，复杂度 O(n + m)
+ */
+std::vector<AddressRange> UnionRanges(const std::vector<AddressRange> &a, const std::vector<AddressRange> &b);
+std::vector<AddressRange> IntersectRanges(const std::vector<AddressRange> &a, const std::vector<AddressRange> &b);
+std::vector<AddressRange> SubtractRanges(const std::vector<AddressRange> &a, const std::vector<AddressRange> &b);
+std::vector<AddressRange> ComplementRanges(const std::vector<AddressRange> &a);
@@ -0,0 +1,47 @@
+#include "route_snapshot.h"
+#include "metrics.h"
+
+bool RouteTableSnapshot::Refresh()
+{
+  ScopedTimer timer("table_fetch");
+  fetchCount_++;
+  valid_ = false;
+  defaultRoute_ = {0, 0, 0, false};
+  // 在读取之前取计数，读取期间发生的变化会让下次 Update 再读一次
+  fetchedChanges_ = backend_.ChangeCount();
+
+  if (!backend_.GetTable(rows_))
+  {
+    rows_.clear();
+    index_.Build(rows_);
+    return false;
+  }
+
+  index_.Build(rows_);
+
+  // 记录跃点数最小的默认路由
+  for (const auto &row : rows_)
+  {
+    if (row.destination == 0 && row.prefixLen == 0 &&
+        (!defaultRoute_.valid || row.metric < defaultRoute_.metric))
+    {
+      defaultRoute_.ifIndex = row.ifIndex;
+      defaultRoute_.gateway = row.gateway;
+      defaultRoute_.metric = row.metric;
+      defaultRoute_.valid = true;
+    }
+  }
+
+  valid_ = true;
+  return true;
+}
+
+bool RouteTableSnapshot::Update()
+{
+  uint64_t changes = backend_.ChangeCount();
+  if (valid_ && changes != ROUTE_CHANGES_UNKNOWN && changes == fetchedChanges_)
+  {
+    return true;
+  }
+  return Refresh();
+}
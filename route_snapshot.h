@@ -0,0 +1,71 @@
+#pragma once
+#include "route_backend.h"
+#include "route_index.h"
+
+/**
+ * @brief 可复用的路由表快照
+ * @details 统一负责读取路由表，取代各函数各自的探测大小、分配、读取、释放流程：
+ *          1. 行数组和索引在多次刷新之间复用容量，后端(WindowsRouteBackend)复用读取缓冲区并在表增长时重试
+ *          2. 读取后同时建立前缀索引并记录默认路由
+ *          3. Ensure 只在快照失效时重新读取；修改路由表后或收到路由变化通知时调用 Invalidate
+ *          长期运行的进程可以在路由表没有变化时完全跳过读取
+ */
+class RouteTableSnapshot
+{
+public:
+  explicit RouteTableSnapshot(RouteBackend &backend) : backend_(backend) {}
+
+  /**
+   * @brief 无条件重新读取路由表
+   * @return bool 读取成功返回true
+   */
+  bool Refresh();
+
+  /**
+   * @brief 快照失效时才重新读取
+   * @return bool 快照可用返回true
+   */
+  bool Ensure()
+  {
+    return valid_ || Refresh();
+  }
+
+  /**
+   * @brief 路由表变化后才重新读取
+   * @return bool 快照可用返回true
+   * @details 后端的变化计数与上次读取时相同且快照有效时直接返回，不读取路由表；
+   *          后端不支持变化通知时等同于 Refresh
+   */
+  bool Update();
+
+  /**
+   * @brief 标记快照失效，下次 Ensure 时重新读取
+   */
+  void Invalidate() { valid_ = false; }
+
+  bool IsValid() const { return valid_; }
+
+  RouteBackend &Backend() { return backend_; }
+  const std::vector<RouteEntry> &Rows() const { return rows_; }
+  const RouteTableIndex &Index() const { return index_; }
+
+  /**
+   * @brief 获取快照中的默认路由
+   * @return DefaultGatewayInfo 跃点数最小的0.0.0.0/0路由，不存在时 valid 为false
+   */
+  const DefaultGatewayInfo &DefaultRoute() const { return defaultRoute_; }
+
+  /**
+   * @brief 实际读取路由表的次数
+   */
+  size_t FetchCount() const { return fetchCount_; }
+
+private:
+  RouteBackend &backend_;
+  std::vector<RouteEntry> rows_;
+  RouteTableIndex index_;
+  DefaultGatewayInfo defaultRoute_ = {0, 0, 0, false};
+  bool valid_ = false;
+  size_t fetchCount_ = 0;
+  uint64_t fetchedChanges_ = ROUTE_CHANGES_UNKNOWN; ///< 上次读取前后端的变化计数
+};
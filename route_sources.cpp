@@ -0,0 +1,323 @@
+#include "route_sources.h"
+#include "builtin_routes.h"
+#include "hash_utils.h"
+#include "metrics.h"
+#include "route_aggregate.h"
+#include "route_operations.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+  const size_t kMaxSources = 64;
+
+  // 同一文件的不同写法(相对路径、.\、大小写)对应同一个来源
+  std::string SourceKey(const std::string &filename)
+  {
+    if (IsBuiltinRouteName(filename))
+    {
+      return filename;
+    }
+    std::error_code ec;
+    std::filesystem::path path = std::filesystem::absolute(filename, ec);
+    if (ec)
+    {
+      path = filename;
+    }
+    std::string key = path.lexically_normal().string();
+#ifdef _WIN32
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c)
+                   { return (char)std::tolower(c); });
+#endif
+    return key;
+  }
+
+  int FindSource(const RouteState &state, const std::string &key)
+  {
+    for (size_t i = 0; i < state.sources.size(); i++)
+    {
+      if (state.sources[i] == key)
+      {
+        return (int)i;
+      }
+    }
+    return -1;
+  }
+
+  // 去掉不再属于任何来源的前缀
+  void DropUnowned(RouteState &state)
+  {
+    size_t kept = 0;
+    for (size_t i = 0; i < state.contributed.Size(); i++)
+    {
+      if (state.sourceMasks[i] != 0)
+      {
+        state.contributed.networks[kept] = state.contributed.networks[i];
+        state.contributed.prefixLens[kept] = state.contributed.prefixLens[i];
+        state.sourceMasks[kept] = state.sourceMasks[i];
+        kept++;
+      }
+    }
+    state.contributed.networks.resize(kept);
+    state.contributed.prefixLens.resize(kept);
+    state.sourceMasks.resize(kept);
+  }
+
+  /**
+   * @brief 去掉记录中已不在路由表里的路由
+   * @details 路由表读取失败时保留记录，之后的安装遇到已存在的路由会报告失败
+   */
+  void PruneMissing(RouteTableSnapshot &snapshot, RouteState &state)
+  {
+    if (!snapshot.Ensure())
+    {
+      return;
+    }
+    RouteSet present;
+    for (size_t i = 0; i < state.routes.Size(); i++)
+    {
+      RouteTableIndex::Range matches = snapshot.Index().Find(state.routes.networks[i], state.routes.prefixLens[i]);
+      for (const uint32_t *row = matches.begin; row != matches.end; row++)
+      {
+        const RouteEntry &entry = snapshot.Rows()[*row];
+        if (entry.gateway == state.gateway && entry.ifIndex == state.ifIndex)
+        {
+          present.Add(state.routes.networks[i], state.routes.prefixLens[i]);
+          break;
+        }
+      }
+    }
+    if (present.Size() != state.routes.Size())
+    {
+      std::cout << "Routes no longer in the routing table: " << state.routes.Size() - present.Size() << "\n";
+    }
+    state.routes = std::move(present);
+  }
+}
+
+bool HasRouteSource(const RouteState &state, const std::string &filename)
+{
+  return FindSource(state, SourceKey(filename)) >= 0;
+}
+
+bool SetRouteSource(RouteState &state, const std::string &filename, const RouteSet &routes)
+{
+  std::string key = SourceKey(filename);
+  int index = FindSource(state, key);
+  if (index < 0)
+  {
+    if (state.sources.size() >= kMaxSources)
+    {
+      std::cout << "Too many route files recorded (at most " << kMaxSources << "): " << filename << "\n";
+      return false;
+    }
+    index = (int)state.sources.size();
+    state.sources.push_back(key);
+  }
+  uint64_t bit = 1ull << index;
+
+  RouteSet added = routes;
+  SortUniqueRoutes(added);
+
+  // 两个有序序列合并，同一前缀的来源位取并
+  RouteSet merged;
+  std::vector<uint64_t> masks;
+  merged.Reserve(state.contributed.Size() + added.Size());
+  masks.reserve(state.contributed.Size() + added.Size());
+  size_t i = 0, j = 0;
+  while (i < state.contributed.Size() || j < added.Size())
+  {
+    uint64_t left = i < state.contributed.Size() ? KeyAt(state.contributed, i) : UINT64_MAX;
+    uint64_t right = j < added.Size() ? KeyAt(added, j) : UINT64_MAX;
+    if (left <= right)
+    {
+      merged.Add(state.contributed.networks[i], state.contributed.prefixLens[i]);
+      masks.push_back((state.sourceMasks[i] & ~bit) | (left == right ? bit : 0));
+      i++;
+      if (left == right)
+        j++;
+    }
+    else
+    {
+      merged.Add(added.networks[j], added.prefixLens[j]);
+      masks.push_back(bit);
+      j++;
+    }
+  }
+
+  state.contributed = std::move(merged);
+  state.sourceMasks = std::move(masks);
+  DropUnowned(state);
+  return true;
+}
+
+bool RemoveRouteSource(RouteState &state, const std::string &filename)
+{
+  int index = FindSource(state, SourceKey(filename));
+  if (index < 0)
+  {
+    return false;
+  }
+
+  // 去掉该位，更高的来源位右移一位，与 sources 的下标保持一致
+  uint64_t low = (1ull << index) - 1;
+  for (auto &mask : state.sourceMasks)
+  {
+    mask = (mask & low) | ((mask >> 1) & ~low);
+  }
+  state.sources.erase(state.sources.begin() + index);
+  DropUnowned(state);
+  return true;
+}
+
+void ClearRouteSources(RouteState &state)
+{
+  state.sources.clear();
+  state.contributed.Clear();
+  state.sourceMasks.clear();
+  state.tracked.Clear();
+}
+
+RouteSet SourceRoutes(const RouteState &state, size_t index)
+{
+  RouteSet routes;
+  uint64_t bit = 1ull << index;
+  for (size_t i = 0; i < state.contributed.Size(); i++)
+  {
+    if (state.sourceMasks[i] & bit)
+    {
+      routes.Add(state.contributed.networks[i], state.contributed.prefixLens[i]);
+    }
+  }
+  return routes;
+}
+
+RouteSet TrackedRoutes(const RouteState &state, const SourceOptions &options, bool verbose)
+{
+  RouteSet routes = state.contributed;
+  if (options.aggregate)
+  {
+    size_t before = routes.Size();
+    size_t saved = AggregateRoutes(routes);
+    if (verbose)
+      std::cout << "Aggregated " << before << " routes into " << routes.Size() << " (saved " << saved << ")\n";
+  }
+  if (options.maxRoutes > 0 && routes.Size() > options.maxRoutes)
+  {
+    size_t before = routes.Size();
+    BudgetResult budget = LimitRoutes(routes, options.maxRoutes);
+    if (verbose)
+      std::cout << "Limited " << before << " routes to " << routes.Size() << " (over-covered "
+                << budget.overCovered << " addresses)\n";
+  }
+  SortUniqueRoutes(routes);
+  return routes;
+}
+
+bool ApplyTrackedRoutes(RouteTableSnapshot &snapshot, RouteState &state, const std::string &statePath,
+                        const SourceOptions &options, unsigned jobs)
+{
+  ScopedTimer timer("apply_sources");
+  PruneMissing(snapshot, state);
+  SortUniqueRoutes(state.routes);
+  SortUniqueRoutes(state.tracked);
+
+  // 要删除的是上次按来源实际安装、新目标集合中没有的路由，与上次使用的选项无关
+  RouteSet desired = TrackedRoutes(state, options, true);
+  RouteSet tracked = FilterRoutes(state.tracked, state.routes, true);
+  RouteSet toAdd = FilterRoutes(desired, state.routes, false);
+  RouteSet toRemove = FilterRoutes(tracked, desired, false);
+  std::cout << "Routes from recorded files: " << desired.Size() << " (to add: " << toAdd.Size()
+            << ", to remove: " << toRemove.Size() << ")\n";
+
+  // 先把将要安装的路由写入记录，中途崩溃时 reset 仍能找到它们；完成前指纹无效
+  RouteSet owned = state.routes;
+  state.routes.Append(toAdd);
+  state.tracked = tracked;
+  state.tracked.Append(toAdd);
+  state.fingerprint = 0;
+  if (!SaveRouteState(statePath, state))
+  {
+    std::cout << "Failed to write state file: " << statePath << "\n";
+    return false;
+  }
+
+  bool ok = true;
+  if (!toAdd.Empty())
+  {
+    std::vector<uint64_t> weights;
+    if (options.hits)
+    {
+      weights = AttributeHits(toAdd, *options.hits);
+      SortByWeight(toAdd, weights);
+    }
+    RouteSet installed;
+    ok = AddRoutes(snapshot, toAdd, state.gateway, state.ifIndex, state.metric, jobs, &installed,
+                   options.hits ? &weights : nullptr);
+    state.routes = std::move(owned);
+    state.routes.Append(installed);
+    SortUniqueRoutes(state.routes);
+  }
+  if (!toRemove.Empty())
+  {
+    ok = DeleteOwnedRoutes(snapshot, state, &toRemove, jobs) && ok;
+  }
+  // 安装失败的前缀不在记录中，删除失败的前缀仍属于来源，下次再删除
+  SortUniqueRoutes(state.tracked);
+  state.tracked = FilterRoutes(state.tracked, state.routes, true);
+  state.fingerprint = ok ? RouteFingerprint(desired, state.gateway, state.ifIndex) : 0;
+  return SaveRouteState(statePath, state) && ok;
+}
+
+uint64_t RouteFingerprint(const RouteSet &routes, uint32_t gateway, uint32_t ifIndex)
+{
+  uint64_t hash = HashBytes(routes.networks.data(), routes.Size() * 4);
+  hash = HashBytes(routes.prefixLens.data(), routes.Size(), hash);
+  uint32_t nextHop[2] = {gateway, ifIndex};
+  hash = HashBytes(nextHop, sizeof(nextHop), hash);
+  return hash == 0 ? 1 : hash;
+}
+
+bool TrackedRoutesCurrent(RouteTableSnapshot &snapshot, const RouteState &state, const SourceOptions &options,
+                          uint32_t gateway, uint32_t ifIndex)
+{
+  ScopedTimer timer("fingerprint_check");
+  if (state.fingerprint == 0)
+  {
+    return false;
+  }
+
+  // 由本次的来源内容计算目标集合，与上次成功安装时的指纹比较
+  RouteSet desired = TrackedRoutes(state, options);
+  if (RouteFingerprint(desired, gateway, ifIndex) != state.fingerprint || !snapshot.Ensure())
+  {
+    return false;
+  }
+
+  // 路由表中该网关上的前缀排序后与目标集合做归并比较
+  std::vector<uint64_t> present;
+  present.reserve(snapshot.Rows().size());
+  for (const auto &row : snapshot.Rows())
+  {
+    if (row.gateway == gateway && row.ifIndex == ifIndex)
+    {
+      present.push_back(PrefixKey(row.destination, row.prefixLen));
+    }
+  }
+  std::sort(present.begin(), present.end());
+
+  size_t j = 0;
+  for (size_t i = 0; i < desired.Size(); i++)
+  {
+    uint64_t key = KeyAt(desired, i);
+    while (j < present.size() && present[j] < key)
+      j++;
+    if (j == present.size() || present[j] != key)
+    {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "types.h"
+#include "route_priority.h"
+#include "route_snapshot.h"
+#include "route_state.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief 由登记的来源计算目标集合的选项
+ */
+struct SourceOptions
+{
+  bool aggregate = true;           ///< 合并各来源的前缀后聚合
+  size_t maxRoutes = 0;            ///< 大于0时近似合并到该条数以内
+  const HitCounts *hits = nullptr; ///< 可选，命中次数高的前缀先安装
+};
+
+/**
+ * @brief 查找路由文件是否已登记为来源
+ * @param state 路由记录
+ * @param filename 路由文件路径，按规范化后的绝对路径比较
+ * @return bool 已登记返回true
+ */
+bool HasRouteSource(const RouteState &state, const std::string &filename);
+
+/**
+ * @brief 登记或更新一个路由文件的前缀
+ * @param[in,out] state 路由记录
+ * @param filename 路由文件路径
+ * @param routes 该文件当前包含的前缀
+ * @return bool 成功返回true，已登记64个来源且是新文件时返回false
+ * @details 1. 新文件占用一个来源位，已登记的文件先清除旧的位再按新内容设置
+ *          2. 与已有的来源前缀按有序合并，复杂度与两者的规模成线性
+ *          3. 不再被任何来源包含的前缀从来源前缀中移除
+ */
+bool SetRouteSource(RouteState &state, const std::string &filename, const RouteSet &routes);
+
+/**
+ * @brief 移除一个路由文件的登记
+ * @param[in,out] state 路由记录
+ * @param filename 路由文件路径
+ * @return bool 文件已登记返回true
+ * @details 清除该文件的来源位，后面的来源位依次前移，只属于该文件的前缀随之移除
+ */
+bool RemoveRouteSource(RouteState &state, const std::string &filename);
+
+/**
+ * @brief 清除全部来源登记
+ * @param[in,out] state 路由记录
+ * @details 已安装的路由不再对应任何文件(sync 以外的整体替换、reset 之后)，tracked 随之清空
+ */
+void ClearRouteSources(RouteState &state);
+
+/**
+ * @brief 取出一个来源登记的前缀
+ * @param state 路由记录
+ * @param index 来源下标(sources 中的位置)
+ * @return RouteSet 该来源包含的前缀，按(network, prefixLen)升序
+ */
+RouteSet SourceRoutes(const RouteState &state, size_t index);
+
+/**
+ * @brief 由登记的来源计算应安装的前缀集合
+ * @param state 路由记录
+ * @param options 聚合和条数上限
+ * @param verbose 为true时输出聚合和近似合并前后的条数
+ * @return RouteSet 各来源前缀的并集，按选项聚合或限制条数
+ */
+RouteSet TrackedRoutes(const RouteState &state, const SourceOptions &options, bool verbose = false);
+
+/**
+ * @brief 来源变化后只安装和删除变化的前缀
+ * @param snapshot 路由表快照，提供路由后端
+ * @param[in,out] state 路由记录，来源已经更新，已安装的前缀和 tracked 随操作结果更新
+ * @param statePath 状态文件路径，安装前先写入记录，结束后再写入一次
+ * @param options 本次的聚合和条数上限，可以与上次不同
+ * @param jobs 并发执行的工作线程数
+ * @return bool 没有失败的操作且状态文件写入成功返回true
+ * @details 1. 读取一次路由表，去掉记录中已不存在的路由(例如重启后)，使其可以重新安装
+ *          2. 新目标集合中尚未安装的前缀先安装，给出命中次数时按归属到各前缀的次数从高到低安装
+ *          3. 再删除 tracked 中有、新目标集合中没有的已安装前缀，
+ *             聚合后的父前缀拆分或合并时路由不会出现空档；
+ *             上次用 --max-routes 或 --no-aggregate 安装的路由也按实际安装的前缀删除
+ *          4. 不属于任何来源的已安装路由(stream、watch 安装的)不在 tracked 中，不受影响
+ *          5. 因此切换一个文件时，路由操作次数只与该文件独有的前缀数有关
+ *          6. 全部成功时记录目标集合的指纹，供下次 add 的快速路径使用
+ */
+bool ApplyTrackedRoutes(RouteTableSnapshot &snapshot, RouteState &state, const std::string &statePath,
+                        const SourceOptions &options, unsigned jobs);
+
+/**
+ * @brief 计算目标集合的指纹
+ * @param routes 按(network, prefixLen)升序的前缀集合
+ * @param gateway 网关地址
+ * @param ifIndex 接口索引
+ * @return uint64_t 前缀、网关和接口的哈希，不为0
+ */
+uint64_t RouteFingerprint(const RouteSet &routes, uint32_t gateway, uint32_t ifIndex);
+
+/**
+ * @brief 检查上次 add 的结果是否仍然有效，有效时 add 可以不做任何路由操作
+ * @param snapshot 路由表快照，未读取时读取一次
+ * @param state 路由记录，来源已按本次读取的文件内容更新
+ * @param options 聚合和条数上限
+ * @param gateway 当前默认网关
+ * @param ifIndex 当前默认网关的接口
+ * @return bool 全部一致返回true
+ * @details 1. 上次 add 全部成功(指纹不为0)
+ *          2. 由来源计算的目标集合、网关和接口的指纹与记录的指纹一致，
+ *             即本次要安装的聚合结果与上次完整安装的内容相同，与文件路径和修改时间无关
+ *          3. 路由表中该网关上的前缀排序后与目标集合归并比较，每个前缀都还在
+ *          不调用任何添加或删除接口
+ */
+bool TrackedRoutesCurrent(RouteTableSnapshot &snapshot, const RouteState &state, const SourceOptions &options,
+                          uint32_t gateway, uint32_t ifIndex);
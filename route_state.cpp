@@ -0,0 +1,266 @@
+#include "route_state.h"
+#include "file_operations.h"
+#include "hash_utils.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace
+{
+  const char kStateMagic[4] = {'W', 'R', 'S', 'T'};
+  const uint32_t kStateVersion = 2;
+  const char kStateFileName[] = "win-route.state";
+
+  struct StateHeader
+  {
+    char magic[4];
+    uint32_t version;
+    uint64_t generation;
+    uint32_t gateway;
+    uint32_t ifIndex;
+    uint32_t metric;
+    uint32_t routeCount;
+    uint64_t checksum;
+  };
+  static_assert(sizeof(StateHeader) == 40, "state header layout");
+
+  /**
+   * @brief 顺序读取来源部分，越界时失败
+   */
+  class Reader
+  {
+  public:
+    Reader(const char *data, size_t size) : cur_(data), end_(data + size) {}
+
+    bool Read(void *out, size_t size)
+    {
+      if ((size_t)(end_ - cur_) < size)
+        return false;
+      memcpy(out, cur_, size);
+      cur_ += size;
+      return true;
+    }
+
+    template <typename T>
+    bool ReadArray(std::vector<T> &out, size_t count)
+    {
+      if ((size_t)(end_ - cur_) / sizeof(T) < count)
+        return false;
+      out.resize(count);
+      return Read(out.data(), count * sizeof(T));
+    }
+
+    bool AtEnd() const { return cur_ == end_; }
+
+  private:
+    const char *cur_;
+    const char *end_;
+  };
+
+  // 版本2在已安装前缀之后追加来源、指纹和 tracked
+  bool ReadSources(const char *data, size_t size, RouteState &state)
+  {
+    Reader reader(data, size);
+    uint32_t sourceCount, contributedCount;
+    if (!reader.Read(&sourceCount, 4) || !reader.Read(&contributedCount, 4) || sourceCount > 64)
+      return false;
+
+    state.sources.resize(sourceCount);
+    for (auto &source : state.sources)
+    {
+      uint16_t length;
+      if (!reader.Read(&length, 2))
+        return false;
+      source.resize(length);
+      if (!reader.Read(&source[0], length))
+        return false;
+    }
+    if (!reader.ReadArray(state.contributed.networks, contributedCount) ||
+        !reader.ReadArray(state.contributed.prefixLens, contributedCount) ||
+        !reader.ReadArray(state.sourceMasks, contributedCount))
+      return false;
+    uint32_t trackedCount;
+    if (!reader.Read(&state.fingerprint, 8) || !reader.Read(&trackedCount, 4) ||
+        !reader.ReadArray(state.tracked.networks, trackedCount) ||
+        !reader.ReadArray(state.tracked.prefixLens, trackedCount))
+      return false;
+    return reader.AtEnd();
+  }
+
+  uint64_t Checksum(StateHeader header, const char *body, size_t size)
+  {
+    header.checksum = 0;
+    return HashBytes(body, size, HashBytes(&header, sizeof(header)));
+  }
+}
+
+std::string DefaultRouteStatePath(const char *argv0)
+{
+  std::filesystem::path exe;
+#ifdef _WIN32
+  char buffer[MAX_PATH];
+  DWORD length = GetModuleFileNameA(NULL, buffer, MAX_PATH);
+  if (length > 0 && length < MAX_PATH)
+  {
+    exe = std::string(buffer, length);
+  }
+#endif
+  if (exe.empty() && argv0 != nullptr)
+  {
+    exe = argv0;
+  }
+  return (exe.parent_path() / kStateFileName).string();
+}
+
+bool LoadRouteState(const std::string &filename, RouteState &state)
+{
+  MappedFile file;
+  if (!file.Open(filename))
+  {
+    return false;
+  }
+
+  const char *data = file.Data();
+  size_t size = file.Size();
+  StateHeader header;
+  bool valid = size >= sizeof(header);
+  if (valid)
+  {
+    memcpy(&header, data, sizeof(header));
+    uint64_t routesEnd = sizeof(header) + (uint64_t)header.routeCount * 5;
+    valid = memcmp(header.magic, kStateMagic, sizeof(kStateMagic)) == 0 &&
+            (header.version == 1 ? size == routesEnd : header.version == kStateVersion && size >= routesEnd) &&
+            header.checksum == Checksum(header, data + sizeof(header), size - sizeof(header));
+    state.sources.clear();
+    state.contributed.Clear();
+    state.sourceMasks.clear();
+    state.fingerprint = 0;
+    state.tracked.Clear();
+    if (valid && header.version == kStateVersion)
+    {
+      valid = ReadSources(data + routesEnd, size - routesEnd, state);
+    }
+  }
+  if (!valid)
+  {
+    std::cout << "Ignoring corrupt state file: " << filename << "\n";
+    return false;
+  }
+
+  state.generation = header.generation;
+  state.gateway = header.gateway;
+  state.ifIndex = header.ifIndex;
+  state.metric = header.metric;
+  state.routes.Clear();
+
+  // 文件头为8字节的整数倍，networks 数组天然4字节对齐
+  size_t count = header.routeCount;
+  const uint32_t *networks = (const uint32_t *)(data + sizeof(header));
+  const uint8_t *prefixLens = (const uint8_t *)(data + sizeof(header) + count * 4);
+  state.routes.networks.assign(networks, networks + count);
+  state.routes.prefixLens.assign(prefixLens, prefixLens + count);
+  return true;
+}
+
+bool SaveRouteState(const std::string &filename, RouteState &state)
+{
+  SortUniqueRoutes(state.routes);
+  SortUniqueRoutes(state.tracked);
+  state.generation++;
+
+  StateHeader header;
+  memcpy(header.magic, kStateMagic, sizeof(kStateMagic));
+  header.version = kStateVersion;
+  header.generation = state.generation;
+  header.gateway = state.gateway;
+  header.ifIndex = state.ifIndex;
+  header.metric = state.metric;
+  header.routeCount = (uint32_t)state.routes.Size();
+  header.checksum = 0;
+
+  std::string body;
+  body.reserve(state.routes.Size() * 5);
+  body.append((const char *)state.routes.networks.data(), state.routes.Size() * 4);
+  body.append((const char *)state.routes.prefixLens.data(), state.routes.Size());
+
+  uint32_t sourceCount = (uint32_t)state.sources.size();
+  uint32_t contributedCount = (uint32_t)state.contributed.Size();
+  body.append((const char *)&sourceCount, 4);
+  body.append((const char *)&contributedCount, 4);
+  for (const auto &source : state.sources)
+  {
+    uint16_t length = (uint16_t)source.size();
+    body.append((const char *)&length, 2);
+    body.append(source.data(), length);
+  }
+  body.append((const char *)state.contributed.networks.data(), contributedCount * 4);
+  body.append((const char *)state.contributed.prefixLens.data(), contributedCount);
+  body.append((const char *)state.sourceMasks.data(), contributedCount * 8);
+  body.append((const char *)&state.fingerprint, 8);
+  uint32_t trackedCount = (uint32_t)state.tracked.Size();
+  body.append((const char *)&trackedCount, 4);
+  body.append((const char *)state.tracked.networks.data(), trackedCount * 4);
+  body.append((const char *)state.tracked.prefixLens.data(), trackedCount);
+  header.checksum = Checksum(header, body.data(), body.size());
+
+  std::string image((const char *)&header, sizeof(header));
+  image += body;
+  return WriteFileAtomically(filename, image);
+}
+
+void SortUniqueRoutes(RouteSet &routes)
+{
+  std::vector<uint64_t> keys(routes.Size());
+  for (size_t i = 0; i < routes.Size(); i++)
+  {
+    keys[i] = KeyAt(routes, i);
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  routes.Clear();
+  routes.Reserve(keys.size());
+  for (uint64_t key : keys)
+  {
+    routes.Add((uint32_t)(key >> 8), (uint8_t)key);
+  }
+}
+
+bool ContainsRoute(const RouteSet &routes, uint32_t network, uint8_t prefixLen)
+{
+  auto first = routes.networks.begin();
+  auto last = routes.networks.end();
+  for (auto it = std::lower_bound(first, last, network); it != last && *it == network; ++it)
+  {
+    if (routes.prefixLens[it - first] == prefixLen)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+RouteSet FilterRoutes(const RouteSet &routes, const RouteSet &other, bool include)
+{
+  RouteSet result;
+  size_t j = 0;
+  for (size_t i = 0; i < routes.Size(); i++)
+  {
+    uint64_t key = KeyAt(routes, i);
+    while (j < other.Size() && KeyAt(other, j) < key)
+      j++;
+    bool found = j < other.Size() && KeyAt(other, j) == key;
+    if (found == include)
+    {
+      result.Add(routes.networks[i], routes.prefixLens[i]);
+    }
+  }
+  return result;
+}
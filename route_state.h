@@ -0,0 +1,85 @@
+#pragma once
+#include "types.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief 本工具安装的路由记录
+ * @details 记录 win-route 实际创建的每一行路由，reset/delete 据此精确删除，
+ *          不需要读取路由表，也不需要重新解析路由文件
+ */
+struct RouteState
+{
+  uint64_t generation = 0; ///< 每次保存加一，用于判断状态文件是否被其他进程更新
+  uint32_t gateway = 0;    ///< 路由使用的网关(主机字节序)
+  uint32_t ifIndex = 0;    ///< 路由使用的接口索引
+  uint32_t metric = 0;     ///< 路由使用的跃点数
+  RouteSet routes;         ///< 已安装的前缀，按(network, prefixLen)升序且不重复
+
+  std::vector<std::string> sources; ///< 登记的路由文件，最多64个，下标即来源位
+  RouteSet contributed;             ///< 各登记文件包含的前缀，按(network, prefixLen)升序且不重复
+  std::vector<uint64_t> sourceMasks; ///< 与 contributed 一一对应，第 i 位表示 sources[i] 包含该前缀
+
+  uint64_t fingerprint = 0; ///< 上次 add 全部成功时目标集合(聚合后的前缀内容)、网关和接口的哈希，失败时为0
+  RouteSet tracked;         ///< routes 中按登记的来源安装的前缀，按(network, prefixLen)升序，add/delete 只删除这些路由
+};
+
+/**
+ * @brief 获取默认的状态文件路径
+ * @param argv0 程序的 argv[0]
+ * @return std::string 可执行文件所在目录下的 win-route.state
+ */
+std::string DefaultRouteStatePath(const char *argv0);
+
+/**
+ * @brief 读取状态文件
+ * @param filename 状态文件路径
+ * @param[out] state 读取到的状态
+ * @return bool 文件存在且校验通过返回true
+ * @details 1. 文件头、版本、长度或校验和不符时视为损坏，输出提示并返回false
+ *          2. 兼容版本1的文件(只有已安装的前缀)，读出的状态没有登记的来源、指纹和 tracked
+ */
+bool LoadRouteState(const std::string &filename, RouteState &state);
+
+/**
+ * @brief 写入状态文件
+ * @param filename 状态文件路径
+ * @param[in,out] state 要写入的状态，写入前前缀会被排序去重，generation 加一
+ * @return bool 写入成功返回true
+ * @details 文件格式(小端序，版本2)：
+ *          1. 40字节文件头：魔数"WRST"、版本、generation、网关、接口索引、跃点数、路由数、校验和
+ *          2. networks 数组(每条4字节)，随后是 prefixLens 数组(每条1字节)
+ *          3. 来源数和来源前缀数(各4字节)，每个来源为2字节长度加文件名，
+ *             随后是来源前缀的 networks、prefixLens 和8字节的 sourceMasks 数组
+ *          4. fingerprint(8字节)
+ *          5. tracked 的前缀数(4字节)，随后是其 networks 和 prefixLens 数组
+ *          校验和覆盖整个文件(计算时校验和字段为0)，通过 WriteFileAtomically 替换旧文件，
+ *          写入过程中崩溃时读到的总是完整的旧状态或新状态
+ */
+bool SaveRouteState(const std::string &filename, RouteState &state);
+
+/**
+ * @brief 对前缀集合排序并去掉重复项
+ * @param routes 前缀集合
+ */
+void SortUniqueRoutes(RouteSet &routes);
+
+/**
+ * @brief 判断有序前缀集合中是否有某个前缀
+ * @param routes 按(network, prefixLen)升序且不重复的前缀集合
+ * @param network 网络地址(主机字节序)
+ * @param prefixLen 前缀长度
+ * @return bool 集合中有该前缀返回true
+ * @details 二分查找，复杂度 O(log n)
+ */
+bool ContainsRoute(const RouteSet &routes, uint32_t network, uint8_t prefixLen);
+
+/**
+ * @brief 有序集合求差或求交
+ * @param routes 按(network, prefixLen)升序且不重复的前缀集合
+ * @param other 同样有序且不重复的前缀集合
+ * @param include 为true时保留 routes 中也在 other 里的前缀(求交)，为false时保留不在 other 里的前缀(求差)
+ * @return RouteSet 结果，保持 routes 中的顺序
+ * @details 归并比较，复杂度 O(n + m)
+ */
+RouteSet FilterRoutes(const RouteSet &routes, const RouteSet &other, bool include);
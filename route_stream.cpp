@@ -0,0 +1,204 @@
+#include "route_stream.h"
+#include "metrics.h"
+#include "bounded_queue.h"
+#include "builtin_routes.h"
+#include "cidr_parser.h"
+#include "mapped_file.h"
+#include "route_cache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+  // 合并积压块时每批的最大路由数
+  const size_t kMaxBatch = 4096;
+
+  /**
+   * @brief 二进制路由集合和内置路由集合已经是解析结果，整体读出后按块转发
+   */
+  template <typename Emit>
+  bool ReadRouteSetBlocks(const std::string &filename, size_t blockBytes, Emit emit)
+  {
+    MappedFile file;
+    RouteSet routes;
+    if (IsBuiltinRouteName(filename))
+    {
+      if (!LoadBuiltinRoutes(filename, routes))
+      {
+        std::cout << "Unknown builtin route set: " << filename << "\n";
+        return false;
+      }
+    }
+    else if (!file.Open(filename) || !LoadRouteCacheImage(file.Data(), file.Size(), routes))
+    {
+      std::cout << "Invalid or unsupported route set file: " << filename << "\n";
+      return false;
+    }
+    size_t perBlock = std::max<size_t>(1, blockBytes / 16);
+    for (size_t begin = 0; begin < routes.Size(); begin += perBlock)
+    {
+      size_t end = std::min(routes.Size(), begin + perBlock);
+      RouteSet block;
+      block.networks.assign(routes.networks.begin() + begin, routes.networks.begin() + end);
+      block.prefixLens.assign(routes.prefixLens.begin() + begin, routes.prefixLens.begin() + end);
+      if (!emit(std::move(block)))
+      {
+        break;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief 按块读取一个文件，每块解析后交给 emit
+   * @return bool 文件能够打开返回true
+   * @details 文本用固定大小的缓冲区顺序读取，而不是映射整个文件，
+   *          内存占用只取决于块大小；不完整的最后一行留到下一块
+   */
+  template <typename Emit>
+  bool ReadBlocks(const std::string &filename, size_t blockBytes, const std::string &country, size_t &invalid,
+                  Emit emit)
+  {
+    if (IsBuiltinRouteName(filename))
+    {
+      return ReadRouteSetBlocks(filename, blockBytes, emit);
+    }
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (file == NULL)
+    {
+      std::cout << "Failed to open route file: " << filename << "\n";
+      return false;
+    }
+
+    std::vector<char> buffer(blockBytes);
+    size_t carry = 0; // 上一块留下的不完整行
+    size_t line = 1;
+    bool first = true;
+    for (;;)
+    {
+      buffer.resize(carry + blockBytes);
+      size_t count = fread(buffer.data() + carry, 1, blockBytes, file);
+      size_t total = carry + count;
+      bool eof = count < blockBytes;
+
+      if (first)
+      {
+        first = false;
+        if (IsRouteCacheImage(buffer.data(), total))
+        {
+          fclose(file);
+          return ReadRouteSetBlocks(filename, blockBytes, emit);
+        }
+      }
+
+      // 文件未读完时只解析到最后一个换行符
+      size_t parseBytes = total;
+      if (!eof)
+      {
+        const char *data = buffer.data();
+        while (parseBytes > 0 && data[parseBytes - 1] != '\n')
+        {
+          parseBytes--;
+        }
+      }
+
+      RouteSet block;
+      invalid += ParseCidrBuffer(buffer.data(), parseBytes, filename, block, line, country);
+      line += std::count(buffer.data(), buffer.data() + parseBytes, '\n');
+      carry = total - parseBytes;
+      memmove(buffer.data(), buffer.data() + parseBytes, carry);
+
+      if (!block.Empty() && !emit(std::move(block)))
+      {
+        break;
+      }
+      if (eof)
+      {
+        break;
+      }
+    }
+    fclose(file);
+    return true;
+  }
+}
+
+StreamResult StreamRoutes(RouteBackend &backend, const std::vector<std::string> &filenames, uint32_t gateway,
+                          uint32_t ifIndex, uint32_t metric, const StreamOptions &options,
+                          RouteSet *installed)
+{
+  ScopedTimer timer("stream_add");
+  StreamResult result;
+  auto start = std::chrono::steady_clock::now();
+  BoundedQueue<RouteSet> queue(options.queueDepth);
+
+  // 解析线程：依次读取各文件，队列满时等待安装线程
+  std::thread parser([&]()
+                     {
+    for (const auto &filename : filenames)
+    {
+      ReadBlocks(filename, options.blockBytes, options.country, result.invalid, [&](RouteSet block)
+                 { return queue.Push(std::move(block)); });
+    }
+    queue.Close(); });
+
+  // 当前线程：逐块安装。第一块到达后立即安装，之后把队列中已积压的块合并成一批，
+  // 安装慢于解析时批次自然变大，多个工作线程可以分到足够的任务
+  RouteSet block;
+  std::vector<RouteEntry> rows;
+  std::vector<uint32_t> codes;
+  while (queue.Pop(block))
+  {
+    rows.clear();
+    do
+    {
+      for (size_t i = 0; i < block.Size(); i++)
+      {
+        rows.push_back({block.networks[i], gateway, ifIndex, metric, block.prefixLens[i], ROUTE_PROTO_NETMGMT});
+      }
+    } while (result.firstRouteMs >= 0 && rows.size() < kMaxBatch && queue.TryPop(block));
+    result.parsed += rows.size();
+
+    // 先交给调用方记录再安装，中途崩溃时已安装的路由都在记录中
+    if (options.beforeBatch)
+    {
+      RouteSet batch;
+      batch.Reserve(rows.size());
+      for (const auto &row : rows)
+      {
+        batch.Add(row.destination, row.prefixLen);
+      }
+      if (!options.beforeBatch(batch))
+      {
+        result.stopped = true;
+        queue.Close();
+        break;
+      }
+    }
+
+    InstallResult partial = RunRouteOperations(backend, rows, RouteOperation::Create, options.jobs,
+                                               installed ? &codes : nullptr);
+    result.install.Merge(partial);
+    if (installed)
+    {
+      for (size_t i = 0; i < rows.size(); i++)
+      {
+        if (codes[i] == 0)
+        {
+          installed->Add(rows[i].destination, rows[i].prefixLen);
+        }
+      }
+    }
+    if (result.firstRouteMs < 0 && partial.succeeded > 0)
+    {
+      result.firstRouteMs =
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+  }
+
+  parser.join();
+  return result;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "route_installer.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 流水线安装选项
+ */
+struct StreamOptions
+{
+  size_t blockBytes = 4096; ///< 每块解析的文本字节数，按行边界切分
+  size_t queueDepth = 8;    ///< 解析线程最多领先安装线程的块数
+  unsigned jobs = 1;        ///< 安装每块路由的工作线程数
+  std::string country;      ///< delegated 统计文件只取该国家代码的记录
+  std::function<bool(const RouteSet &)> beforeBatch; ///< 可选，安装每批之前调用(如先写入状态文件)，返回false时停止
+};
+
+/**
+ * @brief 流水线安装结果
+ */
+struct StreamResult
+{
+  InstallResult install;   ///< 安装结果
+  size_t parsed = 0;       ///< 解析出的前缀数
+  size_t invalid = 0;      ///< 无效行数
+  double firstRouteMs = -1; ///< 从开始到第一块路由安装完成的耗时(毫秒)，没有路由时为-1
+  bool stopped = false;     ///< beforeBatch 返回false后停止，该批及之后的路由没有安装
+};
+
+/**
+ * @brief 边读取路由文件边安装路由
+ * @param backend 路由后端
+ * @param filenames 路由文件，按顺序处理，可以是文本文件或二进制路由集合
+ * @param gateway 网关(主机字节序)
+ * @param ifIndex 接口索引
+ * @param metric 跃点数
+ * @param options 流水线选项
+ * @param[out] installed 可选，追加实际创建成功的前缀
+ * @return StreamResult 安装统计
+ * @details 解析线程把文件按块解析后放入有界队列，当前线程逐块取出并安装：
+ *          1. 前面的文件在后面的文件还在读取时就已经生效
+ *          2. 队列有界，内存占用与输入大小无关，只取决于块大小和队列深度
+ *          3. 不做全局聚合，也不读写解析缓存；重复的前缀按已存在处理
+ *          4. 每批安装之前先调用 beforeBatch，调用方可以在路由生效前记录它们
+ */
+StreamResult StreamRoutes(RouteBackend &backend, const std::vector<std::string> &filenames, uint32_t gateway,
+                          uint32_t ifIndex, uint32_t metric, const StreamOptions &options,
+                          RouteSet *installed = nullptr);
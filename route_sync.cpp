@@ -0,0 +1,161 @@
+#include "route_sync.h"
+#include "metrics.h"
+#include <algorithm>
+
+void PlanSync(const std::vector<RouteEntry> &table, const RouteSet &desired, uint32_t gateway,
+              uint32_t ifIndex, uint32_t metric, const RouteState &owner, SyncPlan &plan)
+{
+  plan.toAdd.clear();
+  plan.toRemove.clear();
+  plan.unchanged = 0;
+  plan.kept.Clear();
+  plan.gateway = gateway;
+  plan.ifIndex = ifIndex;
+
+  // 目标前缀排序去重
+  std::vector<uint64_t> wanted(desired.Size());
+  for (size_t i = 0; i < desired.Size(); i++)
+  {
+    wanted[i] = PrefixKey(desired.networks[i], desired.prefixLens[i]);
+  }
+  if (!std::is_sorted(wanted.begin(), wanted.end()))
+  {
+    std::sort(wanted.begin(), wanted.end());
+  }
+  wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+
+  // 只考虑非默认的静态路由
+  std::vector<const RouteEntry *> current;
+  current.reserve(table.size());
+  for (const auto &row : table)
+  {
+    if (row.prefixLen > 0 && IsStaticRoute(row))
+    {
+      current.push_back(&row);
+    }
+  }
+  std::sort(current.begin(), current.end(), [](const RouteEntry *a, const RouteEntry *b)
+            { return PrefixKey(a->destination, a->prefixLen) < PrefixKey(b->destination, b->prefixLen); });
+
+  RouteEntry target = {0, gateway, ifIndex, metric, 0, ROUTE_PROTO_NETMGMT};
+  auto onTarget = [&](const RouteEntry *row)
+  {
+    return row->gateway == gateway && row->ifIndex == ifIndex;
+  };
+
+  auto owned = [&](const RouteEntry *row)
+  {
+    return row->gateway == owner.gateway && row->ifIndex == owner.ifIndex &&
+           ContainsRoute(owner.routes, row->destination, row->prefixLen);
+  };
+
+  size_t i = 0, j = 0;
+  while (i < wanted.size() || j < current.size())
+  {
+    uint64_t rowKey = j < current.size() ? PrefixKey(current[j]->destination, current[j]->prefixLen) : UINT64_MAX;
+
+    if (j == current.size() || (i < wanted.size() && wanted[i] < rowKey))
+    {
+      // 目标中有，表中没有
+      target.destination = (uint32_t)(wanted[i] >> 8);
+      target.prefixLen = (uint8_t)(wanted[i] & 0xFF);
+      plan.toAdd.push_back(target);
+      i++;
+    }
+    else if (i == wanted.size() || rowKey < wanted[i])
+    {
+      // 表中有，目标中没有：只删除本工具安装的路由
+      if (owned(current[j]))
+      {
+        plan.toRemove.push_back(*current[j]);
+      }
+      j++;
+    }
+    else
+    {
+      // 同一前缀可能有多行(不同网关或接口)，保留一条目标网关上的，其余属于本工具的删除
+      bool matched = false;
+      for (; j < current.size() && PrefixKey(current[j]->destination, current[j]->prefixLen) == rowKey; j++)
+      {
+        if (!matched && onTarget(current[j]))
+        {
+          // 同步前就在目标网关上的行只有记录中有该前缀时才属于本工具，手工添加的不记录；
+          // 切换网关部分失败时记录仍在旧网关上，已经切换过来的行也按前缀认领
+          matched = true;
+          plan.unchanged++;
+          if (ContainsRoute(owner.routes, current[j]->destination, current[j]->prefixLen))
+            plan.kept.Add(current[j]->destination, current[j]->prefixLen);
+        }
+        else if (owned(current[j]))
+        {
+          plan.toRemove.push_back(*current[j]);
+        }
+      }
+      if (!matched)
+      {
+        target.destination = (uint32_t)(rowKey >> 8);
+        target.prefixLen = (uint8_t)(rowKey & 0xFF);
+        plan.toAdd.push_back(target);
+      }
+      i++;
+    }
+  }
+}
+
+SyncResult ApplySyncPlan(RouteBackend &backend, const SyncPlan &plan)
+{
+  SyncResult result;
+  result.unchanged = plan.unchanged;
+  result.owned = plan.kept;
+
+  for (const auto &entry : plan.toAdd)
+  {
+    if (backend.CreateEntry(entry) == 0)
+    {
+      result.added++;
+      result.owned.Add(entry.destination, entry.prefixLen);
+    }
+    else
+    {
+      result.failed++;
+    }
+  }
+
+  // 删除失败的行仍在表中，目标网关上的继续记录，以后还能删除
+  for (const auto &entry : plan.toRemove)
+  {
+    if (backend.DeleteEntry(entry) == 0)
+    {
+      result.removed++;
+    }
+    else
+    {
+      result.failed++;
+      if (entry.gateway == plan.gateway && entry.ifIndex == plan.ifIndex)
+        result.owned.Add(entry.destination, entry.prefixLen);
+    }
+  }
+
+  return result;
+}
+
+SyncResult SyncRoutes(RouteTableSnapshot &snapshot, const RouteSet &desired, uint32_t gateway,
+                      uint32_t ifIndex, uint32_t metric, const RouteState &owner)
+{
+  ScopedTimer timer("sync");
+  if (!snapshot.Ensure())
+  {
+    // 没有任何改动，记录保持不变
+    SyncResult result;
+    result.failed = desired.Size();
+    if (owner.gateway == gateway && owner.ifIndex == ifIndex)
+      result.owned = owner.routes;
+    return result;
+  }
+
+  SyncPlan plan;
+  PlanSync(snapshot.Rows(), desired, gateway, ifIndex, metric, owner, plan);
+  SyncResult result = ApplySyncPlan(snapshot.Backend(), plan);
+  snapshot.Invalidate();
+  return result;
+}
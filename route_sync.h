@@ -0,0 +1,72 @@
+#pragma once
+#include "route_snapshot.h"
+#include "route_state.h"
+
+/**
+ * @brief 同步计划
+ * @details 使路由表收敛到目标集合所需的最少操作
+ */
+struct SyncPlan
+{
+  std::vector<RouteEntry> toAdd;    ///< 需要添加的路由
+  std::vector<RouteEntry> toRemove; ///< 需要删除的路由
+  size_t unchanged = 0;             ///< 已经存在且无需改动的路由数
+  RouteSet kept;                    ///< 已经在目标网关上且记录中有的目标前缀
+  uint32_t gateway = 0;             ///< 目标网关(主机字节序)
+  uint32_t ifIndex = 0;             ///< 目标接口索引
+};
+
+/**
+ * @brief 同步结果统计
+ */
+struct SyncResult
+{
+  size_t unchanged = 0; ///< 无需改动的路由数
+  size_t added = 0;     ///< 成功添加的路由数
+  size_t removed = 0;   ///< 成功删除的路由数
+  size_t failed = 0;    ///< 失败的操作数
+  RouteSet owned;       ///< 同步后目标网关上属于本工具的前缀：记录中保留的、添加成功的和删除失败的，未排序
+};
+
+/**
+ * @brief 计算同步计划
+ * @param table 当前路由表快照
+ * @param desired 目标前缀集合
+ * @param gateway 目标网关(主机字节序)
+ * @param ifIndex 目标接口索引
+ * @param metric 目标跃点数
+ * @param owner 状态文件中的记录，只有记录网关和接口上、记录中的前缀才属于本工具
+ * @param[out] plan 计算出的操作
+ * @details 对排序后的目标集合和路由表做归并连接，复杂度 O(n log n)：
+ *          1. 只考虑静态路由(NETMGMT)且跳过默认路由
+ *          2. 目标中有而表中没有(或不在目标网关上)的前缀需要添加
+ *          3. 只删除属于本工具的行：目标中已没有的前缀，以及目标前缀在旧网关上的重复行；
+ *             用户手工添加或其他程序安装的静态路由不会被删除
+ *          4. 同步前已在目标网关上的目标前缀不需要添加，只有记录中有该前缀时才计入 kept
+ *             (记录可能仍在切换部分失败前的旧网关上)
+ */
+void PlanSync(const std::vector<RouteEntry> &table, const RouteSet &desired, uint32_t gateway,
+              uint32_t ifIndex, uint32_t metric, const RouteState &owner, SyncPlan &plan);
+
+/**
+ * @brief 按计划执行同步
+ * @param backend 路由后端
+ * @param plan 同步计划
+ * @return SyncResult 执行统计
+ * @details 先添加后删除，同一前缀切换网关时不会出现无路由的间隙
+ */
+SyncResult ApplySyncPlan(RouteBackend &backend, const SyncPlan &plan);
+
+/**
+ * @brief 将路由表增量同步到目标集合
+ * @param snapshot 路由表快照，同步后被标记为失效
+ * @param desired 目标前缀集合
+ * @param gateway 目标网关(主机字节序)
+ * @param ifIndex 目标接口索引
+ * @param metric 目标跃点数
+ * @param owner 状态文件中的记录，见 PlanSync
+ * @return SyncResult 执行统计，owned 可直接作为新的记录
+ * @details 最多读取一次路由表，然后只发出收敛所需的添加和删除操作
+ */
+SyncResult SyncRoutes(RouteTableSnapshot &snapshot, const RouteSet &desired, uint32_t gateway,
+                      uint32_t ifIndex, uint32_t metric, const RouteState &owner);
@@ -0,0 +1,245 @@
+#include "route_watch.h"
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include "cidr_parser.h"
+#include "route_aggregate.h"
+#include "route_repoint.h"
+#include "route_state.h"
+
+PollingEventSource::PollingEventSource(const std::vector<std::string> &filenames, GatewayProbe probe,
+                                       unsigned intervalMs)
+    : filenames_(filenames), probe_(probe), intervalMs_(intervalMs ? intervalMs : 1)
+{
+  for (const auto &filename : filenames_)
+  {
+    files_.push_back(Stat(filename));
+  }
+  gateway_ = probe_();
+}
+
+PollingEventSource::FileState PollingEventSource::Stat(const std::string &filename) const
+{
+  FileState state = {0, 0, false};
+  std::error_code ec;
+  uint64_t size = std::filesystem::file_size(filename, ec);
+  if (ec)
+  {
+    return state;
+  }
+  auto mtime = std::filesystem::last_write_time(filename, ec);
+  if (ec)
+  {
+    return state;
+  }
+  state.size = size;
+  state.mtime = (int64_t)mtime.time_since_epoch().count();
+  state.exists = true;
+  return state;
+}
+
+bool PollingEventSource::Poll(WatchEvent &event)
+{
+  bool filesChanged = false;
+  for (size_t i = 0; i < filenames_.size(); i++)
+  {
+    FileState state = Stat(filenames_[i]);
+    if (state.exists != files_[i].exists || state.size != files_[i].size || state.mtime != files_[i].mtime)
+    {
+      files_[i] = state;
+      filesChanged = true;
+    }
+  }
+  if (filesChanged)
+  {
+    event.type = WatchEventType::FilesChanged;
+    return true;
+  }
+
+  DefaultGatewayInfo gateway = probe_();
+  if (gateway.valid != gateway_.valid || gateway.gateway != gateway_.gateway ||
+      gateway.ifIndex != gateway_.ifIndex)
+  {
+    gateway_ = gateway;
+    event.type = WatchEventType::GatewayChanged;
+    return true;
+  }
+  return false;
+}
+
+bool PollingEventSource::WaitEvent(WatchEvent &event, unsigned timeoutMs)
+{
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+  for (;;)
+  {
+    if (Poll(event))
+    {
+      return true;
+    }
+    if (timeoutMs == WATCH_WAIT_INFINITE)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs_));
+      continue;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline)
+    {
+      return false;
+    }
+    auto wait = std::min<std::chrono::steady_clock::duration>(deadline - now, std::chrono::milliseconds(intervalMs_));
+    std::this_thread::sleep_for(wait);
+  }
+}
+
+RouteWatcher::RouteWatcher(RouteTableSnapshot &snapshot, const std::vector<std::string> &filenames,
+                           const WatchOptions &options)
+    : snapshot_(snapshot), filenames_(filenames), options_(options)
+{
+  if (!options_.statePath.empty())
+  {
+    LoadRouteState(options_.statePath, state_);
+  }
+}
+
+void RouteWatcher::Mark(const WatchEvent &event)
+{
+  if (event.type == WatchEventType::FilesChanged)
+  {
+    filesDirty_ = true;
+  }
+  // 网关变化时路由表已经不同于快照
+  snapshot_.Invalidate();
+}
+
+bool RouteWatcher::Converge()
+{
+  if (!state_.sources.empty())
+  {
+    std::cout << "The state file records routes added from " << state_.sources.size()
+              << " files; delete them before starting watch, or use --state with another file.\n";
+    return false;
+  }
+
+  if (filesDirty_)
+  {
+    // 文件被删除或编辑器保存到一半时读到空集合，按空集合同步会删除全部路由；
+    // 保留上次的路由并保持 filesDirty_，下一个事件时重新读取
+    std::vector<RouteSet> perFile;
+    RouteSet routes = MergeRoutes(filenames_, options_.load, &perFile);
+    bool complete = !routes.Empty();
+    for (const auto &file : perFile)
+    {
+      complete = complete && !file.Empty();
+    }
+    if (complete)
+    {
+      if (options_.aggregate)
+      {
+        AggregateRoutes(routes);
+      }
+      if (options_.maxRoutes > 0)
+      {
+        LimitRoutes(routes, options_.maxRoutes);
+      }
+      routes_ = std::move(routes);
+      filesDirty_ = false;
+      loaded_ = true;
+    }
+    else
+    {
+      std::cout << "Some route files could not be loaded, keeping the previous routes until the next change.\n";
+      if (!loaded_)
+      {
+        return false;
+      }
+    }
+  }
+
+  if (!snapshot_.Ensure() || !snapshot_.DefaultRoute().valid)
+  {
+    std::cout << "Failed to get default gateway information, waiting for the next change.\n";
+    return false;
+  }
+
+  DefaultGatewayInfo gateway = snapshot_.DefaultRoute();
+
+  // 网关变化时逐条切换，避免先删后加造成的无路由窗口
+  if (lastGateway_.valid && (lastGateway_.gateway != gateway.gateway || lastGateway_.ifIndex != gateway.ifIndex))
+  {
+    RouteSet none;
+    bool recorded = state_.gateway == lastGateway_.gateway && state_.ifIndex == lastGateway_.ifIndex;
+    RepointResult repoint = RepointRoutes(snapshot_, lastGateway_.gateway, lastGateway_.ifIndex, gateway.gateway,
+                                          gateway.ifIndex, gateway.metric, options_.jobs,
+                                          recorded ? &state_.routes : &none);
+    std::cout << "Repointed " << repoint.moved << " routes from " << FormatIpv4(lastGateway_.gateway)
+              << " to " << FormatIpv4(gateway.gateway) << ", failed " << repoint.failures.failed << "\n";
+    // 记录中的路由已经随之切换到新网关；有失败时记录留在旧网关上，
+    // 接下来的同步删除旧网关上剩下的记录行，已切换的行按前缀认领
+    if (recorded && repoint.failures.failed == 0)
+    {
+      state_.gateway = gateway.gateway;
+      state_.ifIndex = gateway.ifIndex;
+    }
+  }
+  lastGateway_ = gateway;
+
+  lastResult_ = SyncRoutes(snapshot_, routes_, gateway.gateway, gateway.ifIndex, gateway.metric, state_);
+  state_.gateway = gateway.gateway;
+  state_.ifIndex = gateway.ifIndex;
+  state_.metric = gateway.metric;
+  // 只记录实际在表中的路由，添加失败的前缀下次收敛时重试
+  state_.routes = lastResult_.owned;
+  if (!options_.statePath.empty())
+  {
+    SaveRouteState(options_.statePath, state_);
+  }
+  convergeCount_++;
+
+  std::cout << "Synced " << routes_.Size() << " routes via " << FormatIpv4(gateway.gateway)
+            << " (ifIndex: " << gateway.ifIndex << "): added " << lastResult_.added
+            << ", removed " << lastResult_.removed << ", failed " << lastResult_.failed << "\n";
+  return !filesDirty_ && lastResult_.failed == 0;
+}
+
+bool RouteWatcher::Run(WatchEventSource &source)
+{
+  // 有登记的路由文件时 Converge 输出原因且不做修改
+  if (!Converge() && !state_.sources.empty())
+  {
+    return false;
+  }
+
+  WatchEvent event;
+  for (;;)
+  {
+    if (!source.WaitEvent(event, WATCH_WAIT_INFINITE))
+    {
+      continue;
+    }
+    if (event.type == WatchEventType::Stop)
+    {
+      return true;
+    }
+
+    // 去抖：直到安静 debounceMs 毫秒才处理
+    auto first = std::chrono::steady_clock::now();
+    Mark(event);
+    bool stop = false;
+    while (source.WaitEvent(event, options_.debounceMs))
+    {
+      if (event.type == WatchEventType::Stop)
+      {
+        stop = true;
+        break;
+      }
+      Mark(event);
+    }
+
+    Converge();
+    lastLatencyMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - first).count();
+    if (stop)
+    {
+      return true;
+    }
+  }
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "file_operations.h"
+#include "route_snapshot.h"
+#include "route_state.h"
+#include "route_sync.h"
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 监视事件类型
+ */
+enum class WatchEventType
+{
+  FilesChanged,   ///< 路由文件内容变化
+  GatewayChanged, ///< 默认网关或其接口变化
+  Stop            ///< 停止监视
+};
+
+struct WatchEvent
+{
+  WatchEventType type;
+};
+
+/// WaitEvent 一直等到有事件为止的超时值
+const unsigned WATCH_WAIT_INFINITE = 0xFFFFFFFF;
+
+/**
+ * @brief 监视事件来源接口
+ * @details 把文件变化和网关变化的检测与处理逻辑分开，测试时可以直接注入事件
+ */
+class WatchEventSource
+{
+public:
+  virtual ~WatchEventSource() = default;
+
+  /**
+   * @brief 等待下一个事件
+   * @param[out] event 收到的事件
+   * @param timeoutMs 最长等待时间(毫秒)，WATCH_WAIT_INFINITE 表示不超时
+   * @return bool 收到事件返回true，超时返回false
+   */
+  virtual bool WaitEvent(WatchEvent &event, unsigned timeoutMs) = 0;
+};
+
+/**
+ * @brief 轮询方式的事件来源
+ * @details 按固定间隔检查：
+ *          1. 各路由文件的大小和修改时间
+ *          2. 通过回调获取的默认网关(网关地址或接口变化即视为变化)，
+ *             回调应使用 RouteTableSnapshot::Update，路由表没有变化时不重新读取
+ */
+class PollingEventSource : public WatchEventSource
+{
+public:
+  using GatewayProbe = std::function<DefaultGatewayInfo()>;
+
+  PollingEventSource(const std::vector<std::string> &filenames, GatewayProbe probe, unsigned intervalMs);
+
+  bool WaitEvent(WatchEvent &event, unsigned timeoutMs) override;
+
+private:
+  struct FileState
+  {
+    uint64_t size;
+    int64_t mtime;
+    bool exists;
+  };
+
+  FileState Stat(const std::string &filename) const;
+  bool Poll(WatchEvent &event);
+
+  std::vector<std::string> filenames_;
+  std::vector<FileState> files_;
+  GatewayProbe probe_;
+  DefaultGatewayInfo gateway_;
+  unsigned intervalMs_;
+};
+
+/**
+ * @brief 监视选项
+ */
+struct WatchOptions
+{
+  unsigned debounceMs = 500; ///< 最后一个事件之后等待多久再应用变化
+  bool aggregate = true;     ///< 加载后是否聚合
+  unsigned jobs = 1;         ///< 切换网关时的工作线程数
+  size_t maxRoutes = 0;      ///< 路由条数上限，0表示不限制
+  std::string statePath;     ///< 启动时读取、每次同步后写入已安装路由的记录，为空时只记录在内存中
+  LoadOptions load;          ///< 文件加载选项
+};
+
+/**
+ * @brief 常驻监视器
+ * @details 在内存中保留已解析的路由集合和路由表快照：
+ *          1. 收到事件后进入去抖，连续的事件合并为一次处理
+ *          2. 只有文件变化时才重新加载文件，网关变化只重新同步
+ *          3. 网关变化时先用 RepointRoutes 把已有路由逐条切换到新网关
+ *          4. 每次处理都通过 SyncRoutes 只应用增量，只删除记录中属于本工具的路由
+ *          5. 记录中只保存同步后实际属于本工具的路由，部分失败时不会记录没有装上的前缀
+ *          6. 任一文件读取失败或没有有效前缀时保留上次的路由集合，下一个事件时重试；
+ *             从未完整读取过时不同步，不删除任何路由
+ */
+class RouteWatcher
+{
+public:
+  RouteWatcher(RouteTableSnapshot &snapshot, const std::vector<std::string> &filenames,
+               const WatchOptions &options);
+
+  /**
+   * @brief 持续处理事件，直到收到 Stop
+   * @param source 事件来源
+   * @return bool 状态文件中有 add 登记的路由文件时不启动，返回false；收到 Stop 后返回true
+   * @details 启动时先做一次完整收敛；空闲时不设超时地等待事件，轮询间隔完全由事件来源决定
+   */
+  bool Run(WatchEventSource &source);
+
+  /**
+   * @brief 立即收敛到当前文件内容和默认网关
+   * @return bool 同步没有失败的操作且文件全部读取成功返回true
+   * @details 状态文件中有 add 登记的路由文件时不做任何修改并返回false：
+   *          监视器按自己的文件同步，会使登记的来源、贡献位和已安装记录失效
+   */
+  bool Converge();
+
+  size_t ConvergeCount() const { return convergeCount_; }
+  const SyncResult &LastResult() const { return lastResult_; }
+  /// 最近一次从收到第一个事件到完成收敛的耗时(毫秒)
+  double LastLatencyMs() const { return lastLatencyMs_; }
+
+private:
+  void Mark(const WatchEvent &event);
+
+  RouteTableSnapshot &snapshot_;
+  std::vector<std::string> filenames_;
+  WatchOptions options_;
+  RouteSet routes_;
+  RouteState state_; ///< 已安装路由的记录
+  bool filesDirty_ = true;
+  bool loaded_ = false; ///< 是否成功读取过全部文件，之前不同步
+  size_t convergeCount_ = 0;
+  SyncResult lastResult_;
+  DefaultGatewayInfo lastGateway_ = {0, 0, 0, false}; ///< 上次同步使用的网关
+  double lastLatencyMs_ = 0;
+};
@@ -0,0 +1,2238 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "builtin_routes.h"
+#include "cidr_parser.h"
+#include "file_operations.h"
+#include "hash_utils.h"
+#include "memory_backend.h"
+#include "route_aggregate.h"
+#include "route_cache.h"
+#include "route_lpm.h"
+#include "route_operations.h"
+#include "route_patch.h"
+#include "route_priority.h"
+#include "route_repoint.h"
+#include "route_set_ops.h"
+#include "route_sources.h"
+#include "route_stream.h"
+#include "route_state.h"
+#include "route_sync.h"
+#include "route_watch.h"
+
+/**
+ * @brief 核心模块的测试程序
+ * @details 不依赖测试框架和系统路由表，路由表操作使用内存路由后端，可在任意平台运行：
+ *          1. 随机测试与暴力实现(地址位图、线性扫描等)逐项比较，种子固定，失败可以复现
+ *          2. 每个测试输出一行结果，有失败时返回1
+ *
+ *          用法示例：
+ *          win-route-tests
+ *          win-route-tests aggregate   # 只运行名称包含 aggregate 的测试
+ */
+int main(int argc, char *argv[]);
+
+namespace
+{
+  int failures = 0;
+
+  // 条件不成立时输出位置并记录失败，返回条件本身，便于失败后提前结束当前测试
+  bool Expect(bool condition, const char *text, int line)
+  {
+    if (!condition)
+    {
+      printf("  tests.cpp:%d: EXPECT(%s) failed\n", line, text);
+      failures++;
+    }
+    return condition;
+  }
+
+#define EXPECT(condition) Expect((condition), #condition, __LINE__)
+
+  /**
+   * @brief 在一个小地址空间内生成随机前缀
+   * @param rng 随机数生成器
+   * @param count 前缀数量
+   * @param base 地址空间的起始地址，按 bits 对齐
+   * @param bits 地址空间的大小为 2^bits 个地址
+   * @details 前缀长度在 32-bits 到 32 之间均匀抽样，集合中有重复、嵌套和相邻的兄弟前缀，顺序随机
+   */
+  RouteSet RandomRoutes(std::mt19937 &rng, size_t count, uint32_t base, unsigned bits)
+  {
+    RouteSet routes;
+    for (size_t i = 0; i < count; i++)
+    {
+      uint8_t prefixLen = (uint8_t)(32 - bits + rng() % (bits + 1));
+      uint32_t offset = bits == 32 ? (uint32_t)rng() : (uint32_t)(rng() & ((1u << bits) - 1));
+      routes.Add((base + offset) & PrefixToMask(prefixLen), prefixLen);
+    }
+    return routes;
+  }
+
+  // 前缀集合在 [base, base + 2^bits) 内覆盖的地址位图，前缀必须位于该空间内
+  std::vector<bool> Coverage(const RouteSet &routes, uint32_t base, unsigned bits)
+  {
+    std::vector<bool> covered((size_t)1 << bits, false);
+    for (size_t i = 0; i < routes.Size(); i++)
+    {
+      uint64_t first = routes.networks[i] - base;
+      uint64_t count = (uint64_t)1 << (32 - routes.prefixLens[i]);
+      std::fill(covered.begin() + first, covered.begin() + first + count, true);
+    }
+    return covered;
+  }
+
+  // 精确覆盖位图所需的最少前缀数：整块被覆盖的节点计1，否则分别统计两个子节点
+  size_t MinimalPrefixCount(const std::vector<bool> &covered, size_t first, size_t count)
+  {
+    size_t set = (size_t)std::count(covered.begin() + first, covered.begin() + first + count, true);
+    if (set == 0 || set == count)
+    {
+      return set == 0 ? 0 : 1;
+    }
+    return MinimalPrefixCount(covered, first, count / 2) + MinimalPrefixCount(covered, first + count / 2, count / 2);
+  }
+
+  // 按(网络地址, 前缀长度)严格升序，且前缀之间互不重叠
+  bool SortedDisjoint(const RouteSet &routes)
+  {
+    for (size_t i = 1; i < routes.Size(); i++)
+    {
+      uint64_t previousEnd = (uint64_t)routes.networks[i - 1] + ((uint64_t)1 << (32 - routes.prefixLens[i - 1]));
+      if (routes.networks[i] < previousEnd)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool SameRoutes(const RouteSet &left, const RouteSet &right)
+  {
+    return left.networks == right.networks && left.prefixLens == right.prefixLens;
+  }
+
+  // 临时目录中的测试文件路径
+  std::string TempPath(const std::string &name)
+  {
+    return (std::filesystem::temp_directory_path() / ("win-route-tests-" + name)).string();
+  }
+
+  std::string ReadBytes(const std::string &filename)
+  {
+    std::ifstream file(filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+
+  bool WriteRouteFile(const std::string &filename, const std::vector<std::string> &lines)
+  {
+    std::string text;
+    for (const auto &line : lines)
+      text += line + "\n";
+    return WriteFileAtomically(filename, text);
+  }
+
+  // 测试期间丢弃标准输出，析构时恢复
+  class QuietOutput
+  {
+  public:
+    QuietOutput() : saved_(std::cout.rdbuf(nullptr)) {}
+    ~QuietOutput() { std::cout.rdbuf(saved_); }
+
+  private:
+    std::streambuf *saved_;
+  };
+
+  /**
+   * @brief 聚合前后覆盖的地址完全相同，结果有序、互不重叠且条数最少
+   * @details 随机集合位于 10.0.0.0 起的 2^12 个地址内，条数最少与位图上的递归计数比较
+   */
+  void TestAggregateCoverage()
+  {
+    std::mt19937 rng(3);
+    const uint32_t base = 0x0A000000u;
+    for (int round = 0; round < 2000; round++)
+    {
+      RouteSet routes = RandomRoutes(rng, 1 + rng() % 64, base, 12);
+      std::vector<bool> before = Coverage(routes, base, 12);
+      size_t input = routes.Size();
+      size_t saved = AggregateRoutes(routes);
+      if (!EXPECT(Coverage(routes, base, 12) == before) || !EXPECT(SortedDisjoint(routes)) ||
+          !EXPECT(routes.Size() == MinimalPrefixCount(before, 0, before.size())) ||
+          !EXPECT(saved == input - routes.Size()))
+      {
+        printf("  round %d\n", round);
+        return;
+      }
+    }
+  }
+
+  // 地址空间两端和整个空间的聚合
+  void TestAggregateEdges()
+  {
+    RouteSet routes;
+    routes.Add(0xFFFFFFFFu, 32);
+    routes.Add(0xFFFFFFFEu, 32);
+    AggregateRoutes(routes);
+    RouteSet expected;
+    expected.Add(0xFFFFFFFEu, 31);
+    EXPECT(SameRoutes(routes, expected));
+
+    routes.Clear();
+    routes.Add(0x0A000000u, 8);
+    routes.Add(0, 0);
+    routes.Add(0xC0A80000u, 16);
+    AggregateRoutes(routes);
+    expected.Clear();
+    expected.Add(0, 0);
+    EXPECT(SameRoutes(routes, expected));
+
+    routes.Clear();
+    routes.Add(0, 1);
+    routes.Add(0x80000000u, 1);
+    AggregateRoutes(routes);
+    EXPECT(SameRoutes(routes, expected));
+
+    routes.Clear();
+    EXPECT(AggregateRoutes(routes) == 0 && routes.Empty());
+  }
+
+  /**
+   * @brief 暴力求位图 [first, first + count) 内用不超过 k 条前缀覆盖全部置位地址时最少多覆盖的地址数
+   * @return std::vector<uint64_t> 下标为 k(0..maxRoutes)，无法覆盖时为 UINT64_MAX
+   * @details 在未压缩的字典树上递归：整块作为一条前缀，或者把 k 条分给两半
+   */
+  std::vector<uint64_t> BruteForceLimit(const std::vector<bool> &covered, size_t first, size_t count, size_t maxRoutes)
+  {
+    size_t set = (size_t)std::count(covered.begin() + first, covered.begin() + first + count, true);
+    std::vector<uint64_t> best(maxRoutes + 1, set == 0 ? 0 : UINT64_MAX);
+    if (set == 0)
+    {
+      return best;
+    }
+    std::fill(best.begin() + 1, best.end(), count - set);
+    if (count > 1)
+    {
+      std::vector<uint64_t> left = BruteForceLimit(covered, first, count / 2, maxRoutes);
+      std::vector<uint64_t> right = BruteForceLimit(covered, first + count / 2, count / 2, maxRoutes);
+      for (size_t k = 0; k <= maxRoutes; k++)
+      {
+        for (size_t k1 = 0; k1 <= k; k1++)
+        {
+          if (left[k1] != UINT64_MAX && right[k - k1] != UINT64_MAX)
+          {
+            best[k] = std::min(best[k], left[k1] + right[k - k1]);
+          }
+        }
+      }
+    }
+    return best;
+  }
+
+  // 结果覆盖原集合，多覆盖的地址数与返回值一致
+  bool CoversExactly(const std::vector<bool> &before, const std::vector<bool> &after, uint64_t overCovered)
+  {
+    uint64_t extra = 0;
+    for (size_t i = 0; i < before.size(); i++)
+    {
+      if (before[i] && !after[i])
+      {
+        return false;
+      }
+      extra += after[i] && !before[i] ? 1 : 0;
+    }
+    return extra == overCovered;
+  }
+
+  /**
+   * @brief 近似聚合覆盖原集合，条数不超过上限，多覆盖的地址数最少
+   * @details 随机集合位于 10.0.0.0/26 内，最少多覆盖的地址数与未压缩字典树上的暴力搜索比较
+   */
+  void TestLimitRoutesMinimal()
+  {
+    std::mt19937 rng(16);
+    const uint32_t base = 0x0A000000u;
+    for (int round = 0; round < 2000; round++)
+    {
+      RouteSet routes = RandomRoutes(rng, 1 + rng() % 24, base, 6);
+      std::vector<bool> before = Coverage(routes, base, 6);
+      size_t maxRoutes = 1 + rng() % 12;
+      BudgetResult budget = LimitRoutes(routes, maxRoutes);
+      std::vector<uint64_t> best = BruteForceLimit(before, 0, before.size(), maxRoutes);
+      if (!EXPECT(routes.Size() <= maxRoutes) || !EXPECT(SortedDisjoint(routes)) ||
+          !EXPECT(CoversExactly(before, Coverage(routes, base, 6), budget.overCovered)) ||
+          !EXPECT(budget.overCovered == best[maxRoutes]))
+      {
+        printf("  round %d\n", round);
+        return;
+      }
+    }
+  }
+
+  /**
+   * @brief 规模超过精确求解上限时的贪心合并
+   * @details 10.0.0.0/8 内分散的6万条 /28 到 /32 前缀，只检查覆盖、条数和多覆盖的地址数
+   */
+  void TestLimitRoutesGreedy()
+  {
+    std::mt19937 rng(17);
+    const uint32_t base = 0x0A000000u;
+    for (int round = 0; round < 4; round++)
+    {
+      RouteSet routes;
+      for (int i = 0; i < 60000; i++)
+      {
+        routes.Append(RandomRoutes(rng, 1, base + ((rng() & 0xFFFFF) << 4), 4));
+      }
+      std::vector<bool> before = Coverage(routes, base, 24);
+      size_t maxRoutes = 3000 + rng() % 3000;
+      BudgetResult budget = LimitRoutes(routes, maxRoutes);
+      if (!EXPECT(routes.Size() <= maxRoutes) || !EXPECT(SortedDisjoint(routes)) ||
+          !EXPECT(CoversExactly(before, Coverage(routes, base, 24), budget.overCovered)))
+      {
+        printf("  round %d\n", round);
+        return;
+      }
+    }
+
+    // 两半地址空间各有前缀时不会合并出 0.0.0.0/0
+    RouteSet routes;
+    routes.Add(0x01000000u, 8);
+    routes.Add(0xC8000000u, 8);
+    routes.Add(0xC9000000u, 8);
+    BudgetResult budget = LimitRoutes(routes, 1);
+    RouteSet expected;
+    expected.Add(0x01000000u, 8);
+    expected.Add(0xC8000000u, 7);
+    EXPECT(SameRoutes(routes, expected) && budget.overCovered == 0 && budget.merged == 0);
+  }
+
+  // 区间有序、不重叠且不相邻
+  bool CanonicalRanges(const std::vector<AddressRange> &ranges)
+  {
+    for (size_t i = 0; i < ranges.size(); i++)
+    {
+      if (ranges[i].first > ranges[i].last || (i > 0 && (uint64_t)ranges[i - 1].last + 1 >= ranges[i].first))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // 区间集合在 [base, base + 2^bits) 内覆盖的地址位图，区间必须位于该空间内
+  std::vector<bool> RangeCoverage(const std::vector<AddressRange> &ranges, uint32_t base, unsigned bits)
+  {
+    std::vector<bool> covered((size_t)1 << bits, false);
+    for (const AddressRange &range : ranges)
+    {
+      std::fill(covered.begin() + (range.first - base), covered.begin() + (range.last - base) + 1, true);
+    }
+    return covered;
+  }
+
+  /**
+   * @brief 区间集合的并、交、差、补和前缀转换与地址位图上的逐位运算一致
+   * @details 地址空间为 2^12 个地址，起始地址轮流取 0.0.0.0、10.0.0.0 和 255.255.240.0，
+   *          覆盖地址空间两端；补集在空间外的部分单独检查
+   */
+  void TestSetOpsBitmap()
+  {
+    std::mt19937 rng(17);
+    const uint32_t bases[] = {0, 0x0A000000u, 0xFFFFF000u};
+    const unsigned bits = 12;
+    for (int round = 0; round < 3000; round++)
+    {
+      uint32_t base = bases[round % 3];
+      uint32_t end = base + ((1u << bits) - 1);
+      std::vector<AddressRange> universe = {{base, end}};
+      RouteSet left = RandomRoutes(rng, rng() % 24, base, bits);
+      RouteSet right = RandomRoutes(rng, rng() % 24, base, bits);
+      std::vector<bool> leftBits = Coverage(left, base, bits);
+      std::vector<bool> rightBits = Coverage(right, base, bits);
+
+      std::vector<AddressRange> a, b;
+      RoutesToRanges(left, a);
+      RoutesToRanges(right, b);
+      std::vector<AddressRange> joined = UnionRanges(a, b);
+      std::vector<AddressRange> common = IntersectRanges(a, b);
+      std::vector<AddressRange> rest = SubtractRanges(a, b);
+      std::vector<AddressRange> outside = ComplementRanges(a);
+
+      std::vector<bool> joinedBits(leftBits.size()), commonBits(leftBits.size()), restBits(leftBits.size()),
+          outsideBits(leftBits.size());
+      for (size_t i = 0; i < leftBits.size(); i++)
+      {
+        joinedBits[i] = leftBits[i] || rightBits[i];
+        commonBits[i] = leftBits[i] && rightBits[i];
+        restBits[i] = leftBits[i] && !rightBits[i];
+        outsideBits[i] = !leftBits[i];
+      }
+
+      // 补集在空间外的部分为空间两侧的整段
+      std::vector<AddressRange> beyond;
+      if (base > 0)
+        beyond.push_back({0, base - 1});
+      if (end < UINT32_MAX)
+        beyond.push_back({end + 1, UINT32_MAX});
+      std::vector<AddressRange> outsideBeyond = SubtractRanges(outside, universe);
+
+      RouteSet routes;
+      RangesToRoutes(joined, routes);
+      if (!EXPECT(CanonicalRanges(a) && RangeCoverage(a, base, bits) == leftBits) ||
+          !EXPECT(CanonicalRanges(joined) && RangeCoverage(joined, base, bits) == joinedBits) ||
+          !EXPECT(CanonicalRanges(common) && RangeCoverage(common, base, bits) == commonBits) ||
+          !EXPECT(CanonicalRanges(rest) && RangeCoverage(rest, base, bits) == restBits) ||
+          !EXPECT(CanonicalRanges(outside) &&
+                  RangeCoverage(IntersectRanges(outside, universe), base, bits) == outsideBits) ||
+          !EXPECT(outsideBeyond.size() == beyond.size() &&
+                  std::equal(beyond.begin(), beyond.end(), outsideBeyond.begin(),
+                             [](const AddressRange &x, const AddressRange &y)
+                             { return x.first == y.first && x.last == y.last; })) ||
+          !EXPECT(Coverage(routes, base, bits) == joinedBits && SortedDisjoint(routes) &&
+                  routes.Size() == MinimalPrefixCount(joinedBits, 0, joinedBits.size())))
+      {
+        printf("  round %d\n", round);
+        return;
+      }
+    }
+  }
+
+  // 空集合、整个地址空间和单个地址的补集
+  void TestSetOpsEdges()
+  {
+    std::vector<AddressRange> empty;
+    std::vector<AddressRange> all = ComplementRanges(empty);
+    EXPECT(all.size() == 1 && all[0].first == 0 && all[0].last == UINT32_MAX);
+    EXPECT(ComplementRanges(all).empty());
+    EXPECT(SubtractRanges(all, all).empty() && IntersectRanges(all, empty).empty());
+
+    RouteSet routes;
+    RangesToRoutes(all, routes);
+    EXPECT(routes.Size() == 1 && routes.networks[0] == 0 && routes.prefixLens[0] == 0);
+
+    std::vector<AddressRange> ends = {{0, 0}, {UINT32_MAX, UINT32_MAX}};
+    std::vector<AddressRange> middle = ComplementRanges(ends);
+    EXPECT(middle.size() == 1 && middle[0].first == 1 && middle[0].last == UINT32_MAX - 1);
+    std::vector<AddressRange> joined = UnionRanges(middle, ends);
+    EXPECT(joined.size() == 1 && joined[0].first == 0 && joined[0].last == UINT32_MAX);
+
+    routes.Clear();
+    RangesToRoutes(middle, routes);
+    EXPECT(routes.Size() == 62);
+  }
+
+  // 在作用域内把 std::cout 的输出收集到字符串
+  class CapturedOutput
+  {
+  public:
+    CapturedOutput() : saved_(std::cout.rdbuf(buffer_.rdbuf())) {}
+    ~CapturedOutput() { std::cout.rdbuf(saved_); }
+    std::string Text() const { return buffer_.str(); }
+
+  private:
+    std::ostringstream buffer_;
+    std::streambuf *saved_;
+  };
+
+  // 解析一段文本，无效行的提示收集到 output
+  size_t ParseText(const std::string &text, RouteSet &routes, std::string &output,
+                   const std::string &country = std::string())
+  {
+    CapturedOutput captured;
+    size_t invalid = ParseCidrBuffer(text.data(), text.size(), "input", routes, 1, country);
+    output = captured.Text();
+    return invalid;
+  }
+
+  /**
+   * @brief 地址范围行和 delegated 记录转换为恰好覆盖该范围的最少前缀
+   * @details 每行单独解析，与区间的地址位图和最少前缀数比较；地址空间为 10.0.0.0 起的 2^12 个地址
+   */
+  void TestParseRangesExact()
+  {
+    std::mt19937 rng(18);
+    const uint32_t base = 0x0A000000u;
+    const unsigned bits = 12;
+    for (int round = 0; round < 2000; round++)
+    {
+      uint32_t first = base + (rng() & ((1u << bits) - 1));
+      uint32_t last = base + (rng() & ((1u << bits) - 1));
+      if (last < first)
+        std::swap(first, last);
+      std::vector<bool> expected = RangeCoverage({{first, last}}, base, bits);
+      size_t minimal = MinimalPrefixCount(expected, 0, expected.size());
+
+      std::string lines[] = {
+          FormatIpv4(first) + "-" + FormatIpv4(last),
+          FormatIpv4(first) + " - " + FormatIpv4(last) + "\r",
+          "apnic|CN|ipv4|" + FormatIpv4(first) + "|" + std::to_string(last - first + 1) + "|20110414|allocated",
+      };
+      for (const std::string &line : lines)
+      {
+        RouteSet routes;
+        std::string output;
+        if (!EXPECT(ParseText(line, routes, output) == 0 && output.empty()) ||
+            !EXPECT(Coverage(routes, base, bits) == expected) || !EXPECT(SortedDisjoint(routes)) ||
+            !EXPECT(routes.Size() == minimal))
+        {
+          printf("  round %d: %s\n", round, line.c_str());
+          return;
+        }
+      }
+    }
+
+    // 地址空间两端
+    RouteSet routes;
+    std::string output;
+    ParseText("0.0.0.0-255.255.255.255\napnic|ZZ|ipv4|255.255.255.0|256|20110414|allocated\n", routes, output);
+    RouteSet expected;
+    expected.Add(0, 0);
+    expected.Add(0xFFFFFF00u, 24);
+    EXPECT(SameRoutes(routes, expected) && output.empty());
+  }
+
+  /**
+   * @brief delegated 文件中每种行的处理
+   * @details 只有版本行、汇总行、asn/ipv6 记录、其他国家和 available/reserved 记录跳过，
+   *          其余格式不正确的行都是带行号的无效行
+   */
+  void TestParseDelegatedLines()
+  {
+    const std::string text = "2|apnic|20260101|5|19830613|20260101|+1000\n"
+                             "apnic|*|ipv4|*|3|summary\n"
+                             "apnic|CN|asn|4608|1|20110414|allocated\n"
+                             "apnic|CN|ipv6|2001:250::|32|20110414|allocated\n"
+                             "apnic|CN|ipv4|1.0.1.0|256|20110414|allocated\n"
+                             "apnic|JP|ipv4|1.0.16.0|4096|20110412|allocated\n"
+                             "apnic||ipv4|1.0.32.0|256||available\n"
+                             "apnic|CN|ipv4|1.0.2.0|256\n"
+                             "apnic|CN|ipv4|1.0.3.0|abc|20110414|allocated\n"
+                             "apnic|CN|ipv4|1.0.3.0|0|20110414|allocated\n"
+                             "apnic|CN|ipv4|255.255.255.0|512|20110414|allocated\n"
+                             "apnic|CN|ipv4|1.0.300.0|256|20110414|allocated\n"
+                             "apnic|CN|ipv5|1.0.4.0|256|20110414|allocated\n"
+                             "apnic|CN\n"
+                             "|\n"
+                             "apnic|*|ipv4|*|3\n"
+                             "apnic|CN|ipv4|1.0.5.0|768|20110414|allocated|e-stats\n";
+    const std::string invalid = "input:8: Invalid CIDR format: apnic|CN|ipv4|1.0.2.0|256\n"
+                                "input:9: Invalid CIDR format: apnic|CN|ipv4|1.0.3.0|abc|20110414|allocated\n"
+                                "input:10: Invalid CIDR format: apnic|CN|ipv4|1.0.3.0|0|20110414|allocated\n"
+                                "input:11: Invalid CIDR format: apnic|CN|ipv4|255.255.255.0|512|20110414|allocated\n"
+                                "input:12: Invalid CIDR format: apnic|CN|ipv4|1.0.300.0|256|20110414|allocated\n"
+                                "input:13: Invalid CIDR format: apnic|CN|ipv5|1.0.4.0|256|20110414|allocated\n"
+                                "input:14: Invalid CIDR format: apnic|CN\n"
+                                "input:15: Invalid CIDR format: |\n"
+                                "input:16: Invalid CIDR format: apnic|*|ipv4|*|3\n";
+
+    RouteSet routes;
+    std::string output;
+    EXPECT(ParseText(text, routes, output) == 9);
+    EXPECT(output == invalid);
+    RouteSet expected;
+    expected.Add(0x01000100u, 24);
+    expected.Add(0x01001000u, 20);
+    expected.Add(0x01000500u, 24);
+    expected.Add(0x01000600u, 23);
+    EXPECT(SameRoutes(routes, expected));
+
+    // 指定国家时其他国家的记录跳过，格式错误的行不论国家都是无效行
+    routes.Clear();
+    EXPECT(ParseText(text, routes, output, "CN") == 9);
+    EXPECT(output == invalid);
+    expected.Clear();
+    expected.Add(0x01000100u, 24);
+    expected.Add(0x01000500u, 24);
+    expected.Add(0x01000600u, 23);
+    EXPECT(SameRoutes(routes, expected));
+  }
+
+  // 分别用SIMD和标量路径解析 text 开头的地址，比较结果、地址和解析的长度
+  bool SimdMatchesScalar(const std::string &text)
+  {
+    uint32_t addresses[2] = {0, 0};
+    bool parsed[2];
+    size_t lengths[2] = {0, 0};
+    for (int simd = 0; simd < 2; simd++)
+    {
+      SetSimdParsing(simd == 1);
+      const char *p = text.data();
+      parsed[simd] = ParseIpv4(p, text.data() + text.size(), addresses[simd]);
+      lengths[simd] = (size_t)(p - text.data());
+    }
+    return parsed[0] == parsed[1] && (!parsed[0] || (addresses[0] == addresses[1] && lengths[0] == lengths[1]));
+  }
+
+  /**
+   * @brief 地址解析的SIMD路径与标量实现逐项一致
+   * @details 1. 四段从一组边界取值中穷举：空段、前导零、3位和4位数字、255/256 等大于255的值，
+   *             地址长度覆盖3到19字节，跨过SIMD路径7到15字节的范围和16字节的加载宽度
+   *          2. 每个地址后接不同的结束字符，并补齐到16字节以上，使SIMD路径一定会被尝试
+   *          3. 同一组地址拼成一个文件整体解析，行尾落在16字节加载范围内的不同位置
+   *          4. 随机字节串补充穷举没有覆盖的组合
+   *          不支持SSSE3的平台上两次都走标量实现，测试仍然通过
+   */
+  void TestParseSimdScalar()
+  {
+    bool simd = SetSimdParsing(true);
+    const char *octets[] = {"",   "0",   "00",  "000", "0000", "1",   "01",  "001", "9",   "10",
+                            "99", "100", "199", "249", "255",  "256", "259", "300", "999", "1000"};
+    const char *suffixes[] = {"/24", ".1", "1", " ", "\n", "-"};
+    const size_t count = sizeof(octets) / sizeof(octets[0]);
+    std::string file;
+    for (size_t a = 0; a < count; a++)
+      for (size_t b = 0; b < count; b++)
+        for (size_t c = 0; c < count; c++)
+          for (size_t d = 0; d < count; d++)
+          {
+            std::string address = std::string(octets[a]) + "." + octets[b] + "." + octets[c] + "." + octets[d];
+            for (const char *suffix : suffixes)
+            {
+              if (!EXPECT(SimdMatchesScalar(address + suffix + std::string(16, ' '))))
+              {
+                printf("  address \"%s%s\"\n", address.c_str(), suffix);
+                SetSimdParsing(simd);
+                return;
+              }
+            }
+            file += address + "/" + std::to_string((a + b + c + d) % 33) + "\n";
+          }
+
+    RouteSet routes[2];
+    std::string output[2];
+    size_t invalid[2];
+    for (int mode = 0; mode < 2; mode++)
+    {
+      SetSimdParsing(mode == 1);
+      invalid[mode] = ParseText(file, routes[mode], output[mode]);
+    }
+    EXPECT(invalid[0] == invalid[1] && output[0] == output[1] && SameRoutes(routes[0], routes[1]));
+    EXPECT(routes[0].Size() > 0 && invalid[0] > 0);
+
+    std::mt19937 rng(20);
+    const char alphabet[] = "0123456789..../ x";
+    for (int round = 0; round < 200000; round++)
+    {
+      std::string text;
+      size_t length = rng() % 24;
+      for (size_t i = 0; i < length; i++)
+        text.push_back(alphabet[rng() % (sizeof(alphabet) - 1)]);
+      text.append(rng() % 2 ? 16 : 0, ' ');
+      if (!EXPECT(SimdMatchesScalar(text)))
+      {
+        printf("  round %d: \"%s\"\n", round, text.c_str());
+        break;
+      }
+    }
+    SetSimdParsing(simd);
+  }
+
+  /**
+   * @brief 多块输入并行解析与逐个文件单线程解析的结果和无效行提示完全一致
+   * @details 1. 第一个输入约9MB，足以切成多块并分给多个线程(受硬件线程数限制)；
+   *             另有只有一块的小输入、空输入和末行没有换行符的输入
+   *          2. 无效行随机分布，并刻意放在分块边界附近，每个无效行的行号事先记录
+   *          3. 比较每个输入的前缀、无效行数和完整输出，输出中的行号与记录一致
+   */
+  void TestParseParallelSerial()
+  {
+    std::mt19937 rng(19);
+    std::vector<std::string> texts(4);
+    std::vector<std::vector<std::string>> expected(texts.size());
+    const size_t sizes[] = {9 * 1024 * 1024, 40 * 1024, 0, 3000};
+    for (size_t k = 0; k < texts.size(); k++)
+    {
+      std::string source = "input" + std::to_string(k);
+      size_t line = 1;
+      while (texts[k].size() < sizes[k])
+      {
+        // 分块在约256KB处的下一个换行符，边界前后的行更容易无效
+        size_t offset = texts[k].size() % (256 * 1024);
+        bool boundary = offset < 64 || offset > 256 * 1024 - 64;
+        std::string text;
+        if (rng() % (boundary ? 3 : 5000) == 0)
+        {
+          text = "bad-" + std::to_string(line);
+          expected[k].push_back(source + ":" + std::to_string(line) + ": Invalid CIDR format: " + text);
+        }
+        else if (rng() % 100 == 0)
+          text = rng() % 2 ? "# comment" : "";
+        else
+          text = FormatIpv4((uint32_t)rng()) + "/" + std::to_string(8 + rng() % 25);
+        texts[k] += text + "\n";
+        line++;
+      }
+    }
+    texts[3] += "bad-tail";
+    expected[3].push_back("input3:" + std::to_string(std::count(texts[3].begin(), texts[3].end(), '\n') + 1) +
+                          ": Invalid CIDR format: bad-tail");
+
+    std::vector<ParseInput> inputs;
+    std::vector<RouteSet> serial(texts.size());
+    std::vector<size_t> serialInvalid(texts.size());
+    std::string serialOutput;
+    {
+      CapturedOutput captured;
+      for (size_t k = 0; k < texts.size(); k++)
+      {
+        std::string source = "input" + std::to_string(k);
+        inputs.push_back({texts[k].data(), texts[k].size(), source});
+        serialInvalid[k] = ParseCidrBuffer(texts[k].data(), texts[k].size(), source, serial[k], 1);
+      }
+      serialOutput = captured.Text();
+    }
+
+    std::vector<RouteSet> parallel;
+    std::vector<size_t> parallelInvalid;
+    std::string parallelOutput;
+    size_t total;
+    {
+      CapturedOutput captured;
+      total = ParseCidrBuffers(inputs, parallel, 8, std::string(), &parallelInvalid);
+      parallelOutput = captured.Text();
+    }
+
+    std::string lines;
+    size_t count = 0;
+    for (size_t k = 0; k < texts.size(); k++)
+    {
+      for (const auto &line : expected[k])
+        lines += line + "\n";
+      count += expected[k].size();
+    }
+    EXPECT(parallel.size() == texts.size() && parallelInvalid == serialInvalid && total == count);
+    for (size_t k = 0; k < texts.size() && k < parallel.size(); k++)
+    {
+      if (!EXPECT(SameRoutes(parallel[k], serial[k])) || !EXPECT(serialInvalid[k] == expected[k].size()))
+        printf("  input %zu\n", k);
+    }
+    EXPECT(serialOutput == lines && parallelOutput == lines);
+    EXPECT(expected[0].size() > 30 && serial[0].Size() > 500000);
+  }
+
+  // 由 base 随机删除、保留和新增前缀得到的新版本，按(network, prefixLen)升序且不重复
+  RouteSet MutateRoutes(std::mt19937 &rng, const RouteSet &base, unsigned bits)
+  {
+    RouteSet routes;
+    unsigned keep = rng() % 101;
+    for (size_t i = 0; i < base.Size(); i++)
+    {
+      if (rng() % 100 < keep)
+        routes.Add(base.networks[i], base.prefixLens[i]);
+    }
+    routes.Append(RandomRoutes(rng, rng() % 32, 0, bits));
+    SortUniqueRoutes(routes);
+    return routes;
+  }
+
+  bool SamePatch(const RoutePatch &left, const RoutePatch &right)
+  {
+    return left.baseHash == right.baseHash && left.targetHash == right.targetHash &&
+           SameRoutes(left.removed, right.removed) && SameRoutes(left.added, right.added);
+  }
+
+  /**
+   * @brief 随机版本之间的差异应用到旧版本上恰好得到新版本
+   * @details 1. 新版本由旧版本随机删除和新增前缀得到，地址空间轮流取整个IPv4空间和 2^12 个地址，
+   *             前者的相邻地址差需要5字节变长整数
+   *          2. 每轮检查 apply(diff(a, b), a) == b，差异写入文件再读出后结果相同
+   *          3. 差异应用到其他版本上失败，且不修改输出
+   */
+  void TestPatchRoundTrip()
+  {
+    std::mt19937 rng(24);
+    std::string path = TempPath("round-trip.patch");
+    for (int round = 0; round < 2000; round++)
+    {
+      unsigned bits = round % 2 == 0 ? 32 : 12;
+      RouteSet base = RandomRoutes(rng, rng() % 64, 0, bits);
+      SortUniqueRoutes(base);
+      RouteSet target = MutateRoutes(rng, base, bits);
+
+      RoutePatch patch = DiffRouteSets(base, target);
+      RouteSet applied;
+      RoutePatch read;
+      bool written = round % 20 == 0;
+      if (!EXPECT(ApplyRoutePatch(base, patch, applied) && SameRoutes(applied, target)) ||
+          !EXPECT(patch.removed.Size() + target.Size() == base.Size() + patch.added.Size()) ||
+          (written && !EXPECT(WriteRoutePatch(path, patch) && ReadRoutePatch(path, read) && SamePatch(read, patch))))
+      {
+        printf("  round %d\n", round);
+        return;
+      }
+
+      // 旧版本不同时失败，输出保持不变
+      RouteSet other = MutateRoutes(rng, base, bits);
+      RouteSet sentinel;
+      sentinel.Add(0x01020300u, 24);
+      RouteSet untouched = sentinel;
+      if (!SameRoutes(other, base) &&
+          !EXPECT(!ApplyRoutePatch(other, patch, untouched) && SameRoutes(untouched, sentinel)))
+      {
+        printf("  round %d\n", round);
+        return;
+      }
+    }
+
+    // 空集合、相同版本和地址空间两端
+    RouteSet empty;
+    RouteSet ends;
+    ends.Add(0, 0);
+    ends.Add(0xFFFFFFFFu, 32);
+    RouteSet applied;
+    RoutePatch patch = DiffRouteSets(empty, ends);
+    EXPECT(ApplyRoutePatch(empty, patch, applied) && SameRoutes(applied, ends));
+    patch = DiffRouteSets(ends, empty);
+    EXPECT(ApplyRoutePatch(ends, patch, applied) && applied.Empty());
+    patch = DiffRouteSets(ends, ends);
+    EXPECT(patch.removed.Empty() && patch.added.Empty() && ApplyRoutePatch(ends, patch, applied) &&
+           SameRoutes(applied, ends));
+    RoutePatch read;
+    EXPECT(WriteRoutePatch(path, DiffRouteSets(empty, ends)) && ReadRoutePatch(path, read) &&
+           SamePatch(read, DiffRouteSets(empty, ends)));
+    std::filesystem::remove(path);
+  }
+
+  // 读取生成的源文件中 <name>[] = {...} 数组的各项，十六进制和十进制都按 C 字面量解析
+  std::vector<uint32_t> GeneratedArray(const std::string &text, const std::string &name)
+  {
+    std::vector<uint32_t> values;
+    size_t begin = text.find(name + "[] = {");
+    if (begin == std::string::npos)
+      return values;
+    const char *cur = text.c_str() + begin + name.size() + 6;
+    const char *end = text.c_str() + text.find("};", begin);
+    while (cur < end)
+    {
+      if (!isdigit((unsigned char)*cur))
+      {
+        cur++;
+        continue;
+      }
+      char *next;
+      values.push_back((uint32_t)strtoul(cur, &next, 0));
+      cur = next;
+    }
+    return values;
+  }
+
+  // 路由文件运行时的加载结果：读取、解析后聚合，与 compile --format cpp 嵌入前的处理相同
+  RouteSet RuntimeRoutes(const std::string &filename)
+  {
+    QuietOutput quiet;
+    LoadOptions options;
+    options.useCache = false;
+    options.quiet = true;
+    RouteSet routes = MergeRoutes({filename}, options);
+    AggregateRoutes(routes);
+    return routes;
+  }
+
+  /**
+   * @brief 生成的内置集合与运行时解析同一文件的结果相同
+   * @details 1. 随机路由文件(含重复、嵌套、相邻前缀和注释)生成 builtin_routes.inc，
+   *             从生成的文本中读回数组和集合表，逐项与运行时加载聚合的结果比较
+   *          2. 任一集合为空(文件读取失败)时不生成，已有的输出文件保持不变
+   */
+  void TestBuiltinSourceRoundTrip()
+  {
+    std::mt19937 rng(25);
+    std::string output = TempPath("builtin_routes.inc");
+    for (int round = 0; round < 20; round++)
+    {
+      std::vector<std::string> sources;
+      std::vector<RouteSet> sets;
+      for (int k = 0; k < 1 + round % 3; k++)
+      {
+        std::string filename = TempPath("builtin-" + std::to_string(k) + ".txt");
+        RouteSet random = RandomRoutes(rng, 1 + rng() % 300, round % 2 == 0 ? 0 : 0x0A000000u, round % 2 == 0 ? 32 : 16);
+        std::vector<std::string> lines = {"# generated"};
+        for (size_t i = 0; i < random.Size(); i++)
+          lines.push_back(FormatIpv4(random.networks[i]) + "/" + std::to_string(random.prefixLens[i]));
+        EXPECT(WriteRouteFile(filename, lines));
+        sources.push_back(filename);
+        sets.push_back(RuntimeRoutes(filename));
+      }
+      if (!EXPECT(WriteBuiltinRouteSource(output, sources, sets)))
+        return;
+
+      std::string text = ReadBytes(output);
+      for (size_t k = 0; k < sets.size(); k++)
+      {
+        std::string index = std::to_string(k);
+        std::vector<uint32_t> networks = GeneratedArray(text, "kBuiltinNetworks" + index);
+        std::vector<uint32_t> prefixLens = GeneratedArray(text, "kBuiltinPrefixLens" + index);
+        RouteSet embedded;
+        for (size_t i = 0; i < networks.size() && i < prefixLens.size(); i++)
+          embedded.Add(networks[i], (uint8_t)prefixLens[i]);
+        std::string name = std::filesystem::path(sources[k]).stem().string();
+        std::string entry = "{\"" + name + "\", \"" + sources[k] + "\", kBuiltinNetworks" + index +
+                            ", kBuiltinPrefixLens" + index + ", " + std::to_string(sets[k].Size()) + "}";
+        if (!EXPECT(networks.size() == prefixLens.size() && SameRoutes(embedded, sets[k])) ||
+            !EXPECT(text.find(entry) != std::string::npos))
+        {
+          printf("  round %d, set %zu\n", round, k);
+          return;
+        }
+      }
+      EXPECT(text.find("{nullptr, nullptr, nullptr, nullptr, 0}") != std::string::npos);
+      for (const auto &filename : sources)
+        std::filesystem::remove(filename);
+    }
+
+    // 文件不存在时加载结果为空，不生成也不覆盖上一次的输出
+    std::string before = ReadBytes(output);
+    RouteSet missing = RuntimeRoutes(TempPath("builtin-missing.txt"));
+    RouteSet present;
+    present.Add(0x0A000000u, 8);
+    EXPECT(missing.Empty());
+    EXPECT(!WriteBuiltinRouteSource(output, {"present.txt", "missing.txt"}, {present, missing}));
+    EXPECT(ReadBytes(output) == before);
+    std::filesystem::remove(output);
+  }
+
+  /**
+   * @brief 编译进程序的集合与运行时解析其来源文件的结果相同
+   * @details 只在 -DWIN_ROUTE_BUILTIN 构建中有集合可比较，来源路径按生成时的写法解析，需在生成时的目录运行
+   */
+  void TestBuiltinMatchesSource()
+  {
+    for (const auto &name : BuiltinRouteNames())
+    {
+      const BuiltinRouteSet *set = FindBuiltinRoutes(BUILTIN_ROUTE_PREFIX + name);
+      RouteSet embedded;
+      if (!EXPECT(set != nullptr && LoadBuiltinRoutes(BUILTIN_ROUTE_PREFIX + name, embedded)) ||
+          !EXPECT(std::filesystem::exists(set->source)) || !EXPECT(SameRoutes(embedded, RuntimeRoutes(set->source))))
+      {
+        printf("  builtin:%s\n", name.c_str());
+      }
+    }
+  }
+
+  // 启用缓存加载单个文件，输出收集到 output
+  RouteSet CachedRoutes(const std::string &filename, std::string &output)
+  {
+    CapturedOutput captured;
+    LoadOptions options;
+    options.quiet = true;
+    RouteSet routes = MergeRoutes({filename}, options);
+    output = captured.Text();
+    return routes;
+  }
+
+  // 缓存文件存在、格式有效且内容与 expected 相同
+  bool CacheHolds(const std::string &cache, const RouteSet &expected)
+  {
+    std::string bytes = ReadBytes(cache);
+    RouteSet routes;
+    return LoadRouteCacheImage(bytes.data(), bytes.size(), routes) && SameRoutes(routes, expected);
+  }
+
+  /**
+   * @brief 源文件变化或缓存损坏时重新解析并重建缓存，含无效行的文件不写缓存
+   * @details 1. 用来源信息与当前文件一致、内容不同的伪造缓存确认命中，修改时间变化但内容不变时仍然命中
+   *          2. 内容变化(大小不变)、大小变化(修改时间不变)时都从源文件重新解析，缓存随之重建
+   *          3. 截断、版本不符和非缓存内容的缓存文件被拒绝
+   *          4. 含无效行的文件每次加载都重新提示这些行
+   */
+  void TestRouteCacheStaleness()
+  {
+    std::string file = TempPath("cached.txt");
+    std::string cache = file + ".wrc";
+    std::filesystem::remove(cache);
+    WriteRouteFile(file, {"1.0.0.0/24", "1.0.1.0/24", "2.0.0.0/24"});
+
+    std::string output;
+    RouteSet routes = CachedRoutes(file, output);
+    EXPECT(SameRoutes(routes, RuntimeRoutes(file)) && routes.Size() == 2);
+    EXPECT(CacheHolds(cache, routes));
+
+    // 伪造的缓存与当前文件的来源信息一致，加载结果来自缓存
+    RouteSet forged;
+    forged.Add(0x09000000u, 8);
+    RouteCacheSource source;
+    EXPECT(GetRouteCacheSource(file, source) && WriteRouteCache(cache, forged, {source}));
+    EXPECT(SameRoutes(CachedRoutes(file, output), forged));
+    auto mtime = std::filesystem::last_write_time(file);
+    std::filesystem::last_write_time(file, mtime + std::chrono::hours(1));
+    EXPECT(SameRoutes(CachedRoutes(file, output), forged));
+
+    // 大小不变、内容和修改时间变化
+    WriteRouteFile(file, {"3.0.0.0/24", "1.0.1.0/24", "2.0.0.0/24"});
+    routes = CachedRoutes(file, output);
+    EXPECT(SameRoutes(routes, RuntimeRoutes(file)) && routes.Size() == 3);
+    EXPECT(CacheHolds(cache, routes));
+
+    // 大小变化、修改时间不变
+    EXPECT(GetRouteCacheSource(file, source) && WriteRouteCache(cache, forged, {source}));
+    mtime = std::filesystem::last_write_time(file);
+    WriteRouteFile(file, {"3.0.0.0/24", "1.0.1.0/24", "2.0.0.0/24", "4.0.0.0/24"});
+    std::filesystem::last_write_time(file, mtime);
+    routes = CachedRoutes(file, output);
+    EXPECT(SameRoutes(routes, RuntimeRoutes(file)) && routes.Size() == 4);
+    EXPECT(CacheHolds(cache, routes));
+
+    // 损坏的缓存被拒绝，加载结果来自源文件
+    std::string valid = ReadBytes(cache);
+    std::string versioned = valid;
+    versioned[4] ^= 0x7F;
+    std::vector<std::string> corrupt = {valid.substr(0, 20), valid.substr(0, valid.size() - 1), valid + "x",
+                                        versioned, "not a route cache"};
+    for (size_t i = 0; i < corrupt.size(); i++)
+    {
+      WriteFileAtomically(cache, corrupt[i]);
+      if (!EXPECT(SameRoutes(CachedRoutes(file, output), routes)) || !EXPECT(CacheHolds(cache, routes)))
+        printf("  corruption %zu\n", i);
+    }
+
+    // 含无效行时不写缓存，再次加载仍然提示
+    std::filesystem::remove(cache);
+    WriteRouteFile(file, {"1.0.0.0/24", "bogus", "2.0.0.0/24"});
+    for (int round = 0; round < 2; round++)
+    {
+      routes = CachedRoutes(file, output);
+      EXPECT(routes.Size() == 2 && output.find(file + ":2: Invalid CIDR format: bogus") != std::string::npos);
+      EXPECT(!std::filesystem::exists(cache));
+    }
+    std::filesystem::remove(file);
+  }
+
+  // 线性扫描求最长匹配前缀的长度，没有匹配时返回-1
+  int LinearLongestMatch(const RouteSet &routes, uint32_t address)
+  {
+    int best = -1;
+    for (size_t i = 0; i < routes.Size(); i++)
+    {
+      uint32_t mask = PrefixToMask(routes.prefixLens[i]);
+      if ((address & mask) == (routes.networks[i] & mask) && routes.prefixLens[i] > best)
+        best = routes.prefixLens[i];
+    }
+    return best;
+  }
+
+  // 查找结果与线性扫描一致：同样没有匹配，或匹配到的前缀包含该地址且长度相同
+  bool LookupMatches(const PrefixMatcher &matcher, const RouteSet &routes, uint32_t address)
+  {
+    uint32_t index = matcher.Lookup(address);
+    int expected = LinearLongestMatch(routes, address);
+    if (index == PrefixMatcher::NO_MATCH || expected < 0)
+    {
+      return index == PrefixMatcher::NO_MATCH && expected < 0;
+    }
+    uint32_t mask = PrefixToMask(routes.prefixLens[index]);
+    return routes.prefixLens[index] == expected && (address & mask) == (routes.networks[index] & mask);
+  }
+
+  /**
+   * @brief 最长前缀匹配与线性扫描逐个地址比较
+   * @details 随机集合混合 0.0.0.0/0、/32、255.255.255.255、跨越和紧贴高16位分桶边界的前缀，
+   *          以及带主机位和重复的前缀；查询每个前缀的首末地址及其相邻地址、分桶边界和随机地址
+   */
+  void TestLpmLinearScan()
+  {
+    std::mt19937 rng(9);
+    for (int round = 0; round < 300; round++)
+    {
+      RouteSet routes;
+      size_t count = rng() % 40;
+      for (size_t i = 0; i < count; i++)
+      {
+        uint32_t address = rng();
+        uint8_t prefixLen;
+        switch (rng() % 8)
+        {
+        case 0:
+          prefixLen = (uint8_t)(rng() % 33);
+          break;
+        case 1:
+          prefixLen = 32;
+          break;
+        case 2:
+          // 紧贴分桶边界的前缀
+          address = (address & 0xFFFF0000u) | (rng() % 2 ? 0xFFFFu : 0);
+          prefixLen = (uint8_t)(16 + rng() % 17);
+          break;
+        case 3:
+          prefixLen = (uint8_t)(14 + rng() % 5);
+          break;
+        case 4:
+          address = rng() % 2 ? 0xFFFFFFFFu : 0;
+          prefixLen = (uint8_t)(rng() % 33);
+          break;
+        case 5:
+          prefixLen = 0;
+          break;
+        default:
+          // 集中在同一个/12内，制造大量嵌套
+          address = 0x0A000000u | (address & 0x000FFFFFu);
+          prefixLen = (uint8_t)(12 + rng() % 21);
+          break;
+        }
+        routes.Add(rng() % 4 == 0 ? address : address & PrefixToMask(prefixLen), prefixLen);
+        if (rng() % 10 == 0)
+          routes.Add(routes.networks.back(), prefixLen);
+      }
+
+      PrefixMatcher matcher;
+      matcher.Build(routes);
+      std::vector<uint32_t> queries = {0, 1, 0xFFFFFFFFu, 0xFFFFFFFEu, 0x0000FFFFu, 0x00010000u, 0xFFFF0000u,
+                                       0xFFFEFFFFu};
+      for (size_t i = 0; i < routes.Size(); i++)
+      {
+        uint32_t first = routes.networks[i] & PrefixToMask(routes.prefixLens[i]);
+        uint32_t last = first | ~PrefixToMask(routes.prefixLens[i]);
+        for (uint32_t address : {first, last, first - 1, last + 1, first & 0xFFFF0000u, (first & 0xFFFF0000u) - 1,
+                                 last | 0xFFFFu, (last | 0xFFFFu) + 1})
+          queries.push_back(address);
+      }
+      for (int i = 0; i < 200; i++)
+        queries.push_back(rng());
+
+      for (uint32_t address : queries)
+      {
+        if (!EXPECT(LookupMatches(matcher, routes, address)))
+        {
+          printf("  round %d, address %s, %zu routes\n", round, FormatIpv4(address).c_str(), routes.Size());
+          return;
+        }
+      }
+    }
+  }
+
+  // 尚未构建、空集合、整个空间和地址空间两端
+  void TestLpmEdges()
+  {
+    // 尚未构建时没有任何匹配
+    PrefixMatcher matcher;
+    EXPECT(matcher.Lookup(0) == PrefixMatcher::NO_MATCH && matcher.Lookup(0x0A000000u) == PrefixMatcher::NO_MATCH);
+    EXPECT(matcher.IntervalCount() == 0);
+
+    RouteSet routes;
+    matcher.Build(routes);
+    EXPECT(matcher.Lookup(0) == PrefixMatcher::NO_MATCH && matcher.Lookup(0xFFFFFFFFu) == PrefixMatcher::NO_MATCH);
+
+    routes.Add(0, 0);
+    matcher.Build(routes);
+    EXPECT(matcher.Lookup(0) == 0 && matcher.Lookup(0x80000000u) == 0 && matcher.Lookup(0xFFFFFFFFu) == 0);
+
+    routes.Clear();
+    routes.Add(0xFFFFFFFFu, 32);
+    routes.Add(0, 32);
+    matcher.Build(routes);
+    EXPECT(matcher.Lookup(0xFFFFFFFFu) == 0 && matcher.Lookup(0) == 1);
+    EXPECT(matcher.Lookup(0xFFFFFFFEu) == PrefixMatcher::NO_MATCH && matcher.Lookup(1) == PrefixMatcher::NO_MATCH);
+
+    // 覆盖两个分桶的/15，内部嵌套紧贴边界的/32
+    routes.Clear();
+    routes.Add(0x0A000000u, 15);
+    routes.Add(0x0A00FFFFu, 32);
+    routes.Add(0x0A010000u, 32);
+    matcher.Build(routes);
+    EXPECT(matcher.Lookup(0x0A00FFFEu) == 0 && matcher.Lookup(0x0A00FFFFu) == 1 && matcher.Lookup(0x0A010000u) == 2);
+    EXPECT(matcher.Lookup(0x0A010001u) == 0 && matcher.Lookup(0x0A01FFFFu) == 0 &&
+           matcher.Lookup(0x0A020000u) == PrefixMatcher::NO_MATCH);
+  }
+
+  /**
+   * @brief 命中次数归属到最长匹配的前缀，按权重稳定排序
+   * @details 1. 嵌套的 /8、/16、/24 分别只得到最长匹配落在自己范围内的命中，命中为前缀时取其网络地址，
+   *             同一地址多次出现时累加，不在任何前缀内的命中不计入
+   *          2. 权重相同(包括都为0)的前缀保持原有顺序
+   *          3. 没有命中时权重全为0，排序不改变顺序；空集合得到空结果
+   */
+  void TestPriorityWeights()
+  {
+    RouteSet routes;
+    routes.Add(0x0A000000u, 8);  // 10.0.0.0/8
+    routes.Add(0x01000000u, 24); // 1.0.0.0/24
+    routes.Add(0x0A010000u, 16); // 10.1.0.0/16
+    routes.Add(0xAC100000u, 12); // 172.16.0.0/12
+    routes.Add(0x0A010200u, 24); // 10.1.2.0/24
+    routes.Add(0xC0A80000u, 16); // 192.168.0.0/16
+
+    HitCounts hits;
+    auto hit = [&](uint32_t network, uint8_t prefixLen, uint64_t count)
+    {
+      hits.prefixes.Add(network, prefixLen);
+      hits.counts.push_back(count);
+    };
+    hit(0x0A010203u, 32, 5); // 10.1.2.3 -> /24
+    hit(0x0A010200u, 24, 4); // 10.1.2.0/24 -> /24
+    hit(0x0A010303u, 32, 2); // 10.1.3.3 -> /16
+    hit(0x0A020000u, 32, 1); // 10.2.0.0 -> /8
+    hit(0x0AFFFFFFu, 32, 1); // 10.255.255.255 -> /8
+    hit(0x08080808u, 32, 100);
+    hit(0xC0A80101u, 32, 3);
+    hit(0xC0A80101u, 32, 2);
+    hit(0x0A000000u, 8, 0);
+
+    std::vector<uint64_t> weights = AttributeHits(routes, hits);
+    EXPECT(weights == std::vector<uint64_t>({2, 0, 2, 0, 9, 5}));
+
+    RouteSet sorted = routes;
+    SortByWeight(sorted, weights);
+    RouteSet expected;
+    for (size_t i : {4, 5, 0, 2, 1, 3})
+      expected.Add(routes.networks[i], routes.prefixLens[i]);
+    EXPECT(SameRoutes(sorted, expected) && weights == std::vector<uint64_t>({9, 5, 2, 2, 0, 0}));
+
+    HitCounts none;
+    weights = AttributeHits(routes, none);
+    EXPECT(weights == std::vector<uint64_t>(routes.Size(), 0));
+    sorted = routes;
+    SortByWeight(sorted, weights);
+    EXPECT(SameRoutes(sorted, routes) && weights.size() == routes.Size());
+
+    RouteSet empty;
+    weights = AttributeHits(empty, hits);
+    EXPECT(weights.empty());
+    SortByWeight(empty, weights);
+    EXPECT(empty.Size() == 0 && weights.empty());
+  }
+
+  const uint32_t kGateway = 0xC0A80101u; // 192.168.1.1，接口7
+  const uint32_t kOtherGateway = 0x0A000001u; // 10.0.0.1，接口9
+
+  RouteEntry Row(uint32_t destination, uint8_t prefixLen, uint32_t gateway)
+  {
+    return {destination, gateway, gateway == kGateway ? 7u : 9u, 25, prefixLen, ROUTE_PROTO_NETMGMT};
+  }
+
+  // 表中是否有这一行(按前缀、网关和接口匹配)
+  bool HasRow(MemoryRouteBackend &backend, uint32_t destination, uint8_t prefixLen, uint32_t gateway)
+  {
+    std::vector<RouteEntry> rows;
+    backend.GetTable(rows);
+    RouteEntry wanted = Row(destination, prefixLen, gateway);
+    for (const auto &row : rows)
+    {
+      if (row.destination == destination && row.prefixLen == prefixLen && row.gateway == gateway &&
+          row.ifIndex == wanted.ifIndex)
+        return true;
+    }
+    return false;
+  }
+
+  // 网关上除默认路由以外的前缀，按(network, prefixLen)升序
+  RouteSet GatewayRoutes(MemoryRouteBackend &backend, uint32_t gateway)
+  {
+    std::vector<RouteEntry> rows;
+    backend.GetTable(rows);
+    RouteSet routes;
+    for (const auto &row : rows)
+    {
+      if (row.gateway == gateway && row.prefixLen > 0)
+        routes.Add(row.destination, row.prefixLen);
+    }
+    SortUniqueRoutes(routes);
+    return routes;
+  }
+
+  // 按网络地址注入错误码的内存后端：第 i 个 /24 前缀 i % 7 == 3 时返回87，i % 11 == 5 时返回5
+  class FaultyBackend : public MemoryRouteBackend
+  {
+  public:
+    static uint32_t FaultFor(uint32_t destination)
+    {
+      uint32_t i = destination >> 8;
+      return i % 7 == 3 ? 87 : i % 11 == 5 ? 5 : 0;
+    }
+
+    uint32_t CreateEntry(const RouteEntry &entry) override
+    {
+      uint32_t fault = FaultFor(entry.destination);
+      return fault != 0 ? fault : MemoryRouteBackend::CreateEntry(entry);
+    }
+  };
+
+  /**
+   * @brief 批量操作按错误码分别计数，单线程与多线程结果相同
+   * @details 1000 条 /24 路由，其中一部分注入错误码87和5，另有一部分已经存在(ROUTE_ERROR_ALREADY_EXISTS)；
+   *          比较各错误码的次数、每行的错误码、AddRoutes 输出的 installed 和单线程时的执行顺序，
+   *          最后删除时不存在的行计为 ROUTE_ERROR_NOT_FOUND
+   */
+  void TestInstallerErrorCounts()
+  {
+    std::vector<RouteEntry> rows;
+    RouteSet routes;
+    std::map<uint32_t, size_t> expected;
+    std::vector<uint32_t> expectedCodes;
+    RouteSet expectedInstalled;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+      uint32_t destination = i << 8;
+      rows.push_back(Row(destination, 24, kGateway));
+      routes.Add(destination, 24);
+      uint32_t code = FaultyBackend::FaultFor(destination);
+      if (code == 0 && i % 13 == 0)
+        code = ROUTE_ERROR_ALREADY_EXISTS;
+      if (code != 0)
+        expected[code]++;
+      else
+        expectedInstalled.Add(destination, 24);
+      expectedCodes.push_back(code);
+    }
+    auto seed = [&](FaultyBackend &backend)
+    {
+      for (uint32_t i = 0; i < 1000; i += 13)
+      {
+        if (FaultyBackend::FaultFor(i << 8) == 0)
+          backend.Seed(Row(i << 8, 24, kGateway));
+      }
+    };
+
+    for (unsigned jobs : {1u, 4u})
+    {
+      FaultyBackend backend;
+      seed(backend);
+      backend.recordOperations = true;
+      std::vector<uint32_t> codes;
+      InstallResult result = RunRouteOperations(backend, rows, RouteOperation::Create, jobs, &codes);
+      if (!EXPECT(result.errors == expected && codes == expectedCodes) ||
+          !EXPECT(result.succeeded == expectedInstalled.Size() && result.failed + result.succeeded == rows.size()))
+      {
+        printf("  jobs %u\n", jobs);
+        return;
+      }
+      // 单线程严格按输入顺序；注入错误的调用不经过内存后端，不被记录
+      if (jobs == 1)
+      {
+        size_t k = 0;
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+          if (FaultyBackend::FaultFor(rows[i].destination) == 0)
+            EXPECT(k < backend.operations.size() && backend.operations[k++].entry.destination == rows[i].destination);
+        }
+        EXPECT(k == backend.operations.size());
+      }
+
+      FaultyBackend other;
+      seed(other);
+      RouteTableSnapshot snapshot(other);
+      RouteSet installed;
+      {
+        QuietOutput quiet;
+        EXPECT(!AddRoutes(snapshot, routes, kGateway, 7, 25, jobs, &installed));
+      }
+      EXPECT(SameRoutes(installed, expectedInstalled));
+    }
+
+    // 删除：一半的行不存在
+    for (unsigned jobs : {1u, 4u})
+    {
+      MemoryRouteBackend backend;
+      for (size_t i = 0; i < rows.size(); i += 2)
+        backend.Seed(rows[i]);
+      InstallResult result = RunRouteOperations(backend, rows, RouteOperation::Delete, jobs);
+      EXPECT(result.succeeded == 500 && result.failed == 500 && result.errors.size() == 1 &&
+             result.errors[ROUTE_ERROR_NOT_FOUND] == 500);
+    }
+  }
+
+  /**
+   * @brief 流水线安装在每批生效之前交给调用方记录
+   * @details 2000 行分成多块：每次 beforeBatch 时该批的路由都还不在表中，之前各批都已安装；
+   *          各批合起来恰好是全部前缀。beforeBatch 返回false时之后不再安装
+   */
+  void TestStreamRecordsBeforeInstall()
+  {
+    std::string file = TempPath("stream.txt");
+    std::vector<std::string> lines;
+    RouteSet all;
+    for (uint32_t i = 0; i < 2000; i++)
+    {
+      lines.push_back(FormatIpv4(i << 8) + "/24");
+      all.Add(i << 8, 24);
+    }
+    WriteRouteFile(file, lines);
+
+    MemoryRouteBackend backend;
+    StreamOptions options;
+    options.blockBytes = 1024;
+    RouteSet recorded;
+    size_t batches = 0;
+    options.beforeBatch = [&](const RouteSet &batch)
+    {
+      batches++;
+      RouteSet installed = GatewayRoutes(backend, kGateway);
+      for (size_t i = 0; i < batch.Size(); i++)
+        EXPECT(!ContainsRoute(installed, batch.networks[i], batch.prefixLens[i]));
+      EXPECT(installed.Size() == recorded.Size());
+      recorded.Append(batch);
+      return true;
+    };
+    RouteSet installed;
+    StreamResult result = StreamRoutes(backend, {file}, kGateway, 7, 25, options, &installed);
+    SortUniqueRoutes(recorded);
+    SortUniqueRoutes(installed);
+    EXPECT(batches > 1 && !result.stopped && result.install.succeeded == 2000);
+    EXPECT(SameRoutes(recorded, all) && SameRoutes(installed, all));
+
+    // 记录失败时停止，之后的路由不安装
+    MemoryRouteBackend stopped;
+    batches = 0;
+    options.beforeBatch = [&](const RouteSet &)
+    { return ++batches < 2; };
+    result = StreamRoutes(stopped, {file}, kGateway, 7, 25, options);
+    EXPECT(result.stopped && batches == 2 && result.install.succeeded > 0 && result.install.succeeded < 2000);
+    EXPECT(GatewayRoutes(stopped, kGateway).Size() == result.install.succeeded);
+    std::filesystem::remove(file);
+  }
+
+  RouteSet Prefixes(std::initializer_list<uint32_t> networks, uint8_t prefixLen)
+  {
+    RouteSet routes;
+    for (uint32_t network : networks)
+      routes.Add(network, prefixLen);
+    return routes;
+  }
+
+  /**
+   * @brief 同步只删除记录中属于本工具的路由
+   * @details 表中有不在记录里的静态路由，包括目标网关上的无关前缀、目标前缀在其他网关上的行
+   *          和已经在目标网关上的目标前缀，同步后它们都应保留且不计入记录；记录中不再需要的路由被删除
+   */
+  void TestSyncOwnership()
+  {
+    MemoryRouteBackend backend;
+    backend.Seed(Row(0, 0, kGateway));
+    backend.Seed(Row(0x08080800u, 24, kGateway));      // 用户添加，不在目标中
+    backend.Seed(Row(0x01000000u, 24, kOtherGateway)); // 用户添加，目标前缀但在其他网关上
+    backend.Seed(Row(0x02000000u, 24, kGateway));      // 本工具安装，已不在目标中
+    backend.Seed(Row(0x03000000u, 24, kGateway));      // 本工具安装，仍在目标中
+    backend.Seed(Row(0x05000000u, 24, kGateway));      // 用户添加，目标前缀且在目标网关上
+    RouteEntry other = Row(0x07000000u, 24, kGateway); // 其他协议的路由，低8位与 NETMGMT 相同
+    other.protocol = 0x100 | ROUTE_PROTO_NETMGMT;
+    backend.Seed(other);
+
+    RouteState owner;
+    owner.gateway = kGateway;
+    owner.ifIndex = 7;
+    owner.routes.Add(0x02000000u, 24);
+    owner.routes.Add(0x03000000u, 24);
+    owner.routes.Add(0x07000000u, 24);
+
+    RouteSet desired;
+    desired.Add(0x01000000u, 24);
+    desired.Add(0x03000000u, 24);
+    desired.Add(0x04000000u, 24);
+    desired.Add(0x05000000u, 24);
+
+    RouteTableSnapshot snapshot(backend);
+    SyncResult result = SyncRoutes(snapshot, desired, kGateway, 7, 25, owner);
+    EXPECT(result.added == 2 && result.removed == 1 && result.unchanged == 2 && result.failed == 0);
+    EXPECT(HasRow(backend, 0x08080800u, 24, kGateway));
+    EXPECT(HasRow(backend, 0x01000000u, 24, kOtherGateway));
+    EXPECT(!HasRow(backend, 0x02000000u, 24, kGateway));
+    EXPECT(HasRow(backend, 0x01000000u, 24, kGateway) && HasRow(backend, 0x04000000u, 24, kGateway));
+    EXPECT(HasRow(backend, 0, 0, kGateway) && HasRow(backend, 0x07000000u, 24, kGateway));
+    SortUniqueRoutes(result.owned);
+    EXPECT(SameRoutes(result.owned, Prefixes({0x01000000u, 0x03000000u, 0x04000000u}, 24)));
+
+    // 再次同步没有任何操作
+    owner.routes = result.owned;
+    size_t calls = backend.createCalls + backend.deleteCalls;
+    result = SyncRoutes(snapshot, desired, kGateway, 7, 25, owner);
+    EXPECT(result.unchanged == 4 && backend.createCalls + backend.deleteCalls == calls);
+
+    // 目标中去掉用户添加的前缀，它仍然保留
+    owner.routes = result.owned;
+    desired = Prefixes({0x01000000u, 0x03000000u, 0x04000000u}, 24);
+    result = SyncRoutes(snapshot, desired, kGateway, 7, 25, owner);
+    EXPECT(result.removed == 0 && result.unchanged == 3 && HasRow(backend, 0x05000000u, 24, kGateway));
+  }
+
+  // 网关变化后同步：记录在旧网关上的路由全部移除或换到新网关，旧网关上的其他路由保留
+  void TestSyncGatewayChange()
+  {
+    MemoryRouteBackend backend;
+    backend.Seed(Row(0, 0, kGateway));
+    backend.Seed(Row(0x01000000u, 24, kOtherGateway)); // 本工具安装，仍在目标中
+    backend.Seed(Row(0x05000000u, 24, kOtherGateway)); // 本工具安装，已不在目标中
+    backend.Seed(Row(0x06000000u, 24, kOtherGateway)); // 用户添加
+
+    RouteState owner;
+    owner.gateway = kOtherGateway;
+    owner.ifIndex = 9;
+    owner.routes.Add(0x01000000u, 24);
+    owner.routes.Add(0x05000000u, 24);
+
+    RouteSet desired;
+    desired.Add(0x01000000u, 24);
+    RouteTableSnapshot snapshot(backend);
+    SyncResult result = SyncRoutes(snapshot, desired, kGateway, 7, 25, owner);
+    EXPECT(result.added == 1 && result.removed == 2 && result.failed == 0);
+    EXPECT(HasRow(backend, 0x01000000u, 24, kGateway) && !HasRow(backend, 0x01000000u, 24, kOtherGateway));
+    EXPECT(!HasRow(backend, 0x05000000u, 24, kOtherGateway));
+    EXPECT(HasRow(backend, 0x06000000u, 24, kOtherGateway));
+    EXPECT(SameRoutes(result.owned, desired));
+  }
+
+  /**
+   * @brief 切换网关只处理记录中的路由，并且每个前缀先加后删
+   * @details 后端带调用延迟并记录操作顺序：每个前缀的新路由添加在旧路由删除之前，
+   *          任何前缀都没有失去路由(MaxUnroutedUs 为0)；不在记录中的静态路由留在旧网关上，
+   *          协议为0的行按静态路由切换，其他协议的行始终不动。
+   *          最后先删后加一条路由作对照，确认 MaxUnroutedUs 能测到间隙
+   */
+  void TestRepointOwnedRows()
+  {
+    MemoryRouteBackend backend;
+    backend.callLatencyUs = 200;
+    backend.Seed(Row(0, 0, kOtherGateway));
+    RouteSet owned = Prefixes({0x01000000u, 0x02000000u, 0x03000000u, 0x04000000u}, 24);
+    for (size_t i = 0; i < owned.Size(); i++)
+    {
+      // 协议为0的行按静态路由处理
+      RouteEntry row = Row(owned.networks[i], 24, kGateway);
+      row.protocol = i == 3 ? 0 : ROUTE_PROTO_NETMGMT;
+      backend.Seed(row);
+    }
+    backend.Seed(Row(0x08080800u, 24, kGateway)); // 用户添加
+    RouteEntry foreign = Row(0x09090900u, 24, kGateway);
+    foreign.protocol = 0x103; // 其他协议添加，不属于静态路由
+    backend.Seed(foreign);
+
+    backend.recordOperations = true;
+    RouteTableSnapshot snapshot(backend);
+    RepointResult result = RepointRoutes(snapshot, kGateway, 7, kOtherGateway, 9, 25, 2, &owned);
+    EXPECT(result.matched == 4 && result.moved == 4 && result.failures.failed == 0);
+    EXPECT(HasRow(backend, 0x08080800u, 24, kGateway) && !HasRow(backend, 0x08080800u, 24, kOtherGateway));
+    for (size_t i = 0; i < owned.Size(); i++)
+      EXPECT(HasRow(backend, owned.networks[i], 24, kOtherGateway) && !HasRow(backend, owned.networks[i], 24, kGateway));
+
+    // 每个前缀恰好一次添加和一次删除，添加在前
+    EXPECT(backend.operations.size() == 8);
+    for (size_t i = 0; i < owned.Size(); i++)
+    {
+      int created = -1, deleted = -1;
+      for (size_t k = 0; k < backend.operations.size(); k++)
+      {
+        const auto &op = backend.operations[k];
+        if (op.entry.destination != owned.networks[i] || op.result != 0)
+          continue;
+        if (op.type == MemoryRouteBackend::OperationType::Create && op.entry.gateway == kOtherGateway)
+          created = (int)k;
+        if (op.type == MemoryRouteBackend::OperationType::Delete && op.entry.gateway == kGateway)
+          deleted = (int)k;
+      }
+      EXPECT(created >= 0 && deleted > created);
+    }
+    EXPECT(backend.MaxUnroutedUs() == 0);
+
+    // 不指定记录时切换旧网关上的全部静态路由
+    result = RepointRoutes(snapshot, kGateway, 0, kOtherGateway, 9, 25, 1, nullptr);
+    EXPECT(result.matched == 1 && result.moved == 1 && HasRow(backend, 0x08080800u, 24, kOtherGateway));
+    EXPECT(HasRow(backend, 0x09090900u, 24, kGateway) && !HasRow(backend, 0x09090900u, 24, kOtherGateway));
+
+    backend.DeleteEntry(Row(0x08080800u, 24, kOtherGateway));
+    backend.CreateEntry(Row(0x08080800u, 24, kOtherGateway));
+    EXPECT(backend.MaxUnroutedUs() >= 200);
+  }
+
+  /**
+   * @brief 选项变化后删除的是上次实际安装的路由
+   * @details add 两个文件(--max-routes 2) → 删除一个文件(--no-aggregate) → 重新 add(默认选项)，
+   *          每一步之后重新读取状态文件，网关上的路由必须恰好是本次的目标集合加上不属于来源的路由
+   */
+  void TestApplyTrackedOptions()
+  {
+    std::string statePath = TempPath("tracked.state");
+    std::string fileA = TempPath("tracked-a.txt");
+    std::string fileB = TempPath("tracked-b.txt");
+    RouteSet routesA = Prefixes({0x0A000000u, 0x0A000200u, 0x0A000400u}, 24);
+    RouteSet routesB = Prefixes({0x0A000100u, 0x0A000800u, 0x0A000900u}, 24);
+    RouteSet other = Prefixes({0x0A00C800u}, 24); // stream 安装，不属于任何来源
+
+    MemoryRouteBackend backend;
+    backend.Seed(Row(0, 0, kGateway));
+    backend.Seed(Row(other.networks[0], 24, kGateway));
+    RouteState state;
+    state.gateway = kGateway;
+    state.ifIndex = 7;
+    state.metric = 25;
+    state.routes = other;
+
+    // 每一步应用后从状态文件重新读取，网关上恰好是目标集合和其他路由
+    auto apply = [&](const SourceOptions &options)
+    {
+      RouteTableSnapshot snapshot(backend);
+      bool ok;
+      {
+        QuietOutput quiet;
+        ok = ApplyTrackedRoutes(snapshot, state, statePath, options, 1);
+      }
+      RouteSet desired = TrackedRoutes(state, options);
+      RouteSet expected = desired;
+      expected.Append(other);
+      SortUniqueRoutes(expected);
+      RouteState loaded;
+      if (!EXPECT(ok && LoadRouteState(statePath, loaded)) ||
+          !EXPECT(SameRoutes(GatewayRoutes(backend, kGateway), expected)) ||
+          !EXPECT(SameRoutes(loaded.routes, expected)) || !EXPECT(SameRoutes(loaded.tracked, desired)))
+      {
+        return false;
+      }
+      state = loaded;
+      return true;
+    };
+
+    SourceOptions limited;
+    limited.maxRoutes = 2;
+    SetRouteSource(state, fileA, routesA);
+    SetRouteSource(state, fileB, routesB);
+    if (!apply(limited) || !EXPECT(state.tracked.Size() == 2))
+      return;
+
+    SourceOptions plain;
+    plain.aggregate = false;
+    RemoveRouteSource(state, fileB);
+    if (!apply(plain) || !EXPECT(SameRoutes(state.tracked, routesA)))
+      return;
+
+    SetRouteSource(state, fileB, routesB);
+    if (!apply(SourceOptions()))
+      return;
+    RouteSet aggregated = routesA;
+    aggregated.Append(routesB);
+    AggregateRoutes(aggregated);
+    EXPECT(SameRoutes(state.tracked, aggregated) && state.tracked.Size() == 4);
+    std::filesystem::remove(statePath);
+  }
+
+  /**
+   * @brief add 的快速路径按聚合结果的内容判断
+   * @details 来源内容变化但聚合结果不变时仍然跳过；聚合结果、网关变化、路由被删除或上次未全部成功时不跳过
+   */
+  void TestAddFingerprintSkip()
+  {
+    std::string statePath = TempPath("fingerprint.state");
+    std::string file = TempPath("fingerprint.txt");
+    RouteSet routes = Prefixes({0x0A000000u, 0x0A000100u, 0x0A000400u}, 24);
+
+    MemoryRouteBackend backend;
+    backend.Seed(Row(0, 0, kGateway));
+    RouteState state;
+    state.gateway = kGateway;
+    state.ifIndex = 7;
+    state.metric = 25;
+    SetRouteSource(state, file, routes);
+    RouteTableSnapshot snapshot(backend);
+    {
+      QuietOutput quiet;
+      if (!EXPECT(ApplyTrackedRoutes(snapshot, state, statePath, SourceOptions(), 1)))
+        return;
+    }
+
+    // 每次从状态文件读取，按本次的文件内容登记后检查
+    auto current = [&](const RouteSet &content, uint32_t gateway, uint32_t ifIndex)
+    {
+      RouteState loaded;
+      LoadRouteState(statePath, loaded);
+      SetRouteSource(loaded, file, content);
+      RouteTableSnapshot fresh(backend);
+      return TrackedRoutesCurrent(fresh, loaded, SourceOptions(), gateway, ifIndex);
+    };
+
+    size_t calls = backend.createCalls + backend.deleteCalls;
+    EXPECT(current(routes, kGateway, 7));
+    RouteSet covered = routes;
+    covered.Add(0x0A000080u, 25); // 已被 10.0.0.0/24 覆盖，聚合结果不变
+    EXPECT(current(covered, kGateway, 7));
+    EXPECT(backend.createCalls + backend.deleteCalls == calls);
+
+    RouteSet grown = routes;
+    grown.Add(0x0A000800u, 24);
+    EXPECT(!current(grown, kGateway, 7));
+    EXPECT(!current(routes, kOtherGateway, 9));
+
+    SourceOptions limited;
+    limited.maxRoutes = 1;
+    RouteState loaded;
+    LoadRouteState(statePath, loaded);
+    RouteTableSnapshot fresh(backend);
+    EXPECT(!TrackedRoutesCurrent(fresh, loaded, limited, kGateway, 7));
+
+    backend.DeleteEntry(Row(0x0A000400u, 24, kGateway));
+    EXPECT(!current(routes, kGateway, 7));
+    backend.CreateEntry(Row(0x0A000400u, 24, kGateway));
+    EXPECT(current(routes, kGateway, 7));
+
+    loaded.fingerprint = 0;
+    SaveRouteState(statePath, loaded);
+    EXPECT(!current(routes, kGateway, 7));
+    std::filesystem::remove(statePath);
+  }
+
+  /**
+   * @brief 按脚本产生事件的事件来源
+   * @details 每次 WaitEvent 执行一步：先运行该步的动作(修改文件或路由表)，再返回事件或超时；
+   *          脚本结束后返回 Stop
+   */
+  class ScriptedEventSource : public WatchEventSource
+  {
+  public:
+    struct Step
+    {
+      std::function<void()> action;
+      bool quiet;          ///< 为true时本步模拟一次超时
+      WatchEventType type; ///< 本步返回的事件
+    };
+
+    explicit ScriptedEventSource(std::vector<Step> steps) : steps_(std::move(steps)) {}
+
+    std::vector<unsigned> timeouts; ///< 每次调用传入的超时
+
+    bool WaitEvent(WatchEvent &event, unsigned timeoutMs) override
+    {
+      timeouts.push_back(timeoutMs);
+      if (next_ == steps_.size())
+      {
+        event.type = WatchEventType::Stop;
+        return true;
+      }
+      const Step &step = steps_[next_++];
+      if (step.action)
+        step.action();
+      event.type = step.type;
+      return !step.quiet;
+    }
+
+  private:
+    std::vector<Step> steps_;
+    size_t next_ = 0;
+  };
+
+  /**
+   * @brief 脚本事件驱动的监视器收敛
+   * @details 启动时收敛一次；两次连续的文件变化在去抖期间合并为一次收敛；
+   *          默认网关变化后路由切换到新网关。检查收敛次数、每次的延迟和最终的路由表与记录
+   */
+  void TestWatchScriptedEvents()
+  {
+    std::string file = TempPath("watch.txt");
+    std::string statePath = TempPath("watch.state");
+    std::filesystem::remove(statePath);
+    WriteRouteFile(file, {"1.0.0.0/24", "2.0.0.0/24"});
+
+    MemoryRouteBackend backend;
+    backend.Seed(Row(0, 0, kGateway));
+    RouteTableSnapshot snapshot(backend);
+    WatchOptions options;
+    options.debounceMs = 0;
+    options.statePath = statePath;
+    options.load.useCache = false;
+    options.load.quiet = true;
+
+    ScriptedEventSource source({
+        {[&]
+         { WriteRouteFile(file, {"2.0.0.0/24", "3.0.0.0/24"}); },
+         false, WatchEventType::FilesChanged},
+        {[&]
+         { WriteRouteFile(file, {"2.0.0.0/24", "3.0.0.0/24", "4.0.0.0/24"}); },
+         false, WatchEventType::FilesChanged},
+        {nullptr, true, WatchEventType::FilesChanged},
+        {[&]
+         {
+           backend.DeleteEntry(Row(0, 0, kGateway));
+           backend.Seed(Row(0, 0, kOtherGateway));
+         },
+         false, WatchEventType::GatewayChanged},
+        {nullptr, true, WatchEventType::GatewayChanged},
+    });
+
+    RouteWatcher watcher(snapshot, {file}, options);
+    {
+      QuietOutput quiet;
+      watcher.Run(source);
+    }
+
+    EXPECT(watcher.ConvergeCount() == 3);
+    // 空闲时不设超时，去抖期间使用 debounceMs
+    const unsigned kInfinite = WATCH_WAIT_INFINITE;
+    EXPECT(source.timeouts == std::vector<unsigned>({kInfinite, 0, 0, kInfinite, 0, kInfinite}));
+    EXPECT(watcher.LastLatencyMs() >= 0 && watcher.LastLatencyMs() < 10000);
+    EXPECT(watcher.LastResult().failed == 0);
+    for (uint32_t network : {0x02000000u, 0x03000000u, 0x04000000u})
+      EXPECT(HasRow(backend, network, 24, kOtherGateway) && !HasRow(backend, network, 24, kGateway));
+    EXPECT(!HasRow(backend, 0x01000000u, 24, kGateway) && !HasRow(backend, 0x01000000u, 24, kOtherGateway));
+
+    RouteState state;
+    EXPECT(LoadRouteState(statePath, state));
+    EXPECT(state.gateway == kOtherGateway && state.ifIndex == 9);
+    EXPECT(SameRoutes(state.routes, Prefixes({0x02000000u, 0x03000000u, 0x04000000u}, 24)));
+    std::filesystem::remove(file);
+    std::filesystem::remove(statePath);
+  }
+
+  // 拒绝添加指定前缀的内存后端
+  class RejectingBackend : public MemoryRouteBackend
+  {
+  public:
+    uint32_t rejected = 0; ///< 拒绝添加的网络地址，0表示不拒绝
+
+    uint32_t CreateEntry(const RouteEntry &entry) override
+    {
+      if (rejected != 0 && entry.destination == rejected)
+        return 87;
+      return MemoryRouteBackend::CreateEntry(entry);
+    }
+  };
+
+  // 部分添加失败时记录中只有实际装上的路由，恢复后下次收敛补上
+  void TestWatchPartialFailure()
+  {
+    std::string file = TempPath("watch-partial.txt");
+    std::string statePath = TempPath("watch-partial.state");
+    std::filesystem::remove(statePath);
+    WriteRouteFile(file, {"1.0.0.0/24", "2.0.0.0/24", "3.0.0.0/24"});
+
+    RejectingBackend backend;
+    backend.rejected = 0x02000000u;
+    backend.Seed(Row(0, 0, kGateway));
+    RouteTableSnapshot snapshot(backend);
+    WatchOptions options;
+    options.statePath = statePath;
+    options.load.useCache = false;
+    options.load.quiet = true;
+    RouteWatcher watcher(snapshot, {file}, options);
+
+    QuietOutput quiet;
+    EXPECT(!watcher.Converge() && watcher.LastResult().added == 2 && watcher.LastResult().failed == 1);
+    RouteState state;
+    EXPECT(LoadRouteState(statePath, state));
+    EXPECT(SameRoutes(state.routes, Prefixes({0x01000000u, 0x03000000u}, 24)));
+
+    backend.rejected = 0;
+    EXPECT(watcher.Converge() && watcher.LastResult().added == 1 && watcher.LastResult().unchanged == 2);
+    EXPECT(LoadRouteState(statePath, state));
+    EXPECT(SameRoutes(state.routes, Prefixes({0x01000000u, 0x02000000u, 0x03000000u}, 24)));
+    EXPECT(watcher.ConvergeCount() == 2);
+    std::filesystem::remove(file);
+    std::filesystem::remove(statePath);
+  }
+
+  /**
+   * @brief 切换网关时部分路由切换失败
+   * @details 失败的前缀仍记录在旧网关上，随后的同步删除旧网关上的这一行，不留下无人管理的路由；
+   *          已经切换的行按前缀认领。恢复后下次收敛在新网关上补上失败的前缀
+   */
+  void TestWatchRepointFailure()
+  {
+    std::string file = TempPath("watch-repoint.txt");
+    std::string statePath = TempPath("watch-repoint.state");
+    std::filesystem::remove(statePath);
+    WriteRouteFile(file, {"1.0.0.0/24", "2.0.0.0/24", "3.0.0.0/24"});
+
+    RejectingBackend backend;
+    backend.Seed(Row(0, 0, kGateway));
+    RouteTableSnapshot snapshot(backend);
+    WatchOptions options;
+    options.debounceMs = 0;
+    options.statePath = statePath;
+    options.load.useCache = false;
+    options.load.quiet = true;
+    ScriptedEventSource source({
+        {[&]
+         {
+           backend.rejected = 0x02000000u;
+           backend.DeleteEntry(Row(0, 0, kGateway));
+           backend.Seed(Row(0, 0, kOtherGateway));
+         },
+         false, WatchEventType::GatewayChanged},
+        {nullptr, true, WatchEventType::GatewayChanged},
+        {[&]
+         {
+           RouteState state;
+           EXPECT(LoadRouteState(statePath, state) && state.gateway == kOtherGateway);
+           EXPECT(SameRoutes(state.routes, Prefixes({0x01000000u, 0x03000000u}, 24)));
+           EXPECT(SameRoutes(GatewayRoutes(backend, kOtherGateway), state.routes));
+           EXPECT(GatewayRoutes(backend, kGateway).Empty());
+           backend.rejected = 0;
+         },
+         false, WatchEventType::FilesChanged},
+        {nullptr, true, WatchEventType::FilesChanged},
+    });
+    RouteWatcher watcher(snapshot, {file}, options);
+    {
+      QuietOutput quiet;
+      watcher.Run(source);
+    }
+    RouteSet all = Prefixes({0x01000000u, 0x02000000u, 0x03000000u}, 24);
+    RouteState state;
+    EXPECT(LoadRouteState(statePath, state) && SameRoutes(state.routes, all));
+    EXPECT(SameRoutes(GatewayRoutes(backend, kOtherGateway), all) && GatewayRoutes(backend, kGateway).Empty());
+    std::filesystem::remove(file);
+    std::filesystem::remove(statePath);
+  }
+
+  /**
+   * @brief 文件被删除或读到空内容时不删除任何路由
+   * @details 文件删除、清空后各收敛一次，路由和记录保持不变；恢复内容后按新内容同步。
+   *          记录中已有路由而文件不存在时启动的监视器也不删除记录中的路由
+   */
+  void TestWatchUnreadableFiles()
+  {
+    std::string file = TempPath("watch-unreadable.txt");
+    std::string statePath = TempPath("watch-unreadable.state");
+    std::filesystem::remove(statePath);
+    WriteRouteFile(file, {"1.0.0.0/24", "2.0.0.0/24"});
+
+    MemoryRouteBackend backend;
+    backend.Seed(Row(0, 0, kGateway));
+    RouteTableSnapshot snapshot(backend);
+    WatchOptions options;
+    options.debounceMs = 0;
+    options.statePath = statePath;
+    options.load.useCache = false;
+    options.load.quiet = true;
+    RouteSet installed = Prefixes({0x01000000u, 0x02000000u}, 24);
+    auto unchanged = [&]
+    {
+      RouteState state;
+      return SameRoutes(GatewayRoutes(backend, kGateway), installed) && LoadRouteState(statePath, state) &&
+             SameRoutes(state.routes, installed);
+    };
+
+    ScriptedEventSource source({
+        {[&]
+         { std::filesystem::remove(file); },
+         false, WatchEventType::FilesChanged},
+        {nullptr, true, WatchEventType::FilesChanged},
+        {[&]
+         {
+           EXPECT(unchanged());
+           WriteRouteFile(file, {});
+         },
+         false, WatchEventType::FilesChanged},
+        {nullptr, true, WatchEventType::FilesChanged},
+        {[&]
+         {
+           EXPECT(unchanged());
+           WriteRouteFile(file, {"# rewriting"});
+         },
+         false, WatchEventType::GatewayChanged},
+        {nullptr, true, WatchEventType::GatewayChanged},
+        {[&]
+         {
+           EXPECT(unchanged());
+           WriteRouteFile(file, {"2.0.0.0/24", "3.0.0.0/24"});
+         },
+         false, WatchEventType::FilesChanged},
+        {nullptr, true, WatchEventType::FilesChanged},
+    });
+    RouteWatcher watcher(snapshot, {file}, options);
+    {
+      QuietOutput quiet;
+      watcher.Run(source);
+    }
+    EXPECT(SameRoutes(GatewayRoutes(backend, kGateway), Prefixes({0x02000000u, 0x03000000u}, 24)));
+    EXPECT(watcher.ConvergeCount() == 5);
+
+    // 启动时文件就不存在：不同步，记录中的路由保持不变
+    installed = Prefixes({0x02000000u, 0x03000000u}, 24);
+    std::filesystem::remove(file);
+    RouteTableSnapshot restarted(backend);
+    RouteWatcher idle(restarted, {file}, options);
+    {
+      QuietOutput quiet;
+      EXPECT(!idle.Converge() && idle.ConvergeCount() == 0);
+    }
+    EXPECT(unchanged());
+    std::filesystem::remove(statePath);
+  }
+
+  // 状态文件中有 add 登记的路由文件时监视器不启动，路由表和记录都保持不变
+  void TestWatchRecordedSources()
+  {
+    std::string file = TempPath("watch-sources.txt");
+    std::string statePath = TempPath("watch-sources.state");
+    WriteRouteFile(file, {"3.0.0.0/24"});
+
+    MemoryRouteBackend backend;
+    backend.Seed(Row(0, 0, kGateway));
+    backend.Seed(Row(0x01000000u, 24, kGateway));
+    RouteState state;
+    state.gateway = kGateway;
+    state.ifIndex = 7;
+    state.routes = Prefixes({0x01000000u}, 24);
+    state.sources = {"chnroute.txt"};
+    state.contributed = state.routes;
+    state.sourceMasks = {1};
+    state.tracked = state.routes;
+    EXPECT(SaveRouteState(statePath, state));
+    std::string before = ReadBytes(statePath);
+
+    RouteTableSnapshot snapshot(backend);
+    WatchOptions options;
+    options.statePath = statePath;
+    options.load.useCache = false;
+    options.load.quiet = true;
+    RouteWatcher watcher(snapshot, {file}, options);
+    ScriptedEventSource source({{nullptr, false, WatchEventType::FilesChanged}});
+    {
+      QuietOutput quiet;
+      EXPECT(!watcher.Converge() && !watcher.Run(source));
+    }
+    EXPECT(source.timeouts.empty() && watcher.ConvergeCount() == 0);
+    EXPECT(SameRoutes(GatewayRoutes(backend, kGateway), state.routes));
+    EXPECT(ReadBytes(statePath) == before);
+    std::filesystem::remove(file);
+    std::filesystem::remove(statePath);
+  }
+
+  // 路由表没有变化时轮询不读取路由表，默认网关变化后只读取一次
+  void TestWatchPollingIdle()
+  {
+    std::string file = TempPath("watch-idle.txt");
+    WriteRouteFile(file, {"1.0.0.0/24"});
+    MemoryRouteBackend backend;
+    backend.Seed(Row(0, 0, kGateway));
+    RouteTableSnapshot snapshot(backend);
+    PollingEventSource source(
+        {file}, [&]()
+        {
+          snapshot.Update();
+          return snapshot.DefaultRoute(); },
+        1);
+
+    size_t reads = backend.tableCalls;
+    size_t fetches = snapshot.FetchCount();
+    WatchEvent event;
+    EXPECT(!source.WaitEvent(event, 30));
+    EXPECT(backend.tableCalls == reads && snapshot.FetchCount() == fetches);
+
+    // 跃点数更小的默认路由出现在另一个网关上
+    RouteEntry other = Row(0, 0, kOtherGateway);
+    other.metric = 5;
+    backend.Seed(other);
+    EXPECT(source.WaitEvent(event, 1000) && event.type == WatchEventType::GatewayChanged);
+    EXPECT(backend.tableCalls == reads + 1 && snapshot.FetchCount() == fetches + 1);
+    EXPECT(!source.WaitEvent(event, 30) && backend.tableCalls == reads + 1 && snapshot.FetchCount() == fetches + 1);
+
+    // 不设超时时一直轮询到文件变化
+    std::thread writer([&]
+                       {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      WriteRouteFile(file, {"1.0.0.0/24", "2.0.0.0/24"}); });
+    EXPECT(source.WaitEvent(event, WATCH_WAIT_INFINITE) && event.type == WatchEventType::FilesChanged);
+    writer.join();
+    std::filesystem::remove(file);
+  }
+
+  void WriteBytes(const std::string &filename, const std::string &data)
+  {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), (std::streamsize)data.size());
+  }
+
+  // 包含已安装前缀、来源和指纹的状态
+  RouteState SampleState()
+  {
+    RouteState state;
+    state.gateway = kGateway;
+    state.ifIndex = 7;
+    state.metric = 25;
+    state.routes = Prefixes({0x01000000u, 0x02000000u, 0x03000000u}, 24);
+    state.sources = {"chnroute.txt", "custom.txt"};
+    state.contributed = Prefixes({0x01000000u, 0x02000000u, 0x03000000u}, 24);
+    state.sourceMasks = {1, 3, 2};
+    state.fingerprint = 0x1234567890ABCDEFull;
+    state.tracked = Prefixes({0x01000000u, 0x02000000u}, 24);
+    return state;
+  }
+
+  bool SameState(const RouteState &left, const RouteState &right)
+  {
+    return left.generation == right.generation && left.gateway == right.gateway && left.ifIndex == right.ifIndex &&
+           left.metric == right.metric && SameRoutes(left.routes, right.routes) && left.sources == right.sources &&
+           SameRoutes(left.contributed, right.contributed) && left.sourceMasks == right.sourceMasks &&
+           left.fingerprint == right.fingerprint && SameRoutes(left.tracked, right.tracked);
+  }
+
+  // 改写文件头中的字段后重新计算校验和，得到校验和正确但结构无效的文件
+  std::string Reseal(std::string image, size_t offset, uint32_t value)
+  {
+    memcpy(&image[offset], &value, 4);
+    memset(&image[32], 0, 8);
+    uint64_t checksum = HashBytes(image.data() + 40, image.size() - 40, HashBytes(image.data(), 40));
+    memcpy(&image[32], &checksum, 8);
+    return image;
+  }
+
+  /**
+   * @brief 截断、损坏和校验和错误的状态文件都被拒绝
+   * @details 1. 保存后读回与原状态完全相同
+   *          2. 截断到任意长度、翻转任意一个字节都读取失败
+   *          3. 文件头字段被改写但校验和重新计算时，前缀数越界、来源数超过64、末尾多余字节也读取失败
+   */
+  void TestStateCorruption()
+  {
+    std::string path = TempPath("corrupt.state");
+    RouteState state = SampleState();
+    EXPECT(SaveRouteState(path, state));
+    RouteState loaded;
+    EXPECT(LoadRouteState(path, loaded) && SameState(loaded, state));
+
+    std::string image = ReadBytes(path);
+    QuietOutput quiet;
+    for (size_t size = 0; size < image.size(); size++)
+    {
+      WriteBytes(path, image.substr(0, size));
+      if (!EXPECT(!LoadRouteState(path, loaded)))
+      {
+        printf("  truncated to %zu bytes\n", size);
+        break;
+      }
+    }
+    for (size_t i = 0; i < image.size(); i++)
+    {
+      std::string flipped = image;
+      flipped[i] ^= 0x10;
+      WriteBytes(path, flipped);
+      if (!EXPECT(!LoadRouteState(path, loaded)))
+      {
+        printf("  byte %zu flipped\n", i);
+        break;
+      }
+    }
+
+    // 只改校验和
+    std::string badChecksum = image;
+    badChecksum[39] ^= 0x01;
+    WriteBytes(path, badChecksum);
+    EXPECT(!LoadRouteState(path, loaded));
+
+    // 校验和正确但结构无效
+    WriteBytes(path, Reseal(image, 28, 1000000)); // 前缀数超出文件长度
+    EXPECT(!LoadRouteState(path, loaded));
+    WriteBytes(path, Reseal(image, 4, 99)); // 未知版本
+    EXPECT(!LoadRouteState(path, loaded));
+    std::string tooManySources = image;
+    uint32_t sourceCount = 65;
+    memcpy(&tooManySources[40 + 3 * 5], &sourceCount, 4);
+    WriteBytes(path, Reseal(tooManySources, 28, 3));
+    EXPECT(!LoadRouteState(path, loaded));
+    WriteBytes(path, Reseal(image + '\0', 28, 3)); // 末尾多一个字节
+    EXPECT(!LoadRouteState(path, loaded));
+    WriteBytes(path, Reseal(image.substr(0, 40 + 3 * 5), 28, 3)); // 版本2缺少来源部分
+    EXPECT(!LoadRouteState(path, loaded));
+
+    // 版本1的文件只有已安装的前缀
+    WriteBytes(path, Reseal(image.substr(0, 40 + 3 * 5), 4, 1));
+    EXPECT(LoadRouteState(path, loaded) && SameRoutes(loaded.routes, state.routes) && loaded.sources.empty() &&
+           loaded.fingerprint == 0 && loaded.tracked.Empty() && loaded.gateway == state.gateway);
+
+    WriteBytes(path, image);
+    EXPECT(LoadRouteState(path, loaded) && SameState(loaded, state));
+    std::filesystem::remove(path);
+  }
+
+  /**
+   * @brief 写入中断时旧状态保持完整
+   * @details 1. 写到一半崩溃留下的临时文件不影响读取旧状态，下次保存覆盖它
+   *          2. 临时文件无法创建(写入失败)时保存返回false，旧状态不变
+   */
+  void TestStateInterruptedWrite()
+  {
+    std::string path = TempPath("interrupted.state");
+    std::string temp = path + ".tmp";
+    std::filesystem::remove_all(temp);
+    RouteState state = SampleState();
+    EXPECT(SaveRouteState(path, state));
+
+    // 新状态只写了一半
+    RouteState next = state;
+    next.routes.Add(0x04000000u, 24);
+    EXPECT(SaveRouteState(temp, next));
+    std::string partial = ReadBytes(temp);
+    WriteBytes(temp, partial.substr(0, partial.size() / 2));
+
+    RouteState loaded;
+    EXPECT(LoadRouteState(path, loaded) && SameState(loaded, state));
+    EXPECT(SaveRouteState(path, next) && !std::filesystem::exists(temp));
+    EXPECT(LoadRouteState(path, loaded) && SameState(loaded, next));
+
+    // 临时文件的位置被目录占用，写入失败
+    std::filesystem::create_directory(temp);
+    RouteState failed = next;
+    failed.routes.Add(0x05000000u, 24);
+    EXPECT(!SaveRouteState(path, failed));
+    EXPECT(LoadRouteState(path, loaded) && SameState(loaded, next));
+    std::filesystem::remove_all(temp);
+    std::filesystem::remove(path);
+  }
+
+  struct TestCase
+  {
+    const char *name;
+    void (*run)();
+  };
+
+  const TestCase kTests[] = {
+      {"aggregate_coverage", TestAggregateCoverage},
+      {"aggregate_edges", TestAggregateEdges},
+      {"limit_routes_minimal", TestLimitRoutesMinimal},
+      {"limit_routes_greedy", TestLimitRoutesGreedy},
+      {"set_ops_bitmap", TestSetOpsBitmap},
+      {"set_ops_edges", TestSetOpsEdges},
+      {"parse_ranges_exact", TestParseRangesExact},
+      {"parse_delegated_lines", TestParseDelegatedLines},
+      {"parse_simd_scalar", TestParseSimdScalar},
+      {"parse_parallel_serial", TestParseParallelSerial},
+      {"patch_round_trip", TestPatchRoundTrip},
+      {"builtin_source_round_trip", TestBuiltinSourceRoundTrip},
+      {"builtin_matches_source", TestBuiltinMatchesSource},
+      {"route_cache_staleness", TestRouteCacheStaleness},
+      {"lpm_linear_scan", TestLpmLinearScan},
+      {"lpm_edges", TestLpmEdges},
+      {"priority_weights", TestPriorityWeights},
+      {"installer_error_counts", TestInstallerErrorCounts},
+      {"stream_records_before_install", TestStreamRecordsBeforeInstall},
+      {"sync_ownership", TestSyncOwnership},
+      {"sync_gateway_change", TestSyncGatewayChange},
+      {"repoint_owned_rows", TestRepointOwnedRows},
+      {"apply_tracked_options", TestApplyTrackedOptions},
+      {"add_fingerprint_skip", TestAddFingerprintSkip},
+      {"state_corruption", TestStateCorruption},
+      {"state_interrupted_write", TestStateInterruptedWrite},
+      {"watch_scripted_events", TestWatchScriptedEvents},
+      {"watch_partial_failure", TestWatchPartialFailure},
+      {"watch_repoint_failure", TestWatchRepointFailure},
+      {"watch_unreadable_files", TestWatchUnreadableFiles},
+      {"watch_recorded_sources", TestWatchRecordedSources},
+      {"watch_polling_idle", TestWatchPollingIdle},
+  };
+}
+
+int main(int argc, char *argv[])
+{
+  std::string filter = argc > 1 ? argv[1] : "";
+  int failedTests = 0, ran = 0;
+  for (const TestCase &test : kTests)
+  {
+    if (std::string(test.name).find(filter) == std::string::npos)
+    {
+      continue;
+    }
+    int before = failures;
+    test.run();
+    ran++;
+    bool ok = failures == before;
+    failedTests += ok ? 0 : 1;
+    printf("[%s] %s\n", ok ? " OK " : "FAIL", test.name);
+  }
+  printf("%d of %d tests passed\n", ran - failedTests, ran);
+  return failedTests == 0 ? 0 : 1;
+}
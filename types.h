@@ -1,28 +1,139 @@
 #pragma once
-#include <string>
-#include <windows.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 紧凑的CIDR记录
+ * @details 由解析器直接生成，不经过字符串中转：
+ *          network 为主机字节序的网络地址(主机位已清零)
+ *          prefixLen 为前缀长度(0-32)
+ */
+struct CidrRecord
+{
+  uint32_t network;  ///< 网络地址(主机字节序)
+  uint8_t prefixLen; ///< 前缀长度
+};
 
 /**
  * @brief 路由条目结构
- * @details 包含了一个路由条目所需的所有信息
+ * @details 包含了一个路由条目所需的所有信息，全部为整数字段：
+ *          地址均为主机字节序，只在调用系统API时转换为网络字节序，
+ *          只在输出时格式化为点分十进制字符串
  */
 struct RouteEntry
 {
-  std::string destination; ///< 目标网络地址
-  std::string mask;        ///< 子网掩码
-  std::string gateway;     ///< 网关地址
-  DWORD metric;            ///< 路由跃点数（度量值）
-  DWORD ifIndex;           ///< 网络接口索引
+  uint32_t destination; ///< 目标网络地址
+  uint32_t gateway;     ///< 网关地址(下一跳)
+  uint32_t ifIndex;     ///< 网络接口索引
+  uint32_t metric;      ///< 路由跃点数（度量值）
+  uint8_t prefixLen;    ///< 前缀长度(0-32)
+  uint32_t protocol;    ///< 路由协议(MIB_IPPROTO_*，如 NT_STATIC 为10006)，0表示按静态路由(NETMGMT)处理
 };
 
+/// 静态路由协议号，与 MIB_IPPROTO_NETMGMT 相同，win-route 添加的路由都使用该协议
+const uint32_t ROUTE_PROTO_NETMGMT = 3;
+
+/**
+ * @brief 判断路由表中的一行是否为静态路由
+ * @param row 路由表中的一行
+ * @return bool 协议为 NETMGMT 或未填写(0)时返回true，与添加时0按 NETMGMT 处理一致
+ */
+inline bool IsStaticRoute(const RouteEntry &row)
+{
+  return row.protocol == ROUTE_PROTO_NETMGMT || row.protocol == 0;
+}
+
+/**
+ * @brief 路由前缀集合
+ * @details 以结构数组(SoA)的形式连续存储前缀，每条路由仅占5字节：
+ *          1. networks[i] 为主机字节序的网络地址
+ *          2. prefixLens[i] 为对应的前缀长度
+ *          3. 同一集合内的路由共用网关、接口和跃点数，安装时再统一指定
+ */
+struct RouteSet
+{
+  std::vector<uint32_t> networks; ///< 网络地址(主机字节序)
+  std::vector<uint8_t> prefixLens; ///< 前缀长度
+
+  size_t Size() const { return networks.size(); }
+  bool Empty() const { return networks.empty(); }
+
+  void Reserve(size_t count)
+  {
+    networks.reserve(count);
+    prefixLens.reserve(count);
+  }
+
+  void Add(uint32_t network, uint8_t prefixLen)
+  {
+    networks.push_back(network);
+    prefixLens.push_back(prefixLen);
+  }
+
+  void Append(const RouteSet &other)
+  {
+    networks.insert(networks.end(), other.networks.begin(), other.networks.end());
+    prefixLens.insert(prefixLens.end(), other.prefixLens.begin(), other.prefixLens.end());
+  }
+
+  void Clear()
+  {
+    networks.clear();
+    prefixLens.clear();
+  }
+};
+
+/**
+ * @brief 把前缀打包为64位键
+ * @param network 网络地址(主机字节序)
+ * @param prefixLen 前缀长度
+ * @return uint64_t 高位为网络地址、低8位为前缀长度，按键排序即按(network, prefixLen)排序
+ */
+inline uint64_t PrefixKey(uint32_t network, uint8_t prefixLen)
+{
+  return ((uint64_t)network << 8) | prefixLen;
+}
+
+/**
+ * @brief 集合中第 i 个前缀的64位键
+ */
+inline uint64_t KeyAt(const RouteSet &routes, size_t i)
+{
+  return PrefixKey(routes.networks[i], routes.prefixLens[i]);
+}
+
+/**
+ * @brief 由前缀长度计算主机字节序的子网掩码
+ * @param prefixLen 前缀长度(0-32)
+ * @return uint32_t 子网掩码，如24对应0xFFFFFF00
+ */
+inline uint32_t PrefixToMask(unsigned prefixLen)
+{
+  return prefixLen == 0 ? 0 : (0xFFFFFFFFu << (32 - prefixLen));
+}
+
+/**
+ * @brief 由主机字节序的子网掩码计算前缀长度
+ * @param mask 子网掩码
+ * @return uint8_t 前缀长度，非连续掩码按前导1的个数计算
+ */
+inline uint8_t MaskToPrefix(uint32_t mask)
+{
+  uint8_t bits = 0;
+  while (bits < 32 && (mask & (0x80000000u >> bits)))
+    bits++;
+  return bits;
+}
+
 /**
  * @brief 默认网关信息结构
  * @details 存储系统默认网关的相关信息
  */
 struct DefaultGatewayInfo
 {
-  DWORD ifIndex;       ///< 默认网关使用的接口索引
-  std::string gateway; ///< 默认网关地址
-  DWORD metric;        ///< 默认路由的度量值
-  bool valid;          ///< 标识信息是否有效
-};
\ No newline at end of file
+  uint32_t ifIndex; ///< 默认网关使用的接口索引
+  uint32_t gateway; ///< 默认网关地址(主机字节序)
+  uint32_t metric;  ///< 默认路由的度量值
+  bool valid;       ///< 标识信息是否有效
+};
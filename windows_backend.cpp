@@ -0,0 +1,142 @@
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <iphlpapi.h>
+#include "windows_backend.h"
+
+namespace
+{
+  MIB_IPFORWARDROW ToForwardRow(const RouteEntry &entry)
+  {
+    MIB_IPFORWARDROW row = {0};
+    row.dwForwardDest = htonl(entry.destination);
+    row.dwForwardMask = htonl(PrefixToMask(entry.prefixLen));
+    row.dwForwardNextHop = htonl(entry.gateway);
+    row.dwForwardMetric1 = entry.metric;
+    row.dwForwardIfIndex = entry.ifIndex;
+    row.dwForwardType = MIB_IPROUTE_TYPE_INDIRECT;
+    row.dwForwardProto = entry.protocol ? entry.protocol : MIB_IPPROTO_NETMGMT;
+    row.dwForwardAge = 0;
+    return row;
+  }
+
+  RouteEntry FromForwardRow(const MIB_IPFORWARDROW &row)
+  {
+    RouteEntry entry;
+    entry.destination = ntohl(row.dwForwardDest);
+    entry.prefixLen = MaskToPrefix(ntohl(row.dwForwardMask));
+    entry.gateway = ntohl(row.dwForwardNextHop);
+    entry.ifIndex = row.dwForwardIfIndex;
+    entry.metric = row.dwForwardMetric1;
+    entry.protocol = row.dwForwardProto;
+    return entry;
+  }
+
+  // 在系统线程池中调用，context 为 changes_
+  VOID NETIOAPI_API_ OnRouteChange(PVOID context, PMIB_IPFORWARD_ROW2, MIB_NOTIFICATION_TYPE)
+  {
+    ((std::atomic<uint64_t> *)context)->fetch_add(1);
+  }
+}
+
+WindowsRouteBackend::WindowsRouteBackend()
+{
+  HANDLE handle = NULL;
+  if (NotifyRouteChange2(AF_INET, OnRouteChange, &changes_, FALSE, &handle) == NO_ERROR)
+  {
+    notification_ = handle;
+  }
+}
+
+WindowsRouteBackend::~WindowsRouteBackend()
+{
+  // 返回时不会再有回调在执行
+  if (notification_ != nullptr)
+  {
+    CancelMibChangeNotify2((HANDLE)notification_);
+  }
+}
+
+uint64_t WindowsRouteBackend::ChangeCount()
+{
+  return notification_ != nullptr ? changes_.load() : ROUTE_CHANGES_UNKNOWN;
+}
+
+bool WindowsRouteBackend::GetTable(std::vector<RouteEntry> &rows)
+{
+  rows.clear();
+
+  // 路由表可能在探测大小和实际读取之间增长，此时按新的大小重试
+  DWORD result = ERROR_INSUFFICIENT_BUFFER;
+  for (int attempt = 0; attempt < 5 && result == ERROR_INSUFFICIENT_BUFFER; attempt++)
+  {
+    ULONG size = (ULONG)buffer_.size();
+    result = GetIpForwardTable(buffer_.empty() ? NULL : (PMIB_IPFORWARDTABLE)buffer_.data(), &size, TRUE);
+    if (result == ERROR_INSUFFICIENT_BUFFER)
+    {
+      buffer_.resize(size);
+    }
+  }
+
+  // 路由表为空
+  if (result == ERROR_NO_DATA)
+  {
+    return true;
+  }
+  if (result != NO_ERROR)
+  {
+    return false;
+  }
+
+  PMIB_IPFORWARDTABLE table = (PMIB_IPFORWARDTABLE)buffer_.data();
+  rows.reserve(table->dwNumEntries);
+  for (DWORD i = 0; i < table->dwNumEntries; i++)
+  {
+    rows.push_back(FromForwardRow(table->table[i]));
+  }
+  return true;
+}
+
+uint32_t WindowsRouteBackend::CreateEntry(const RouteEntry &entry)
+{
+  MIB_IPFORWARDROW row = ToForwardRow(entry);
+  return CreateIpForwardEntry(&row);
+}
+
+uint32_t WindowsRouteBackend::DeleteEntry(const RouteEntry &entry)
+{
+  MIB_IPFORWARDROW row = ToForwardRow(entry);
+  return DeleteIpForwardEntry(&row);
+}
+
+uint32_t WindowsRouteBackend::SetEntry(const RouteEntry &entry)
+{
+  MIB_IPFORWARDROW row = ToForwardRow(entry);
+  return SetIpForwardEntry(&row);
+}
+
+std::string WindowsRouteBackend::DescribeError(uint32_t code)
+{
+  LPVOID lpMsgBuf = nullptr;
+  FormatMessage(
+      FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+      NULL,
+      code,
+      MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+      (LPTSTR)&lpMsgBuf,
+      0,
+      NULL);
+  if (lpMsgBuf == nullptr)
+  {
+    return RouteBackend::DescribeError(code);
+  }
+
+  // 去掉系统消息末尾的换行
+  std::string message = (char *)lpMsgBuf;
+  LocalFree(lpMsgBuf);
+  while (!message.empty() && (message.back() == '\n' || message.back() == '\r'))
+  {
+    message.pop_back();
+  }
+  return message;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "route_backend.h"
+#include <atomic>
+
+/**
+ * @brief 基于 IP Helper API 的路由后端
+ * @details 1. GetTable 使用 GetIpForwardTable，路由表在两次调用之间增长时自动重试
+ *          2. 路由表缓冲区在多次调用之间复用
+ *          3. CreateEntry/DeleteEntry/SetEntry 对应 CreateIpForwardEntry/DeleteIpForwardEntry/SetIpForwardEntry
+ *          4. DescribeError 使用 FormatMessage 获取系统错误描述
+ *          5. 构造时用 NotifyRouteChange2 注册IPv4路由变化通知，ChangeCount 返回收到的通知数，析构时取消
+ */
+class WindowsRouteBackend : public RouteBackend
+{
+public:
+  WindowsRouteBackend();
+  ~WindowsRouteBackend() override;
+  WindowsRouteBackend(const WindowsRouteBackend &) = delete;
+  WindowsRouteBackend &operator=(const WindowsRouteBackend &) = delete;
+
+  bool GetTable(std::vector<RouteEntry> &rows) override;
+  uint32_t CreateEntry(const RouteEntry &entry) override;
+  uint32_t DeleteEntry(const RouteEntry &entry) override;
+  uint32_t SetEntry(const RouteEntry &entry) override;
+  std::string DescribeError(uint32_t code) override;
+  uint64_t ChangeCount() override;
+
+private:
+  std::vector<unsigned char> buffer_; ///< 复用的路由表缓冲区
+  void *notification_ = nullptr;      ///< 路由变化通知句柄(HANDLE)，注册失败时为nullptr
+  std::atomic<uint64_t> changes_{0};  ///< 收到的路由变化通知数
+};